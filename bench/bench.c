@@ -0,0 +1,901 @@
+/*
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmarks the library on generated files
+ *
+ * Each benchmark runs in its own process to measure its peak RSS,
+ * and prints one JSON object per line on the standard output:
+ * {"bench": "open", "sections": 1000, "properties": 10, "value_len": 16,
+ *  "names": "unique", "file_bytes": 312890, "ops": 1200,
+ *  "ns_per_op": 81234.5, "mb_per_s": 3851.7, "peak_rss_kb": 5120}
+ * mb_per_s is null for the benchmarks not reading or writing the file
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "libngi/libngi.h"
+
+/* Default minimum duration of a benchmark in seconds */
+#define DEFAULT_MIN_TIME 0.2
+/* Maximum wall time of a benchmark relative to the minimum duration,
+ * for the benchmarks with an untimed setup on each operation
+ */
+#define MAX_WALL_FACTOR 4
+/* Number of names looked up in a row */
+#define LOOKUP_BATCH 4096
+/* Number of (section, property) pairs resolved by a request */
+#define PAIRS_BATCH 32
+/* Number of replaces in a transaction */
+#define TRANSACTION_EDITS 1000
+/* Number of distinct section names with the duplicate pattern */
+#define DUPLICATE_GROUPS 16
+/* Maximum number of reader threads of the concurrent lookups */
+#define MAX_READERS 8
+/* Prefix shared by all the names with the prefix pattern */
+#define LONG_PREFIX "org.example.service.component.module.settings."
+
+#define NAME_LENGTH 256
+
+/**
+ * @brief Patterns of the generated names
+ *
+ * UNIQUE: "section N" and "key N", the keys repeat in each section
+ * PREFIX: the same names after a long common prefix
+ * DUPLICATE: only DUPLICATE_GROUPS distinct section names
+ */
+enum name_pattern {
+    UNIQUE,
+    PREFIX,
+    DUPLICATE,
+};
+
+static const char* const pattern_names[] = {
+    [UNIQUE] = "unique",
+    [PREFIX] = "prefix",
+    [DUPLICATE] = "duplicate",
+};
+
+/**
+ * @brief Parameters of a generated file
+ */
+struct bench_config {
+    int sections;
+    int properties;
+    int value_len;
+    enum name_pattern names;
+};
+
+/**
+ * @brief Inputs shared by the benchmarks of a configuration
+ */
+struct bench_ctx {
+    const struct bench_config* config;
+    const char* filename;
+    char* contents;
+    size_t size;
+    double min_time;
+};
+
+/**
+ * @brief Measurement of a benchmark
+ *
+ * bytes is the number of bytes read or written by all the operations,
+ * 0 when it's not relevant
+ */
+struct bench_result {
+    long ops;
+    double ns;
+    double bytes;
+    double started;
+};
+
+typedef void (*bench_fn_t)(const struct bench_ctx* ctx,
+                           struct bench_result* result);
+
+/* Default matrix of configurations */
+static const struct bench_config default_configs[] = {
+    {100, 10, 16, UNIQUE},      {10000, 10, 16, UNIQUE},
+    {1000, 1, 16, UNIQUE},      {1000, 100, 16, UNIQUE},
+    {1000, 10, 256, UNIQUE},    {10000, 10, 16, PREFIX},
+    {10000, 10, 16, DUPLICATE},
+};
+
+/* Prevents the compiler from removing the lookups */
+static volatile uintptr_t sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Pseudo random numbers reproducible across the runs */
+static uint32_t next_random(uint32_t* state) {
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 8;
+}
+
+/* Run at least once, then until the minimum or the maximum time is reached */
+static int bench_running(const struct bench_ctx* ctx,
+                         const struct bench_result* result) {
+    const double min_ns = ctx->min_time * 1e9;
+
+    return result->ops == 0 ||
+           (result->ns < min_ns &&
+            now_ns() - result->started < min_ns * MAX_WALL_FACTOR);
+}
+
+static void section_name(char* buff, const struct bench_config* config,
+                         int index) {
+    switch (config->names) {
+    case PREFIX:
+        snprintf(buff, NAME_LENGTH, LONG_PREFIX "section %d", index);
+        break;
+    case DUPLICATE:
+        snprintf(buff, NAME_LENGTH, "section %d", index % DUPLICATE_GROUPS);
+        break;
+    default:
+        snprintf(buff, NAME_LENGTH, "section %d", index);
+        break;
+    }
+}
+
+static void property_name(char* buff, const struct bench_config* config,
+                          int index) {
+    if (config->names == PREFIX)
+        snprintf(buff, NAME_LENGTH, LONG_PREFIX "key %d", index);
+    else
+        snprintf(buff, NAME_LENGTH, "key %d", index);
+}
+
+static void property_value(char* buff, const struct bench_config* config,
+                           int seed) {
+    for (int i = 0; i < config->value_len; i++)
+        buff[i] = 'a' + (seed + i) % 26;
+
+    buff[config->value_len] = '\0';
+}
+
+/**
+ * @brief Writes the file described by the configuration
+ *
+ * @return 1 on success, 0 otherwise
+ */
+static int generate_file(const char* filename,
+                         const struct bench_config* config) {
+    FILE* fd = fopen(filename, "w");
+    if (fd == NULL)
+        return 0;
+
+    char name[NAME_LENGTH];
+    char* value = malloc(config->value_len + 1);
+
+    for (int i = 0; i < config->sections; i++) {
+        section_name(name, config, i);
+        fprintf(fd, "%s ->\n", name);
+
+        for (int j = 0; j < config->properties; j++) {
+            property_name(name, config, j);
+            property_value(value, config, i + j);
+            fprintf(fd, "%s: %s\n", name, value);
+        }
+
+        fputc('\n', fd);
+    }
+
+    free(value);
+
+    return fclose(fd) == 0;
+}
+
+static char* read_file(const char* filename, size_t* size) {
+    FILE* fd = fopen(filename, "r");
+    if (fd == NULL)
+        return NULL;
+
+    fseek(fd, 0, SEEK_END);
+    *size = ftell(fd);
+    rewind(fd);
+
+    char* contents = malloc(*size + 1);
+    if (contents != NULL && fread(contents, 1, *size, fd) != *size) {
+        free(contents);
+        contents = NULL;
+    }
+
+    fclose(fd);
+
+    return contents;
+}
+
+/* Copy the generated file for the benchmarks modifying it */
+static int copy_file(const struct bench_ctx* ctx, const char* filename) {
+    FILE* fd = fopen(filename, "w");
+    if (fd == NULL)
+        return 0;
+
+    fwrite(ctx->contents, 1, ctx->size, fd);
+
+    return fclose(fd) == 0;
+}
+
+static void bench_open(const struct bench_ctx* ctx,
+                       struct bench_result* result) {
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        ngi_header_t* header = ngi_open(ctx->filename, "r");
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+
+        ngi_close(header);
+    }
+}
+
+static void bench_open_mmap(const struct bench_ctx* ctx,
+                            struct bench_result* result) {
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        ngi_header_t* header = ngi_open_mmap(ctx->filename);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+
+        ngi_close(header);
+    }
+}
+
+static void bench_open_lazy(const struct bench_ctx* ctx,
+                            struct bench_result* result) {
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        ngi_header_t* header = ngi_open_lazy(ctx->filename);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+
+        ngi_close(header);
+    }
+}
+
+static void bench_open_compiled(const struct bench_ctx* ctx,
+                                struct bench_result* result) {
+    char image_name[NAME_LENGTH];
+    snprintf(image_name, sizeof(image_name), "%s.ngic", ctx->filename);
+
+    /* The first open writes the image used by the next ones */
+    ngi_close(ngi_open_compiled(ctx->filename));
+
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        ngi_header_t* header = ngi_open_compiled(ctx->filename);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+
+        ngi_close(header);
+    }
+
+    remove(image_name);
+}
+
+static void bench_parse_buffer(const struct bench_ctx* ctx,
+                               struct bench_result* result) {
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        ngi_header_t* header = ngi_parse_buffer(ctx->contents, ctx->size);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+
+        ngi_close(header);
+    }
+}
+
+static void bench_close(const struct bench_ctx* ctx,
+                        struct bench_result* result) {
+    while (bench_running(ctx, result)) {
+        ngi_header_t* header = ngi_open(ctx->filename, "r");
+
+        double start = now_ns();
+        ngi_close(header);
+        result->ns += now_ns() - start;
+        result->ops++;
+    }
+}
+
+static void bench_get_section_by_name(const struct bench_ctx* ctx,
+                                      struct bench_result* result) {
+    ngi_header_t* header = ngi_open(ctx->filename, "r");
+    char(*names)[NAME_LENGTH] = malloc(LOOKUP_BATCH * sizeof(*names));
+    uint32_t seed = 1;
+
+    for (int i = 0; i < LOOKUP_BATCH; i++)
+        section_name(names[i], ctx->config,
+                     next_random(&seed) % ctx->config->sections);
+
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        for (int i = 0; i < LOOKUP_BATCH; i++)
+            sink += (uintptr_t)ngi_get_section_by_name(header, names[i]);
+        result->ns += now_ns() - start;
+        result->ops += LOOKUP_BATCH;
+    }
+
+    free(names);
+    ngi_close(header);
+}
+
+static void bench_get_property_by_name(const struct bench_ctx* ctx,
+                                       struct bench_result* result) {
+    ngi_header_t* header = ngi_open(ctx->filename, "r");
+    ngi_section_t** sections = malloc(LOOKUP_BATCH * sizeof(*sections));
+    char(*names)[NAME_LENGTH] = malloc(LOOKUP_BATCH * sizeof(*names));
+    uint32_t seed = 1;
+
+    for (int i = 0; i < LOOKUP_BATCH; i++) {
+        sections[i] = ngi_get_section(
+            header, next_random(&seed) % ctx->config->sections);
+        property_name(names[i], ctx->config,
+                      next_random(&seed) % ctx->config->properties);
+    }
+
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        for (int i = 0; i < LOOKUP_BATCH; i++)
+            sink += (uintptr_t)ngi_get_property_by_name(sections[i], names[i]);
+        result->ns += now_ns() - start;
+        result->ops += LOOKUP_BATCH;
+    }
+
+    free(names);
+    free(sections);
+    ngi_close(header);
+}
+
+static void random_keys(const struct bench_ctx* ctx, ngi_key_t* keys,
+                        char (*names)[NAME_LENGTH], uint32_t* seed) {
+    for (int i = 0; i < PAIRS_BATCH; i++) {
+        section_name(names[2 * i], ctx->config,
+                     next_random(seed) % ctx->config->sections);
+        property_name(names[2 * i + 1], ctx->config,
+                      next_random(seed) % ctx->config->properties);
+        keys[i].section = names[2 * i];
+        keys[i].property = names[2 * i + 1];
+    }
+}
+
+static void bench_pairs_lookup(const struct bench_ctx* ctx,
+                               struct bench_result* result) {
+    ngi_header_t* header = ngi_open(ctx->filename, "r");
+    ngi_key_t keys[PAIRS_BATCH];
+    char(*names)[NAME_LENGTH] = malloc(2 * PAIRS_BATCH * sizeof(*names));
+    uint32_t seed = 1;
+
+    random_keys(ctx, keys, names, &seed);
+
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        for (int i = 0; i < PAIRS_BATCH; i++) {
+            ngi_section_t* section =
+                ngi_get_section_by_name(header, keys[i].section);
+            sink += (uintptr_t)ngi_get_property_by_name(section,
+                                                        keys[i].property);
+        }
+        result->ns += now_ns() - start;
+        result->ops += PAIRS_BATCH;
+    }
+
+    free(names);
+    ngi_close(header);
+}
+
+static void bench_batch_lookup(const struct bench_ctx* ctx,
+                               struct bench_result* result) {
+    ngi_header_t* header = ngi_open(ctx->filename, "r");
+    ngi_key_t keys[PAIRS_BATCH];
+    ngi_property_t* properties[PAIRS_BATCH];
+    char(*names)[NAME_LENGTH] = malloc(2 * PAIRS_BATCH * sizeof(*names));
+    uint32_t seed = 1;
+
+    random_keys(ctx, keys, names, &seed);
+    ngi_batch_t* batch = ngi_batch_create(keys, PAIRS_BATCH);
+
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        sink += ngi_batch_get_properties(batch, header, properties);
+        result->ns += now_ns() - start;
+        result->ops += PAIRS_BATCH;
+    }
+
+    ngi_batch_free(batch);
+    free(names);
+    ngi_close(header);
+}
+
+static void bench_sections_by_prefix(const struct bench_ctx* ctx,
+                                     struct bench_result* result) {
+    ngi_header_t* header = ngi_open(ctx->filename, "r");
+    char(*names)[NAME_LENGTH] = malloc(LOOKUP_BATCH * sizeof(*names));
+    uint32_t seed = 1;
+
+    for (int i = 0; i < LOOKUP_BATCH; i++)
+        section_name(names[i], ctx->config,
+                     next_random(&seed) % ctx->config->sections);
+
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        for (int i = 0; i < LOOKUP_BATCH; i++) {
+            int first;
+            const int len = ngi_get_sections_by_prefix(header, names[i], &first);
+
+            for (int j = 0; j < len; j++)
+                sink += (uintptr_t)ngi_get_sorted_section(header, first + j);
+        }
+        result->ns += now_ns() - start;
+        result->ops += LOOKUP_BATCH;
+    }
+
+    free(names);
+    ngi_close(header);
+}
+
+/**
+ * @brief Lookups of a reader thread sharing a concurrent header
+ */
+struct reader_args {
+    ngi_header_t* header;
+    ngi_section_t** sections;
+    char (*names)[NAME_LENGTH];
+    const int* stop;
+    long ops;
+};
+
+static void* concurrent_reader(void* arg) {
+    struct reader_args* args = arg;
+    uintptr_t found = 0;
+
+    while (!__atomic_load_n(args->stop, __ATOMIC_RELAXED)) {
+        for (int i = 0; i < LOOKUP_BATCH; i++) {
+            ngi_read_lock(args->header);
+            found += (uintptr_t)ngi_get_property_by_name(args->sections[i],
+                                                        args->names[i]);
+            ngi_read_unlock(args->header);
+        }
+        args->ops += LOOKUP_BATCH;
+    }
+
+    __atomic_add_fetch(&sink, found, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void bench_concurrent_lookup(const struct bench_ctx* ctx,
+                                    struct bench_result* result) {
+    ngi_header_t* header = ngi_open(ctx->filename, "r");
+    ngi_section_t** sections = malloc(LOOKUP_BATCH * sizeof(*sections));
+    char(*names)[NAME_LENGTH] = malloc(LOOKUP_BATCH * sizeof(*names));
+    uint32_t seed = 1;
+
+    ngi_set_concurrent(header);
+
+    for (int i = 0; i < LOOKUP_BATCH; i++) {
+        sections[i] = ngi_get_section(
+            header, next_random(&seed) % ctx->config->sections);
+        property_name(names[i], ctx->config,
+                      next_random(&seed) % ctx->config->properties);
+    }
+
+    /* One reader per core, ns_per_op is the wall time of all the readers */
+    long readers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (readers < 1)
+        readers = 1;
+    if (readers > MAX_READERS)
+        readers = MAX_READERS;
+
+    pthread_t threads[MAX_READERS];
+    struct reader_args args[MAX_READERS];
+    int stop = 0;
+
+    double start = now_ns();
+    for (int i = 0; i < readers; i++) {
+        args[i] = (struct reader_args){header, sections, names, &stop, 0};
+        pthread_create(&threads[i], NULL, concurrent_reader, &args[i]);
+    }
+
+    while (now_ns() - start < ctx->min_time * 1e9)
+        usleep(1000);
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < readers; i++) {
+        pthread_join(threads[i], NULL);
+        result->ops += args[i].ops;
+    }
+    result->ns = now_ns() - start;
+
+    free(names);
+    free(sections);
+    ngi_close(header);
+}
+
+static void run_recache(const struct bench_ctx* ctx,
+                        struct bench_result* result, int check) {
+    ngi_header_t* header = ngi_open(ctx->filename, "r");
+    ngi_set_recache_check(header, check);
+
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        ngi_recache_file(header);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+    }
+
+    ngi_close(header);
+}
+
+/* The file doesn't change, so the checks are measured against a parse */
+static void bench_recache(const struct bench_ctx* ctx,
+                          struct bench_result* result) {
+    run_recache(ctx, result, NGI_RECACHE_ALWAYS);
+}
+
+static void bench_recache_stat(const struct bench_ctx* ctx,
+                               struct bench_result* result) {
+    run_recache(ctx, result, NGI_RECACHE_STAT);
+}
+
+static void bench_recache_hash(const struct bench_ctx* ctx,
+                               struct bench_result* result) {
+    run_recache(ctx, result, NGI_RECACHE_HASH);
+}
+
+/* One value changes between the recaches, the other sections are skipped */
+static void bench_recache_edit(const struct bench_ctx* ctx,
+                               struct bench_result* result) {
+    char filename[NAME_LENGTH];
+    snprintf(filename, NAME_LENGTH, "%s.edit", ctx->filename);
+    if (!copy_file(ctx, filename))
+        return;
+
+    ngi_header_t* header = ngi_open(filename, "r");
+    ngi_set_recache_check(header, NGI_RECACHE_ALWAYS);
+    FILE* fd = fopen(filename, "r+");
+    uint32_t seed = 1;
+
+    while (bench_running(ctx, result)) {
+        /* Change the first letter of the value after a random offset */
+        const size_t offset = next_random(&seed) % ctx->size;
+        const char* token =
+            memchr(ctx->contents + offset, ':', ctx->size - offset);
+        if (token == NULL)
+            token = memchr(ctx->contents, ':', ctx->size);
+
+        fseek(fd, token + 2 - ctx->contents, SEEK_SET);
+        fputc('a' + result->ops % 26, fd);
+        fflush(fd);
+
+        double start = now_ns();
+        ngi_recache_file(header);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+    }
+
+    fclose(fd);
+    ngi_close(header);
+    remove(filename);
+}
+
+static void bench_property_replace(const struct bench_ctx* ctx,
+                                   struct bench_result* result) {
+    char filename[NAME_LENGTH];
+    snprintf(filename, NAME_LENGTH, "%s.replace", ctx->filename);
+    if (!copy_file(ctx, filename))
+        return;
+
+    ngi_header_t* header = ngi_open(filename, "r+");
+    char* value = malloc(ctx->config->value_len + 1);
+    uint32_t seed = 1;
+
+    while (bench_running(ctx, result)) {
+        ngi_section_t* section = ngi_get_section(
+            header, next_random(&seed) % ctx->config->sections);
+        ngi_property_t* property = ngi_get_property(
+            section, next_random(&seed) % ctx->config->properties);
+
+        /* Keep the same name and the same value length */
+        property_value(value, ctx->config, next_random(&seed));
+
+        double start = now_ns();
+        ngi_property_replace(header, property, ngi_get_property_name(property),
+                             value);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+    }
+
+    free(value);
+    ngi_close(header);
+    remove(filename);
+}
+
+static void bench_commit(const struct bench_ctx* ctx,
+                         struct bench_result* result) {
+    char filename[NAME_LENGTH];
+    snprintf(filename, NAME_LENGTH, "%s.commit", ctx->filename);
+    if (!copy_file(ctx, filename))
+        return;
+
+    ngi_header_t* header = ngi_open(filename, "r+");
+    char* value = malloc(ctx->config->value_len + 1);
+    uint32_t seed = 1;
+
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        ngi_begin(header);
+
+        for (int i = 0; i < TRANSACTION_EDITS; i++) {
+            ngi_section_t* section = ngi_get_section(
+                header, next_random(&seed) % ctx->config->sections);
+            ngi_property_t* property = ngi_get_property(
+                section, next_random(&seed) % ctx->config->properties);
+
+            property_value(value, ctx->config, next_random(&seed));
+            ngi_property_replace(header, property,
+                                 ngi_get_property_name(property), value);
+        }
+
+        ngi_commit(header);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+    }
+
+    free(value);
+    ngi_close(header);
+    remove(filename);
+}
+
+static void bench_save(const struct bench_ctx* ctx,
+                       struct bench_result* result) {
+    char filename[NAME_LENGTH];
+    snprintf(filename, NAME_LENGTH, "%s.save", ctx->filename);
+    if (!copy_file(ctx, filename))
+        return;
+
+    ngi_header_t* header = ngi_open(filename, "r+");
+
+    /* Without fsync to measure the library rather than the disk */
+    while (bench_running(ctx, result)) {
+        double start = now_ns();
+        ngi_save(header, NGI_SYNC_NONE);
+        result->ns += now_ns() - start;
+        result->ops++;
+        result->bytes += ctx->size;
+    }
+
+    ngi_close(header);
+    remove(filename);
+}
+
+static void bench_create_section(const struct bench_ctx* ctx,
+                                 struct bench_result* result) {
+    char filename[NAME_LENGTH];
+    snprintf(filename, NAME_LENGTH, "%s.create", ctx->filename);
+    if (!copy_file(ctx, filename))
+        return;
+
+    ngi_header_t* header = ngi_open(filename, "r+");
+    char name[NAME_LENGTH];
+
+    while (bench_running(ctx, result)) {
+        snprintf(name, NAME_LENGTH, "new section %ld", result->ops);
+
+        double start = now_ns();
+        ngi_create_section(header, name);
+        result->ns += now_ns() - start;
+        result->ops++;
+    }
+
+    ngi_close(header);
+    remove(filename);
+}
+
+static const struct {
+    const char* name;
+    bench_fn_t fn;
+} benchmarks[] = {
+    {"open", bench_open},
+    {"open_mmap", bench_open_mmap},
+    {"open_lazy", bench_open_lazy},
+    {"open_compiled", bench_open_compiled},
+    {"parse_buffer", bench_parse_buffer},
+    {"get_section_by_name", bench_get_section_by_name},
+    {"get_property_by_name", bench_get_property_by_name},
+    {"sections_by_prefix", bench_sections_by_prefix},
+    {"pairs_lookup", bench_pairs_lookup},
+    {"batch_lookup", bench_batch_lookup},
+    {"concurrent_lookup", bench_concurrent_lookup},
+    {"recache", bench_recache},
+    {"recache_stat", bench_recache_stat},
+    {"recache_hash", bench_recache_hash},
+    {"recache_edit", bench_recache_edit},
+    {"property_replace", bench_property_replace},
+    {"commit", bench_commit},
+    {"save", bench_save},
+    {"create_section", bench_create_section},
+    {"close", bench_close},
+};
+
+static void print_result(const struct bench_ctx* ctx, const char* name,
+                         const struct bench_result* result) {
+    const struct bench_config* config = ctx->config;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("{\"bench\": \"%s\", \"sections\": %d, \"properties\": %d, "
+           "\"value_len\": %d, \"names\": \"%s\", \"file_bytes\": %zu, "
+           "\"ops\": %ld, \"ns_per_op\": %.1f, ",
+           name, config->sections, config->properties, config->value_len,
+           pattern_names[config->names], ctx->size, result->ops,
+           result->ops > 0 ? result->ns / result->ops : 0.0);
+
+    if (result->bytes > 0 && result->ns > 0)
+        printf("\"mb_per_s\": %.1f, ", result->bytes / result->ns * 1e3);
+    else
+        printf("\"mb_per_s\": null, ");
+
+    printf("\"peak_rss_kb\": %ld}\n", usage.ru_maxrss);
+}
+
+/**
+ * @brief Runs a benchmark in a child process
+ *
+ * @return 1 on success, 0 otherwise
+ */
+static int run_benchmark(const struct bench_ctx* ctx, int index) {
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid == -1)
+        return 0;
+
+    if (pid == 0) {
+        struct bench_result result = {.started = now_ns()};
+        benchmarks[index].fn(ctx, &result);
+        print_result(ctx, benchmarks[index].name, &result);
+        fflush(stdout);
+        _exit(result.ops > 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) == -1)
+        return 0;
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+static int run_config(const struct bench_config* config, const char* filter,
+                      double min_time) {
+    char filename[] = "/tmp/libngi-bench-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd == -1)
+        return 0;
+    close(fd);
+
+    struct bench_ctx ctx = {
+        .config = config,
+        .filename = filename,
+        .contents = NULL,
+        .size = 0,
+        .min_time = min_time,
+    };
+    int res = generate_file(filename, config) &&
+              (ctx.contents = read_file(filename, &ctx.size)) != NULL;
+
+    for (size_t i = 0; res && i < sizeof(benchmarks) / sizeof(*benchmarks);
+         i++) {
+        if (filter != NULL && strstr(benchmarks[i].name, filter) == NULL)
+            continue;
+
+        if (!run_benchmark(&ctx, i)) {
+            fprintf(stderr, "bench: %s failed\n", benchmarks[i].name);
+            res = 0;
+        }
+    }
+
+    free(ctx.contents);
+    remove(filename);
+
+    return res;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [-s sections] [-p properties] [-v value_len] "
+            "[-n unique|prefix|duplicate] [-b filter] [-t seconds]\n"
+            "Without -s, -p, -v or -n the default matrix is run\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    struct bench_config config = {1000, 10, 16, UNIQUE};
+    const char* filter = NULL;
+    double min_time = DEFAULT_MIN_TIME;
+    int custom = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:p:v:n:b:t:h")) != -1) {
+        switch (opt) {
+        case 's':
+            config.sections = atoi(optarg);
+            custom = 1;
+            break;
+        case 'p':
+            config.properties = atoi(optarg);
+            custom = 1;
+            break;
+        case 'v':
+            config.value_len = atoi(optarg);
+            custom = 1;
+            break;
+        case 'n':
+            if (!strcmp(optarg, "prefix"))
+                config.names = PREFIX;
+            else if (!strcmp(optarg, "duplicate"))
+                config.names = DUPLICATE;
+            else
+                config.names = UNIQUE;
+            custom = 1;
+            break;
+        case 'b':
+            filter = optarg;
+            break;
+        case 't':
+            min_time = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (config.sections <= 0 || config.properties <= 0 ||
+        config.value_len < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int res = 1;
+
+    if (custom) {
+        res = run_config(&config, filter, min_time);
+    } else {
+        const size_t len = sizeof(default_configs) / sizeof(*default_configs);
+        for (size_t i = 0; i < len; i++)
+            res &= run_config(&default_configs[i], filter, min_time);
+    }
+
+    return res ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file arena.h
+ * @brief The libgni arena allocator header (**internal**)
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/* Granularity of the allocations and number of recycled size classes */
+#define NGI_ARENA_ALIGNMENT   16
+#define NGI_ARENA_SIZE_CLASSES 32
+
+typedef struct ngi_arena_block ngi_arena_block_t;
+
+/**
+ * @brief Contains the memory blocks of a ngi_header (**internal**)
+ *
+ * The ngi_arena contains:
+ * - the list of blocks, the current block is the first one
+ * - the size of the next block to allocate
+ * - the lists of released allocations by size class
+ *
+ * All the allocations are freed at once with ngi_arena_free
+ */
+typedef struct ngi_arena {
+    ngi_arena_block_t* blocks;
+    size_t next_block_size;
+    void* free_lists[NGI_ARENA_SIZE_CLASSES];
+} ngi_arena_t;
+
+/**
+ * @brief Initializes an empty arena (**internal**)
+ *
+ * @param[out] arena
+ */
+void ngi_arena_init(ngi_arena_t* arena);
+
+/**
+ * @brief Frees all the blocks of the arena (**internal**)
+ *
+ * @param[in] arena
+ */
+void ngi_arena_free(ngi_arena_t* arena);
+
+/**
+ * @brief Allocates memory in the arena (**internal**)
+ *
+ * @param[in] arena
+ * @param[in] size
+ *
+ * @return The allocated memory or NULL if the allocation has failed
+ */
+void* ngi_arena_alloc(ngi_arena_t* arena, size_t size);
+
+/**
+ * @brief Allocates zeroed memory in the arena (**internal**)
+ *
+ * @param[in] arena
+ * @param[in] size
+ *
+ * @return The allocated memory or NULL if the allocation has failed
+ */
+void* ngi_arena_calloc(ngi_arena_t* arena, size_t size);
+
+/**
+ * @brief Reallocates memory in the arena (**internal**)
+ *
+ * The allocation is extended in place when it's the last one of the block
+ *
+ * @param[in] arena
+ * @param[in] ptr
+ * @param[in] old_size
+ * @param[in] new_size
+ *
+ * @return The reallocated memory or NULL if the allocation has failed
+ */
+void* ngi_arena_realloc(ngi_arena_t* arena, void* ptr, size_t old_size,
+                        size_t new_size);
+
+/**
+ * @brief Gives back an allocation to the arena to be reused (**internal**)
+ *
+ * @param[in] arena
+ * @param[in] ptr
+ * @param[in] size
+ */
+void ngi_arena_release(ngi_arena_t* arena, void* ptr, size_t size);
+
+/**
+ * @brief Checks if a pointer has been allocated in the arena (**internal**)
+ *
+ * @param[in] arena
+ * @param[in] ptr
+ *
+ * @return 1 if the pointer is in a block of the arena, 0 otherwise
+ */
+int ngi_arena_contains(const ngi_arena_t* arena, const void* ptr);
+
+/**
+ * @brief Copies a string in the arena (**internal**)
+ *
+ * @param[in] arena
+ * @param[in] str
+ * @param[in] len
+ *
+ * @return The NUL terminated copy or NULL if the allocation has failed
+ */
+char* ngi_arena_strndup(ngi_arena_t* arena, const char* str, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H */
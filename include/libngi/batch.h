@@ -0,0 +1,94 @@
+/**
+ * @file batch.h
+ * @brief The libgni batch header
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libngi.h"
+
+typedef struct ngi_batch ngi_batch_t;
+
+/**
+ * @brief Contains the names of a ngi_property and of his ngi_section
+ */
+typedef struct ngi_key {
+    const char* section;
+    const char* property;
+} ngi_key_t;
+
+/**
+ * @brief Prepares the lookup of several ngi_properties at once
+ *
+ * The names are copied and hashed once, the keys are grouped by section.
+ * A ngi_batch is only read by the lookups,
+ * so it can be shared by several threads and trees.
+ *
+ * @param[in] keys
+ * @param[in] len The number of keys
+ *
+ * @return A new ngi_batch or NULL if the allocation failed
+ */
+ngi_batch_t* ngi_batch_create(const ngi_key_t* keys, int len);
+
+/**
+ * @brief Frees the ngi_batch
+ *
+ * @param[in] ngi_batch
+ */
+void ngi_batch_free(ngi_batch_t* ngi_batch);
+
+/**
+ * @brief Finds the ngi_properties of all the keys
+ *
+ * Each ngi_section is found once, and the index slots of the next ones
+ * are loaded while the previous ones are searched.
+ * A concurrent ngi_header must be read locked during the call.
+ *
+ * @param[in] ngi_batch
+ * @param[in] ngi_header
+ * @param[out] properties The ngi_property of each key, NULL if not found
+ *
+ * @return The number of found ngi_properties
+ */
+int ngi_batch_get_properties(const ngi_batch_t* ngi_batch,
+                             const ngi_header_t* ngi_header,
+                             ngi_property_t** properties);
+
+/**
+ * @brief Finds the values of all the keys
+ *
+ * @param[in] ngi_batch
+ * @param[in] ngi_header
+ * @param[out] values The value of each key, NULL if not found
+ *
+ * @return The number of found values
+ */
+int ngi_batch_get_values(const ngi_batch_t* ngi_batch,
+                         const ngi_header_t* ngi_header, const char** values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BATCH_H */
@@ -29,15 +29,34 @@ typedef struct ngi_header ngi_header_t;
 typedef struct ngi_section ngi_section_t;
 typedef struct ngi_property ngi_property_t;
 
+/* Checks skipping the recache of an unchanged file */
+#define NGI_RECACHE_ALWAYS 0 /* The file is always read again */
+#define NGI_RECACHE_STAT   1 /* Same inode, size, mtime and ctime (default) */
+#define NGI_RECACHE_HASH   2 /* Same contents, when the times can't be trusted */
+
 /**
  * @brief Recaches the file when manual changes are made
  *
+ * The tree is left as it is when the file didn't change
+ * since it was last read, see ngi_set_recache_check
+ *
  * @param[in] ngi_header
  *
  * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
  */
 int ngi_recache_file(ngi_header_t* ngi_header);
 
+/**
+ * @brief Sets how ngi_recache_file checks if the file changed
+ *
+ * NGI_RECACHE_STAT costs one stat, NGI_RECACHE_HASH also reads the file
+ * to hash it but doesn't parse it when the contents are the same
+ *
+ * @param[in] ngi_header
+ * @param[in] check NGI_RECACHE_ALWAYS, NGI_RECACHE_STAT or NGI_RECACHE_HASH
+ */
+void ngi_set_recache_check(ngi_header_t* ngi_header, int check);
+
 #ifdef __cplusplus
 }
 #endif
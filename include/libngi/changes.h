@@ -0,0 +1,101 @@
+/**
+ * @file changes.h
+ * @brief The libgni changes header
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CHANGES_H
+#define CHANGES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libngi.h"
+
+/* Types of change */
+#define NGI_CHANGE_ADDED    0
+#define NGI_CHANGE_REMOVED  1
+#define NGI_CHANGE_RENAMED  2
+#define NGI_CHANGE_MODIFIED 3
+
+typedef struct ngi_changes ngi_changes_t;
+
+/**
+ * @brief Describes a change of a section or a property
+ *
+ * The ngi_change contains:
+ * - the type of change
+ * - the name of the section
+ * - the name of the property, NULL when the change is about the section
+ * - the name before a rename, NULL otherwise
+ *
+ * The nodes are matched by name, a node is renamed
+ * when his value or his properties stay the same.
+ * The changes of the properties of a lazy section who are not parsed
+ * are listed as the section being modified.
+ * The strings are owned by the ngi_changes.
+ */
+typedef struct ngi_change {
+    int type;
+    const char* section;
+    const char* property;
+    const char* old_name;
+} ngi_change_t;
+
+/**
+ * @brief Recaches the file and lists what changed in the tree
+ *
+ * @param[in] ngi_header
+ * @param[out] ngi_changes The changes to free with ngi_changes_free
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_recache_changes(ngi_header_t* ngi_header, ngi_changes_t** ngi_changes);
+
+/**
+ * @brief Gets the number of changes
+ *
+ * @param[in] ngi_changes
+ *
+ * @return The number of changes
+ */
+int ngi_get_changes_number(const ngi_changes_t* ngi_changes);
+
+/**
+ * @brief Gets a change by index
+ *
+ * @param[in] ngi_changes
+ * @param[in] change_num
+ *
+ * @return The change or NULL if the index is out of range
+ */
+const ngi_change_t* ngi_get_change(const ngi_changes_t* ngi_changes,
+                                   int change_num);
+
+/**
+ * @brief Frees the changes
+ *
+ * @param[in] ngi_changes
+ */
+void ngi_changes_free(ngi_changes_t* ngi_changes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHANGES_H */
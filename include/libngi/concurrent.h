@@ -0,0 +1,69 @@
+/**
+ * @file concurrent.h
+ * @brief The libgni concurrent.header
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONCURRENT_H
+#define CONCURRENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libngi.h"
+
+/**
+ * @brief Lets several threads use the ngi_header at the same time
+ *
+ * The readers surround their use of the tree with ngi_read_lock
+ * and ngi_read_unlock, they only wait for the writers.
+ * The functions modifying the tree or the file exclude the readers
+ * and the other writers by themselves.
+ * Must be called before the ngi_header is shared,
+ * the programs using it must be linked with -pthread.
+ *
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_set_concurrent(ngi_header_t* ngi_header);
+
+/**
+ * @brief Prevents the writers from modifying the tree
+ *
+ * The nodes and strings got from the tree stay valid until ngi_read_unlock.
+ * The lock is not recursive, and a thread holding it
+ * must not call a function modifying the tree.
+ * Nothing is done if the ngi_header is not concurrent.
+ *
+ * @param[in] ngi_header
+ */
+void ngi_read_lock(ngi_header_t* ngi_header);
+
+/**
+ * @brief Lets the writers modify the tree again
+ *
+ * @param[in] ngi_header
+ */
+void ngi_read_unlock(ngi_header_t* ngi_header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONCURRENT_H */
@@ -0,0 +1,208 @@
+/**
+ * @file hash.h
+ * @brief The libgni hash index header (**internal**)
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HASH_H
+#define HASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/**
+ * @brief Contains an entry of the hash index (**internal**)
+ *
+ * The ngi_hash_entry contains:
+ * - the hash of the key
+ * - the key (the name buffer of the node)
+ * - the indexed node, NULL when the slot is empty
+ */
+typedef struct ngi_hash_entry {
+    uint32_t hash;
+    const char* key;
+    void* node;
+} ngi_hash_entry_t;
+
+/**
+ * @brief Contains an open addressing hash index by name (**internal**)
+ *
+ * The ngi_hash_table contains:
+ * - the slots of the index (linear probing)
+ * - the number of slots, always a power of two
+ * - the number of used slots
+ * - the arena holding the slots
+ */
+typedef struct ngi_hash_table {
+    ngi_hash_entry_t* entries;
+    int capacity;
+    int len;
+    ngi_arena_t* arena;
+} ngi_hash_table_t;
+
+/**
+ * @brief Contains a hash computed over several buffers (**internal**)
+ *
+ * The ngi_hash_state contains:
+ * - the hash of the words already mixed
+ * - the last bytes who don't fill a word yet
+ * - the number of hashed bytes
+ */
+typedef struct ngi_hash_state {
+    uint64_t hash;
+    uint64_t tail;
+    size_t size;
+} ngi_hash_state_t;
+
+/**
+ * @brief Hashes a string (**internal**)
+ *
+ * @param[in] str
+ *
+ * @return The hash of the string
+ */
+uint32_t ngi_hash_string(const char* str);
+
+/**
+ * @brief Hashes a buffer eight bytes at a time (**internal**)
+ *
+ * @param[in] data
+ * @param[in] size
+ *
+ * @return The 64 bits hash of the buffer
+ */
+uint64_t ngi_hash_bytes(const void* data, size_t size);
+
+/**
+ * @brief Starts a hash computed over several buffers (**internal**)
+ *
+ * Hashing the buffers one after the other gives the same hash
+ * as ngi_hash_bytes over their concatenation
+ *
+ * @param[out] state
+ */
+void ngi_hash_init(ngi_hash_state_t* state);
+
+/**
+ * @brief Adds the next buffer to the hash (**internal**)
+ *
+ * @param[in,out] state
+ * @param[in] data
+ * @param[in] size
+ */
+void ngi_hash_update(ngi_hash_state_t* state, const void* data, size_t size);
+
+/**
+ * @brief Gets the hash of all the added buffers (**internal**)
+ *
+ * @param[in] state
+ *
+ * @return The 64 bits hash of the buffers
+ */
+uint64_t ngi_hash_final(const ngi_hash_state_t* state);
+
+/**
+ * @brief Initializes an empty hash index (**internal**)
+ *
+ * @param[out] table
+ * @param[in] arena
+ */
+void ngi_hash_table_init(ngi_hash_table_t* table, ngi_arena_t* arena);
+
+/**
+ * @brief Frees the slots of a hash index (**internal**)
+ *
+ * @param[in] table
+ */
+void ngi_hash_table_free(ngi_hash_table_t* table);
+
+/**
+ * @brief Adds a node in the hash index (**internal**)
+ *
+ * The key must stay valid until the node is removed from the index
+ *
+ * @param[in] table
+ * @param[in] key
+ * @param[in] node
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_hash_table_insert(ngi_hash_table_t* table, const char* key,
+                          void* node);
+
+/**
+ * @brief Makes room for the nodes of an empty hash index (**internal**)
+ *
+ * Nothing is done if the index already has nodes
+ *
+ * @param[in] table
+ * @param[in] len The number of nodes who will be added
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_hash_table_reserve(ngi_hash_table_t* table, int len);
+
+/**
+ * @brief Removes a node from the hash index (**internal**)
+ *
+ * @param[in] table
+ * @param[in] key
+ * @param[in] node
+ */
+void ngi_hash_table_remove(ngi_hash_table_t* table, const char* key,
+                           const void* node);
+
+/**
+ * @brief Finds the first node added with the key (**internal**)
+ *
+ * @param[in] table
+ * @param[in] key
+ *
+ * @return The node or NULL if the key is not in the index
+ */
+void* ngi_hash_table_find(const ngi_hash_table_t* table, const char* key);
+
+/**
+ * @brief Finds the first node added with a key already hashed (**internal**)
+ *
+ * @param[in] table
+ * @param[in] key
+ * @param[in] hash The hash of the key given by ngi_hash_string
+ *
+ * @return The node or NULL if the key is not in the index
+ */
+void* ngi_hash_table_find_hashed(const ngi_hash_table_t* table,
+                                 const char* key, uint32_t hash);
+
+/**
+ * @brief Starts loading the slot of a hash in the cache (**internal**)
+ *
+ * @param[in] table
+ * @param[in] hash
+ */
+void ngi_hash_table_prefetch(const ngi_hash_table_t* table, uint32_t hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HASH_H */
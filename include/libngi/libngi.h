@@ -31,8 +31,16 @@ extern "C" {
 
 #include <stdio.h>
 #include "caching.h"
+#include "batch.h"
+#include "changes.h"
+#include "concurrent.h"
 #include "create.h"
+#include "reload.h"
 #include "replace.h"
+#include "save.h"
+#include "shared.h"
+#include "transaction.h"
+#include "watch.h"
 
 /* Version informations */
 #define NGI_MAJOR 0
@@ -49,8 +57,6 @@ extern "C" {
 #endif /* NDEBUG */
 
 /* Maximum values */
-#define NGI_MAX_SECTIONS    8192
-#define NGI_MAX_PROPERTIES  8192
 #define NGI_MAX_NAME_LENGTH 4096
 #define NGI_MAX_LINE_LENGTH 8192
 
@@ -72,6 +78,72 @@ typedef struct ngi_property ngi_property_t;
  */
 ngi_header_t* ngi_open(const char* filename, const char* mode);
 
+/**
+ * @brief Opens an existing file in read-only mode by mapping it in memory
+ *
+ * The file is parsed in place and the names and values point
+ * directly in the mapping instead of being copied.
+ * There is no FILE* associated to the header, so the functions
+ * writing to the file (create, replace) have no effect.
+ * The file must be replaced (written aside then renamed, see ngi_save) rather
+ * than written in place while it's mapped, this includes ngi_property_replace
+ * and ngi_commit from another header: the pages who were not copied by the
+ * parser show the new contents, and the ones past a truncation fault.
+ *
+ * @param[in] filename
+ *
+ * @return A new ngi_header or NULL if the file can't be mapped
+ */
+ngi_header_t* ngi_open_mmap(const char* filename);
+
+/**
+ * @brief Opens an existing file like ngi_open_mmap, parsing only the sections
+ *
+ * Only the names and the positions of the sections are parsed,
+ * the properties of a section are parsed on first access.
+ * Opening is then mostly a sweep over the file and the memory
+ * only grows with the sections actually read.
+ * A section can't be loaded once the file is written in place
+ * (see ngi_open_mmap), it stays empty until ngi_recache_file.
+ *
+ * @param[in] filename
+ *
+ * @return A new ngi_header or NULL if the file can't be mapped
+ */
+ngi_header_t* ngi_open_lazy(const char* filename);
+
+/**
+ * @brief Opens an existing file like ngi_open_lazy, from his compiled image
+ *
+ * The parsed tree is kept in a binary image next to the file
+ * ("file.ngic" for "file.ngi"), whose names and values are used in place.
+ * The image is used when the size, the modification time and the hash
+ * of the file are the ones it was built from,
+ * otherwise the file is parsed and the image is written again.
+ * Only the sections are allocated on open,
+ * the properties of a section are allocated on first access.
+ *
+ * @param[in] filename
+ *
+ * @return A new ngi_header or NULL if the file can't be mapped
+ */
+ngi_header_t* ngi_open_compiled(const char* filename);
+
+/**
+ * @brief Parses a buffer already in memory in read-only mode
+ *
+ * The buffer is copied once and parsed in place, it can be released
+ * as soon as the function returns.
+ * There is no file associated to the header, so the functions
+ * writing to the file (create, replace) and the recache have no effect.
+ *
+ * @param[in] buff
+ * @param[in] size
+ *
+ * @return A new ngi_header or NULL if the buffer can't be parsed
+ */
+ngi_header_t* ngi_parse_buffer(const char* buff, size_t size);
+
 /**
  * @brief Closes a file and frees the ngi_header
  *
@@ -87,6 +159,30 @@ void ngi_close(ngi_header_t* ngi_header);
  */
 void ngi_dump_tree_to_file(ngi_header_t* ngi_header, FILE* fd);
 
+/**
+ * @brief Computes the size of the tree dumped using the ngi syntax
+ *
+ * @param[in] ngi_header
+ *
+ * @return The size in bytes, without the NUL terminator
+ */
+size_t ngi_dump_size(ngi_header_t* ngi_header);
+
+/**
+ * @brief Dumps the tree in memory contents in a buffer using the ngi syntax
+ *
+ * The dump is NUL terminated. A NULL buffer is allocated with the exact
+ * size and must be freed by the caller, otherwise the buffer must hold
+ * ngi_dump_size + 1 bytes.
+ *
+ * @param[in] ngi_header
+ * @param[in] buff The buffer or NULL
+ * @param[in,out] size The size of the buffer, set to the size of the dump
+ *
+ * @return The buffer or NULL if it's too small or can't be allocated
+ */
+char* ngi_dump_to_buffer(ngi_header_t* ngi_header, char* buff, size_t* size);
+
 /**
  * @brief Gets the ngi_section at the choosen index
  *
@@ -131,6 +227,85 @@ ngi_property_t* ngi_get_property(const ngi_section_t* ngi_section,
 ngi_property_t* ngi_get_property_by_name(const ngi_section_t* ngi_section,
                                          const char* name);
 
+/**
+ * @brief Finds the ngi_sections whose name starts with a prefix
+ *
+ * The ngi_sections are sorted by name and got with ngi_get_sorted_section,
+ * the positions are valid until the tree is modified
+ *
+ * @param[in] ngi_header
+ * @param[in] prefix
+ * @param[out] first The position of the first ngi_section
+ *
+ * @return The number of ngi_sections or -1 if the index can't be allocated
+ */
+int ngi_get_sections_by_prefix(const ngi_header_t* ngi_header,
+                               const char* prefix, int* first);
+
+/**
+ * @brief Finds the ngi_sections whose name is between two names
+ *
+ * @param[in] ngi_header
+ * @param[in] from The first name, included, NULL from the start
+ * @param[in] to The last name, excluded, NULL to the end
+ * @param[out] first The position of the first ngi_section
+ *
+ * @return The number of ngi_sections or -1 if the index can't be allocated
+ */
+int ngi_get_sections_by_range(const ngi_header_t* ngi_header,
+                              const char* from, const char* to, int* first);
+
+/**
+ * @brief Gets a ngi_section in the order of the names
+ *
+ * @param[in] ngi_header
+ * @param[in] position
+ *
+ * @return The appropriate ngi_section
+ */
+ngi_section_t* ngi_get_sorted_section(const ngi_header_t* ngi_header,
+                                      int position);
+
+/**
+ * @brief Finds the ngi_properties whose name starts with a prefix
+ *
+ * The ngi_properties are sorted by name and got with ngi_get_sorted_property,
+ * the positions are valid until the ngi_section is modified
+ *
+ * @param[in] ngi_section
+ * @param[in] prefix
+ * @param[out] first The position of the first ngi_property
+ *
+ * @return The number of ngi_properties or -1 if the index can't be allocated
+ */
+int ngi_get_properties_by_prefix(const ngi_section_t* ngi_section,
+                                 const char* prefix, int* first);
+
+/**
+ * @brief Finds the ngi_properties whose name is between two names
+ *
+ * @param[in] ngi_section
+ * @param[in] from The first name, included, NULL from the start
+ * @param[in] to The last name, excluded, NULL to the end
+ * @param[out] first The position of the first ngi_property
+ *
+ * @return The number of ngi_properties or -1 if the index can't be allocated
+ */
+int ngi_get_properties_by_range(const ngi_section_t* ngi_section,
+                                const char* from, const char* to,
+                                int* first);
+
+/**
+ * @brief Gets a ngi_property in the order of the names
+ *
+ * @param[in] ngi_section
+ * @param[in] position
+ *
+ * @return The appropriate ngi_property
+ */
+ngi_property_t* ngi_get_sorted_property(const ngi_section_t* ngi_section,
+                                        int position);
+
 /**
  * @brief Gets the ngi_section index
  *
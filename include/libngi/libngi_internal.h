@@ -27,17 +27,40 @@ extern "C" {
 
 #include <stdio.h>
 #include "libngi.h"
+#include "arena.h"
 #include "find.h"
+#include "hash.h"
 #include "parser.h"
+#include "sorted.h"
+#include "source.h"
 #include "tokens.h"
 #include "type.h"
 #include "write.h"
 
-#define SSCANF_PATTERN     "%[a-zA-Z0-9_ ]"
-#define MAX_PATTERN_LENGTH 30
+typedef struct ngi_lock ngi_lock_t;
 
 /* Core */
 
+/**
+ * @brief Makes room for the sections of a ngi_header (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] sections The number of sections who will be allocated
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_header_reserve(ngi_header_t* ngi_header, int sections);
+
+/**
+ * @brief Makes room for the properties of a ngi_section (**internal**)
+ *
+ * @param[in] ngi_section
+ * @param[in] properties The number of properties who will be allocated
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_section_reserve(ngi_section_t* ngi_section, int properties);
+
 /**
  * @brief Allocates a new ngi_section (**internal**)
  *
@@ -52,13 +75,46 @@ ngi_section_t* ngi_section_alloc(ngi_header_t* ngi_header, const char* name);
  * @brief Allocates a new ngi_property (**internal**)
  *
  * @param[in] ngi_section
- * @param[in] name_size
- * @param[in] value_size
+ * @param[in] name
+ * @param[in] value
  *
  * @return The allocated ngi_property
  */
-ngi_property_t* ngi_property_alloc(ngi_section_t* ngi_section, int name_size,
-                                   int value_size);
+ngi_property_t* ngi_property_alloc(ngi_section_t* ngi_section,
+                                   const char* name, const char* value);
+
+/**
+ * @brief Allocates a new ngi_section pointing to the name (**internal**)
+ *
+ * The name is not copied and must live as long as the ngi_section
+ *
+ * @param[in] ngi_header
+ * @param[in] name
+ * @param[in] name_len
+ *
+ * @return The allocated ngi_section
+ */
+ngi_section_t* ngi_section_alloc_view(ngi_header_t* ngi_header, char* name,
+                                      int name_len);
+
+/**
+ * @brief Allocates a new ngi_property pointing to the name and the value
+ * (**internal**)
+ *
+ * The name and the value are not copied
+ * and must live as long as the ngi_property
+ *
+ * @param[in] ngi_section
+ * @param[in] name
+ * @param[in] name_len
+ * @param[in] value
+ * @param[in] value_len
+ *
+ * @return The allocated ngi_property
+ */
+ngi_property_t* ngi_property_alloc_view(ngi_section_t* ngi_section, char* name,
+                                        int name_len, char* value,
+                                        int value_len);
 
 /**
  * @brief Reallocates a ngi_section (**internal**)
@@ -123,6 +179,370 @@ void ngi_set_property_name(ngi_property_t* ngi_property, const char* name);
  */
 void ngi_set_property_value(ngi_property_t* ngi_property, const char* value);
 
+/**
+ * @brief Points the ngi_section name to a new buffer (**internal**)
+ *
+ * @param[in] ngi_section
+ * @param[in] name
+ * @param[in] name_len
+ */
+void ngi_set_section_name_view(ngi_section_t* ngi_section, char* name,
+                               int name_len);
+
+/**
+ * @brief Points the ngi_property name and value to new buffers
+ * (**internal**)
+ *
+ * @param[in] ngi_property
+ * @param[in] name
+ * @param[in] name_len
+ * @param[in] value
+ * @param[in] value_len
+ */
+void ngi_set_property_view(ngi_property_t* ngi_property, char* name,
+                           int name_len, char* value, int value_len);
+
+/**
+ * @brief Gets the ngi_section by his name already hashed (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] name
+ * @param[in] hash The hash of the name given by ngi_hash_string
+ *
+ * @return The appropriate ngi_section
+ */
+ngi_section_t* ngi_get_section_by_hash(const ngi_header_t* ngi_header,
+                                       const char* name, uint32_t hash);
+
+/**
+ * @brief Gets the ngi_property by his name already hashed (**internal**)
+ *
+ * @param[in] ngi_section
+ * @param[in] name
+ * @param[in] hash The hash of the name given by ngi_hash_string
+ *
+ * @return The appropriate ngi_property
+ */
+ngi_property_t* ngi_get_property_by_hash(const ngi_section_t* ngi_section,
+                                         const char* name, uint32_t hash);
+
+/**
+ * @brief Starts loading the index slot of a ngi_section name (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] hash The hash of the name
+ */
+void ngi_prefetch_section(const ngi_header_t* ngi_header, uint32_t hash);
+
+/**
+ * @brief Starts loading the index slot of a ngi_property name
+ * (**internal**)
+ *
+ * The properties of a lazy ngi_section are parsed first
+ *
+ * @param[in] ngi_section
+ * @param[in] hash The hash of the name
+ */
+void ngi_prefetch_property(const ngi_section_t* ngi_section, uint32_t hash);
+
+/**
+ * @brief Gets the source parsed in place of the ngi_header (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return The source, his data is NULL if the file is not parsed in place
+ */
+ngi_source_t* ngi_get_source(ngi_header_t* ngi_header);
+
+/**
+ * @brief Gets the length of the ngi_section name (**internal**)
+ *
+ * @param[in] ngi_section
+ *
+ * @return The length of the name without the NUL terminator
+ */
+int ngi_get_section_name_len(const ngi_section_t* ngi_section);
+
+/**
+ * @brief Gets the length of the ngi_property name (**internal**)
+ *
+ * @param[in] ngi_property
+ *
+ * @return The length of the name without the NUL terminator
+ */
+int ngi_get_property_name_len(const ngi_property_t* ngi_property);
+
+/**
+ * @brief Gets the length of the ngi_property value (**internal**)
+ *
+ * @param[in] ngi_property
+ *
+ * @return The length of the value without the NUL terminator
+ */
+int ngi_get_property_value_len(const ngi_property_t* ngi_property);
+
+/**
+ * @brief Gets the version of the file when it was last read (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return The stamp, invalid if the file must be read again
+ */
+ngi_stamp_t* ngi_get_stamp(ngi_header_t* ngi_header);
+
+/**
+ * @brief Gets the references to a header published by a ngi_reloader
+ * (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return The counter, only accessed atomically
+ */
+int* ngi_get_refs(ngi_header_t* ngi_header);
+
+/**
+ * @brief Gets the lock shared by the threads (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return The lock, NULL if the ngi_header isn't concurrent
+ */
+ngi_lock_t* ngi_get_lock(const ngi_header_t* ngi_header);
+
+/**
+ * @brief Gets the check skipping the recache of an unchanged file
+ * (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return NGI_RECACHE_ALWAYS, NGI_RECACHE_STAT or NGI_RECACHE_HASH
+ */
+int ngi_get_recache_check(const ngi_header_t* ngi_header);
+
+/**
+ * @brief Gets the name of the opened file (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return The filename
+ */
+const char* ngi_get_filename(const ngi_header_t* ngi_header);
+
+/**
+ * @brief Replaces the file descriptor and closes the old one (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] fd
+ */
+void ngi_set_file(ngi_header_t* ngi_header, FILE* fd);
+
+/**
+ * @brief Opens the file again if it was replaced by a rename (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_reopen_file(ngi_header_t* ngi_header);
+
+/**
+ * @brief Gets the position of the ngi_section line in the file
+ * (**internal**)
+ *
+ * @param[in] ngi_section
+ *
+ * @return The span, his offset is -1 if the line is not in the file
+ */
+const ngi_span_t* ngi_get_section_span(const ngi_section_t* ngi_section);
+
+/**
+ * @brief Gets the position of the ngi_property line in the file
+ * (**internal**)
+ *
+ * @param[in] ngi_property
+ *
+ * @return The span, his offset is -1 if the line is not in the file
+ */
+const ngi_span_t* ngi_get_property_span(const ngi_property_t* ngi_property);
+
+/**
+ * @brief Sets the lock shared by the threads (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] ngi_lock
+ */
+void ngi_set_lock(ngi_header_t* ngi_header, ngi_lock_t* ngi_lock);
+
+/**
+ * @brief Sets the position of the ngi_section line in the file
+ * (**internal**)
+ *
+ * @param[in] ngi_section
+ * @param[in] span
+ */
+void ngi_set_section_span(ngi_section_t* ngi_section, const ngi_span_t* span);
+
+/**
+ * @brief Sets the position of the ngi_property line in the file
+ * (**internal**)
+ *
+ * @param[in] ngi_property
+ * @param[in] span
+ */
+void ngi_set_property_span(ngi_property_t* ngi_property,
+                           const ngi_span_t* span);
+
+/**
+ * @brief Moves the lines starting from an offset in the file (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] from
+ * @param[in] delta
+ */
+void ngi_shift_spans(ngi_header_t* ngi_header, long from, long delta);
+
+/**
+ * @brief Moves the properties of a section whose lines didn't change
+ * (**internal**)
+ *
+ * The spans are shifted by delta, the properties pointing in the old source
+ * are pointed at the same lines in the new contents and terminated there
+ *
+ * @param[in] ngi_section
+ * @param[in] delta
+ * @param[in] old_source
+ * @param[in] new_data The new contents, NULL if the strings are not moved
+ */
+void ngi_move_properties(ngi_section_t* ngi_section, long delta,
+                         const ngi_source_t* old_source, char* new_data);
+
+/**
+ * @brief Sets the spans of the lines written by ngi_dump_tree_to_file
+ * (**internal**)
+ *
+ * @param[in] ngi_header
+ */
+void ngi_update_spans(ngi_header_t* ngi_header);
+
+/**
+ * @brief Checks if the properties are parsed on first access (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return 1 if the ngi_header is lazy, 0 otherwise
+ */
+int ngi_is_lazy(const ngi_header_t* ngi_header);
+
+/**
+ * @brief Checks if the properties are loaded from a compiled image
+ * (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return 1 if the bodies of the sections are image records, 0 otherwise
+ */
+int ngi_is_compiled(const ngi_header_t* ngi_header);
+
+/**
+ * @brief Sets if the properties are loaded from a compiled image
+ * (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] compiled
+ */
+void ngi_set_compiled(ngi_header_t* ngi_header, int compiled);
+
+/**
+ * @brief Checks if the changes are only made in memory (**internal**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return 1 if a transaction is open, 0 otherwise
+ */
+int ngi_in_transaction(const ngi_header_t* ngi_header);
+
+/**
+ * @brief Opens or closes the transaction of the ngi_header (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] transaction
+ */
+void ngi_set_transaction(ngi_header_t* ngi_header, int transaction);
+
+/**
+ * @brief Gets the ngi_section parent (**internal**)
+ *
+ * @param[in] ngi_section
+ *
+ * @return The ngi_header parent
+ */
+ngi_header_t* ngi_get_section_parent(const ngi_section_t* ngi_section);
+
+/**
+ * @brief Gets the unparsed properties of a lazy ngi_section (**internal**)
+ *
+ * @param[in] ngi_section
+ * @param[out] size
+ *
+ * @return The body, NULL if the properties are parsed
+ */
+const char* ngi_get_section_body(const ngi_section_t* ngi_section,
+                                 size_t* size);
+
+/**
+ * @brief Keeps the unparsed properties of a lazy ngi_section (**internal**)
+ *
+ * The body is not copied and must live until the ngi_section is loaded
+ *
+ * @param[in] ngi_section
+ * @param[in] body
+ * @param[in] size
+ */
+void ngi_set_section_body(ngi_section_t* ngi_section, char* body, size_t size);
+
+/**
+ * @brief Checks if the properties of the ngi_section are parsed
+ * (**internal**)
+ *
+ * @param[in] ngi_section
+ *
+ * @return 1 if the properties are parsed, 0 otherwise
+ */
+int ngi_section_is_loaded(const ngi_section_t* ngi_section);
+
+/**
+ * @brief Parses the properties of a lazy ngi_section (**internal**)
+ *
+ * Nothing is done if the properties are already parsed
+ *
+ * @param[in] ngi_section
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_section_load(ngi_section_t* ngi_section);
+
+/**
+ * @brief Gets the hash of the lines of the ngi_section properties
+ * (**internal**)
+ *
+ * The hash is dropped when a property is changed in memory
+ *
+ * @param[in] ngi_section
+ * @param[out] hash
+ *
+ * @return 1 if the hash matches the properties, 0 otherwise
+ */
+int ngi_get_section_hash(const ngi_section_t* ngi_section, uint64_t* hash);
+
+/**
+ * @brief Sets the hash of the lines of the ngi_section properties
+ * (**internal**)
+ *
+ * @param[in] ngi_section
+ * @param[in] hash
+ */
+void ngi_set_section_hash(ngi_section_t* ngi_section, uint64_t hash);
+
 #ifndef NDEBUG
 /**
  * @brief Print the tree map (**debug build only**)
@@ -143,6 +563,91 @@ void ngi_print_map(const ngi_header_t* ngi_header);
  */
 int ngi_cache_file(ngi_header_t* ngi_header);
 
+/**
+ * @brief Recaches the file and tells if the tree changed (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[out] changed Set to 1 if the tree changed, can be NULL
+ * @param[out] ngi_changes Filled with the changes of the tree, can be NULL
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_recache(ngi_header_t* ngi_header, int* changed,
+                ngi_changes_t* ngi_changes);
+
+/* Changes */
+
+/**
+ * @brief Allocates an empty list of changes (**internal**)
+ *
+ * @return The ngi_changes or NULL if the allocation failed
+ */
+ngi_changes_t* ngi_changes_alloc(void);
+
+/**
+ * @brief Copies the names and hashes of the tree before a recache
+ * (**internal**)
+ *
+ * The lazy sections are not loaded
+ *
+ * @param[in] ngi_changes
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_changes_snapshot(ngi_changes_t* ngi_changes, ngi_header_t* ngi_header);
+
+/**
+ * @brief Lists the changes between the snapshot and the tree (**internal**)
+ *
+ * @param[in] ngi_changes
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_changes_diff(ngi_changes_t* ngi_changes, ngi_header_t* ngi_header);
+
+/* Concurrent */
+
+/**
+ * @brief Excludes the readers and the other writers (**internal**)
+ *
+ * Nothing is done if the ngi_header isn't concurrent
+ *
+ * @param[in] ngi_header
+ */
+void ngi_write_lock(ngi_header_t* ngi_header);
+
+/**
+ * @brief Lets the readers and the other writers in again (**internal**)
+ *
+ * @param[in] ngi_header
+ */
+void ngi_write_unlock(ngi_header_t* ngi_header);
+
+/**
+ * @brief Serializes the parsing of the lazy sections (**internal**)
+ *
+ * Nothing is done if the ngi_header isn't concurrent
+ *
+ * @param[in] ngi_header
+ */
+void ngi_load_lock(ngi_header_t* ngi_header);
+
+/**
+ * @brief Lets the other threads parse the lazy sections (**internal**)
+ *
+ * @param[in] ngi_header
+ */
+void ngi_load_unlock(ngi_header_t* ngi_header);
+
+/**
+ * @brief Frees the lock of a concurrent ngi_header (**internal**)
+ *
+ * @param[in] ngi_lock
+ */
+void ngi_lock_free(ngi_lock_t* ngi_lock);
+
 /* Create */
 
 /**
@@ -154,6 +659,95 @@ int ngi_cache_file(ngi_header_t* ngi_header);
  */
 int ngi_create(const char* restrict filename);
 
+/* Image */
+
+/**
+ * @brief Gets the name of the compiled image of a file (**internal**)
+ *
+ * @param[in] filename
+ *
+ * @return The allocated name or NULL if the allocation failed
+ */
+char* ngi_image_name(const char* filename);
+
+/**
+ * @brief Builds the sections of an empty ngi_header from an image
+ * (**internal**)
+ *
+ * The names and values point in the mapped image,
+ * the properties of a section are loaded on first access
+ *
+ * @param[in] ngi_header
+ * @param[in] image_name
+ * @param[in] stamp The version of the file, with the hash of his contents
+ *
+ * @return NGI_STATUS_FAILED if the image is missing, stale or corrupted,
+ * NGI_STATUS_SUCCESS otherwise
+ */
+int ngi_image_load(ngi_header_t* ngi_header, const char* image_name,
+                   const ngi_stamp_t* stamp);
+
+/**
+ * @brief Builds the sections of an empty ngi_header from his mapped source
+ * (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] stamp The version of the file, NULL to skip the check
+ *
+ * @return NGI_STATUS_FAILED if the image is stale or corrupted,
+ * NGI_STATUS_SUCCESS otherwise
+ */
+int ngi_image_read(ngi_header_t* ngi_header, const ngi_stamp_t* stamp);
+
+/**
+ * @brief Opens a ngi_header from an image without a file (**internal**)
+ *
+ * The ngi_header can't be recached,
+ * the file descriptor can be closed after the call
+ *
+ * @param[in] fd The open image
+ *
+ * @return The ngi_header or NULL if the image is unreadable
+ */
+ngi_header_t* ngi_attach_image(int fd);
+
+/**
+ * @brief Allocates the properties of a ngi_section from the image
+ * (**internal**)
+ *
+ * @param[in] ngi_section
+ * @param[in] body The records of the properties
+ * @param[in] size The size of the records
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_image_load_properties(ngi_section_t* ngi_section, const char* body,
+                              size_t size);
+
+/**
+ * @brief Writes the image of the tree in a stream (**internal**)
+ *
+ * @param[in] fd
+ * @param[in] ngi_header
+ * @param[in] stamp The version of the file who was parsed
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_image_dump(FILE* fd, ngi_header_t* ngi_header,
+                   const ngi_stamp_t* stamp);
+
+/**
+ * @brief Writes the image of the tree aside then renames it (**internal**)
+ *
+ * @param[in] ngi_header
+ * @param[in] image_name
+ * @param[in] stamp The version of the file who was parsed
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_image_write(ngi_header_t* ngi_header, const char* image_name,
+                    const ngi_stamp_t* stamp);
+
 /* Type */
 
 /**
@@ -25,7 +25,33 @@
 extern "C" {
 #endif
 
+#include <stdio.h>
 #include "libngi_internal.h"
+#include "type.h"
+
+/**
+ * @brief Callbacks called by the streaming parser (**internal**)
+ *
+ * Each callback is called once per line in the order of the file
+ * and returns NGI_STATUS_FAILED to stop the parsing.
+ * The name and value are NUL terminated, they are only valid during the call
+ * with ngi_parse_stream and they point in the buffer with ngi_parse_memory.
+ * The span is the position of the line from the beginning of the parsed
+ * file or buffer.
+ * The body callback is only called by ngi_parse_sections,
+ * instead of the property callback.
+ * The hash callback is called at the end of each section with the hash
+ * of the lines following the section line, before they were modified,
+ * it can be NULL.
+ */
+typedef struct ngi_parser_ops {
+    int (*section)(void* ctx, char* name, int name_len,
+                   const ngi_span_t* span);
+    int (*property)(void* ctx, char* name, int name_len, char* value,
+                    int value_len, const ngi_span_t* span);
+    int (*body)(void* ctx, char* body, size_t size);
+    int (*hash)(void* ctx, uint64_t hash);
+} ngi_parser_ops_t;
 
 /**
  * @brief Parses all the file contents (**internal**)
@@ -36,6 +62,65 @@ extern "C" {
  */
 int ngi_parse_file(ngi_header_t* ngi_header);
 
+/**
+ * @brief Parses the whole file in a single pass (**internal**)
+ *
+ * The file is read once from the beginning to the end
+ * and each section/property is given to the callbacks
+ *
+ * @param[in] fd
+ * @param[in] ops
+ * @param[in] ctx
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_parse_stream(FILE* fd, const ngi_parser_ops_t* ops, void* ctx);
+
+/**
+ * @brief Parses a buffer in place in a single pass (**internal**)
+ *
+ * The buffer must be writable and followed by a NUL byte,
+ * the end of the names and values are replaced by NUL bytes
+ *
+ * @param[in] buff
+ * @param[in] size
+ * @param[in] offset The position of the buffer in the file, added to the spans
+ * @param[in] ops
+ * @param[in] ctx
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_parse_memory(char* buff, size_t size, long offset,
+                     const ngi_parser_ops_t* ops, void* ctx);
+
+/**
+ * @brief Parses only the sections of a buffer in place (**internal**)
+ *
+ * Each section is followed by a call to the body callback
+ * with the unparsed lines up to the next section, which can be empty.
+ * Only the section lines are modified.
+ *
+ * @param[in] buff
+ * @param[in] size
+ * @param[in] ops
+ * @param[in] ctx
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_parse_sections(char* buff, size_t size, const ngi_parser_ops_t* ops,
+                       void* ctx);
+
+/**
+ * @brief Parses the properties of a lazy section (**internal**)
+ *
+ * @param[in] ngi_section
+ * @param[in] body
+ * @param[in] size
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_parse_body(ngi_section_t* ngi_section, char* body, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
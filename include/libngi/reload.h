@@ -0,0 +1,91 @@
+/**
+ * @file reload.h
+ * @brief The libgni reload header
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libngi.h"
+
+typedef struct ngi_reloader ngi_reloader_t;
+
+/**
+ * @brief Publishes the trees of a file to reader threads
+ *
+ * Each reload parses the file in a new tree and replaces the published one,
+ * so the readers never see a tree being modified.
+ * The file is mapped and fully parsed, the trees must only be read.
+ *
+ * @param[in] filename
+ *
+ * @return A new ngi_reloader or NULL if the file can't be parsed
+ */
+ngi_reloader_t* ngi_reloader_create(const char* filename);
+
+/**
+ * @brief Frees the ngi_reloader and the published tree
+ *
+ * The acquired trees must be released before
+ *
+ * @param[in] ngi_reloader
+ */
+void ngi_reloader_free(ngi_reloader_t* ngi_reloader);
+
+/**
+ * @brief Parses the file again and publishes the new tree
+ *
+ * Nothing is done when the file didn't change.
+ * The old tree is freed when his last reader releases it.
+ * The reloads are serialized, the readers are never blocked.
+ *
+ * @param[in] ngi_reloader
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_reloader_reload(ngi_reloader_t* ngi_reloader);
+
+/**
+ * @brief Gets the published tree without taking a lock
+ *
+ * The tree stays valid until it's released, even after a reload
+ *
+ * @param[in] ngi_reloader
+ *
+ * @return The ngi_header to release with ngi_reloader_release
+ */
+ngi_header_t* ngi_reloader_acquire(ngi_reloader_t* ngi_reloader);
+
+/**
+ * @brief Releases a tree given by ngi_reloader_acquire
+ *
+ * @param[in] ngi_reloader
+ * @param[in] ngi_header
+ */
+void ngi_reloader_release(ngi_reloader_t* ngi_reloader,
+                          ngi_header_t* ngi_header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RELOAD_H */
@@ -42,6 +42,9 @@ void ngi_section_replace(ngi_header_t* ngi_header, ngi_section_t* ngi_section,
  *
  * Pass NULL if you don't want to replace the name or the value
  *
+ * The file is written in place, the headers mapping it
+ * (ngi_open_mmap, ngi_open_lazy) must be recached after the change
+ *
  * @param[in] ngi_header
  * @param[in] ngi_property
  * @param[in] new_name
@@ -0,0 +1,54 @@
+/**
+ * @file save.h
+ * @brief The libgni save header
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SAVE_H
+#define SAVE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libngi.h"
+
+/* Durability of ngi_save */
+#define NGI_SYNC_NONE 0 /* The data is left in the page cache */
+#define NGI_SYNC_FILE 1 /* The new file is on the disk before the rename */
+#define NGI_SYNC_DIR  2 /* The rename itself is on the disk */
+
+/**
+ * @brief Writes the tree to the file without ever leaving it half-written
+ *
+ * The tree is written to a temporary file in the same directory
+ * who is renamed over the file, so the readers see either the old
+ * or the new file. The ngi_header then writes to the new file,
+ * and an open transaction is committed.
+ *
+ * @param[in] ngi_header
+ * @param[in] sync NGI_SYNC_NONE, NGI_SYNC_FILE or NGI_SYNC_DIR
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_save(ngi_header_t* ngi_header, int sync);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAVE_H */
@@ -0,0 +1,105 @@
+/**
+ * @file shared.h
+ * @brief The libgni shared header
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SHARED_H
+#define SHARED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libngi.h"
+
+typedef struct ngi_subscriber ngi_subscriber_t;
+
+/**
+ * @brief Publishes the tree to the other processes in shared memory
+ *
+ * The tree is written as a compiled image in a new generation
+ * of the shared memory object, whose name starts with a slash.
+ * The previous generation is removed, the processes attached to it
+ * keep using it until they close their ngi_header.
+ * The objects have the permissions of the source file,
+ * or are only readable by the user without one.
+ * A name must only have one publisher,
+ * the programs using it may need to be linked with -lrt.
+ *
+ * @param[in] ngi_header
+ * @param[in] name
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_publish(ngi_header_t* ngi_header, const char* name);
+
+/**
+ * @brief Removes the shared memory objects of a publication
+ *
+ * @param[in] name
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_unpublish(const char* name);
+
+/**
+ * @brief Follows the generations of a publication
+ *
+ * @param[in] name
+ *
+ * @return A new ngi_subscriber or NULL if nothing is published
+ */
+ngi_subscriber_t* ngi_subscribe(const char* name);
+
+/**
+ * @brief Checks if a new generation was published since the last attach
+ *
+ * @param[in] ngi_subscriber
+ *
+ * @return 1 if a new generation can be attached, 0 otherwise
+ */
+int ngi_subscriber_changed(const ngi_subscriber_t* ngi_subscriber);
+
+/**
+ * @brief Opens the last published generation
+ *
+ * The names and values are read in the shared memory without a copy,
+ * only the nodes of the tree are allocated by the process.
+ * The tree must only be read and can't be recached,
+ * it stays valid after the next generations until ngi_close.
+ *
+ * @param[in] ngi_subscriber
+ *
+ * @return The ngi_header or NULL if the generation can't be read
+ */
+ngi_header_t* ngi_subscriber_attach(ngi_subscriber_t* ngi_subscriber);
+
+/**
+ * @brief Frees the ngi_subscriber
+ *
+ * The attached trees are closed separately
+ *
+ * @param[in] ngi_subscriber
+ */
+void ngi_subscriber_free(ngi_subscriber_t* ngi_subscriber);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHARED_H */
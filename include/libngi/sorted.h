@@ -0,0 +1,197 @@
+/**
+ * @file sorted.h
+ * @brief The libgni sorted index header (**internal**)
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SORTED_H
+#define SORTED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "arena.h"
+
+/**
+ * @brief Contains an entry of the sorted index (**internal**)
+ *
+ * The ngi_sorted_entry contains:
+ * - the key (the name buffer of the node)
+ * - the indexed node
+ */
+typedef struct ngi_sorted_entry {
+    const char* key;
+    void* node;
+} ngi_sorted_entry_t;
+
+/**
+ * @brief Contains the nodes sorted by name (**internal**)
+ *
+ * The ngi_sorted_index contains:
+ * - the entries in the order of their keys,
+ *   the nodes with the same key in the order they were added
+ * - the number of entries
+ * - the allocated capacity of the entries
+ * - if the index is built, it's only maintained once built
+ * - the arena holding the entries
+ */
+typedef struct ngi_sorted_index {
+    ngi_sorted_entry_t* entries;
+    int len;
+    int capacity;
+    int built;
+    ngi_arena_t* arena;
+} ngi_sorted_index_t;
+
+/**
+ * @brief Gets the key of an indexed node (**internal**)
+ *
+ * @param[in] node
+ *
+ * @return The name buffer of the node
+ */
+typedef const char* (*ngi_sorted_key_t)(const void* node);
+
+/**
+ * @brief Initializes an empty index, not built yet (**internal**)
+ *
+ * @param[out] index
+ * @param[in] arena
+ */
+void ngi_sorted_index_init(ngi_sorted_index_t* index, ngi_arena_t* arena);
+
+/**
+ * @brief Frees the entries, the index must be built again (**internal**)
+ *
+ * @param[in] index
+ */
+void ngi_sorted_index_free(ngi_sorted_index_t* index);
+
+/**
+ * @brief Checks if the index is built (**internal**)
+ *
+ * Pairs with the end of ngi_sorted_index_build
+ *
+ * @param[in] index
+ *
+ * @return 1 if the index is built, 0 otherwise
+ */
+int ngi_sorted_index_is_built(const ngi_sorted_index_t* index);
+
+/**
+ * @brief Sorts the nodes in the index (**internal**)
+ *
+ * @param[in] index
+ * @param[in] nodes The nodes in the order they were added
+ * @param[in] len
+ * @param[in] key
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_sorted_index_build(ngi_sorted_index_t* index, void* const* nodes,
+                           int len, ngi_sorted_key_t key);
+
+/**
+ * @brief Adds a node in a built index (**internal**)
+ *
+ * Nothing is done if the index isn't built,
+ * the key must stay valid until the node is removed from the index
+ *
+ * @param[in] index
+ * @param[in] key
+ * @param[in] node
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_sorted_index_insert(ngi_sorted_index_t* index, const char* key,
+                            void* node);
+
+/**
+ * @brief Removes a node from a built index (**internal**)
+ *
+ * @param[in] index
+ * @param[in] key
+ * @param[in] node
+ */
+void ngi_sorted_index_remove(ngi_sorted_index_t* index, const char* key,
+                             const void* node);
+
+/**
+ * @brief Changes the key of a node in a built index (**internal**)
+ *
+ * The entry stays in place when it keeps its order,
+ * both keys must be valid during the call
+ *
+ * @param[in] index
+ * @param[in] old_key
+ * @param[in] new_key
+ * @param[in] node
+ */
+void ngi_sorted_index_rename(ngi_sorted_index_t* index, const char* old_key,
+                             const char* new_key, void* node);
+
+/**
+ * @brief Points the keys to the current names of the nodes (**internal**)
+ *
+ * The names must keep their order
+ *
+ * @param[in] index
+ * @param[in] key
+ */
+void ngi_sorted_index_refresh(ngi_sorted_index_t* index, ngi_sorted_key_t key);
+
+/**
+ * @brief Finds the entries between two keys (**internal**)
+ *
+ * @param[in] index
+ * @param[in] from The first key, included, NULL from the start
+ * @param[in] to The last key, excluded, NULL to the end
+ * @param[out] first The position of the first entry
+ *
+ * @return The number of entries
+ */
+int ngi_sorted_index_range(const ngi_sorted_index_t* index, const char* from,
+                           const char* to, int* first);
+
+/**
+ * @brief Finds the entries whose key starts with a prefix (**internal**)
+ *
+ * @param[in] index
+ * @param[in] prefix
+ * @param[out] first The position of the first entry
+ *
+ * @return The number of entries
+ */
+int ngi_sorted_index_prefix(const ngi_sorted_index_t* index,
+                            const char* prefix, int* first);
+
+/**
+ * @brief Gets the node at a position of the index (**internal**)
+ *
+ * @param[in] index
+ * @param[in] position
+ *
+ * @return The node or NULL if the position is out of the index
+ */
+void* ngi_sorted_index_get(const ngi_sorted_index_t* index, int position);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SORTED_H */
@@ -0,0 +1,211 @@
+/**
+ * @file source.h
+ * @brief The libgni source buffer header (**internal**)
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+/**
+ * @brief Contains the raw contents of a file parsed in place (**internal**)
+ *
+ * The ngi_source contains:
+ * - the contents, always followed by a NUL byte
+ * - the size of the contents
+ * - the size of the mapping, 0 when the contents are allocated
+ * - the mapped file, -1 when the contents are allocated
+ * - the last modification time of the mapped file
+ *
+ * The nodes of a tree parsed in place point directly in the contents,
+ * so the source lives as long as the tree
+ */
+typedef struct ngi_source {
+    char* data;
+    size_t size;
+    size_t mapped_size;
+    int fd;
+    struct timespec mtime;
+} ngi_source_t;
+
+/**
+ * @brief Identifies a version of a file (**internal**)
+ *
+ * The ngi_stamp contains:
+ * - the device and the inode of the file
+ * - the size of the file
+ * - the last modification and status change times
+ * - if the stamp was taken, 0 when the file must be read again
+ * - the hash of the contents
+ * - if the contents were hashed
+ */
+typedef struct ngi_stamp {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+    int valid;
+    uint64_t hash;
+    int hashed;
+} ngi_stamp_t;
+
+/**
+ * @brief Initializes an empty source (**internal**)
+ *
+ * @param[out] source
+ */
+void ngi_source_init(ngi_source_t* source);
+
+/**
+ * @brief Maps a file in a private writable mapping (**internal**)
+ *
+ * @param[out] source
+ * @param[in] filename
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_source_map(ngi_source_t* source, const char* filename);
+
+/**
+ * @brief Maps a file like ngi_source_map, faulting in the pages on access
+ * (**internal**)
+ *
+ * For the contents who are only read in parts
+ *
+ * @param[out] source
+ * @param[in] filename
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_source_map_sparse(ngi_source_t* source, const char* filename);
+
+/**
+ * @brief Maps an open file like ngi_source_map_sparse (**internal**)
+ *
+ * The file descriptor can be closed after the call,
+ * the source then can't tell if the file changed
+ *
+ * @param[out] source
+ * @param[in] fd
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_source_map_fd(ngi_source_t* source, int fd);
+
+/**
+ * @brief Copies a buffer in a writable allocation (**internal**)
+ *
+ * @param[out] source
+ * @param[in] buff
+ * @param[in] size
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_source_copy(ngi_source_t* source, const char* buff, size_t size);
+
+/**
+ * @brief Releases the contents of the source (**internal**)
+ *
+ * @param[in] source
+ */
+void ngi_source_free(ngi_source_t* source);
+
+/**
+ * @brief Checks if a pointer is in the contents of the source (**internal**)
+ *
+ * @param[in] source
+ * @param[in] ptr
+ *
+ * @return 1 if the pointer is in the contents, 0 otherwise
+ */
+int ngi_source_contains(const ngi_source_t* source, const void* ptr);
+
+/**
+ * @brief Checks if the mapped file was changed in place (**internal**)
+ *
+ * The pages of the mapping who were never written show the current
+ * contents of the file, or fault if the file was truncated.
+ * A file replaced by a rename is not a change, the mapping keeps
+ * the old file
+ *
+ * @param[in] source
+ *
+ * @return 1 if the file was written or truncated since it was mapped,
+ * 0 otherwise
+ */
+int ngi_source_changed(const ngi_source_t* source);
+
+/**
+ * @brief Takes the stamp of a file with one stat (**internal**)
+ *
+ * The contents are not hashed
+ * @param[out] stamp Invalid if the file can't be stat'ed
+ * @param[in] filename
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_stamp_file(ngi_stamp_t* stamp, const char* filename);
+
+/**
+ * @brief Takes the stamp of an open file with one fstat (**internal**)
+ *
+ * The contents are not hashed
+ * @param[out] stamp Invalid if the file can't be stat'ed
+ * @param[in] fd
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_stamp_fd(ngi_stamp_t* stamp, int fd);
+
+/**
+ * @brief Checks if two stamps are the same version of a file (**internal**)
+ *
+ * @param[in] a
+ * @param[in] b
+ *
+ * @return 1 if they're both valid and equal, 0 otherwise
+ */
+int ngi_stamp_equals(const ngi_stamp_t* a, const ngi_stamp_t* b);
+
+/**
+ * @brief Takes the stamp of a file with the hash of his contents
+ * (**internal**)
+ *
+ * The file is mapped read-only, his pages are not copied
+ *
+ * @param[out] stamp Invalid if the file can't be read
+ * @param[in] filename
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_stamp_hash_file(ngi_stamp_t* stamp, const char* filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOURCE_H */
@@ -0,0 +1,72 @@
+/**
+ * @file transaction.h
+ * @brief The libgni transaction header
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libngi.h"
+
+/**
+ * @brief Starts to make the changes only in memory
+ *
+ * The create and replace functions don't write to the file
+ * until ngi_commit, which writes all the changes at once.
+ * Closing the ngi_header before committing drops the changes.
+ *
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_begin(ngi_header_t* ngi_header);
+
+/**
+ * @brief Writes the changes made since ngi_begin to the file
+ *
+ * The whole tree is written in one pass over the file who is truncated,
+ * ngi_save also ends the transaction without overwriting the file.
+ * The headers mapping the file (ngi_open_mmap, ngi_open_lazy)
+ * must be recached after the commit, ngi_save keeps them valid
+ *
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_commit(ngi_header_t* ngi_header);
+
+/**
+ * @brief Drops the changes made since ngi_begin
+ *
+ * The tree is recached from the file, which is left untouched
+ *
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_rollback(ngi_header_t* ngi_header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRANSACTION_H */
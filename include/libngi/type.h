@@ -25,8 +25,57 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include "libngi.h"
 
+enum ngi_type {
+    SECTION,
+    PROPERTY,
+    UNKNOWN,
+};
+
+/**
+ * @brief Describes a line of a buffer (**internal**)
+ *
+ * The ngi_line contains:
+ * - the offset of the first byte of the line
+ * - the offset of the new line, or the size of the buffer for the last line
+ * - the offset of the first token of the line, if the type is not UNKNOWN
+ * - the ngi_type of the line
+ */
+typedef struct ngi_line {
+    size_t start;
+    size_t end;
+    size_t token;
+    enum ngi_type type;
+} ngi_line_t;
+
+/**
+ * @brief Position of a line in the parsed file (**internal**)
+ *
+ * The ngi_span contains:
+ * - the offset of the first byte of the line
+ * - the length of the line without the new line
+ */
+typedef struct ngi_span {
+    long offset;
+    int length;
+} ngi_span_t;
+
+/**
+ * @brief Describes the name and the value of a line (**internal**)
+ *
+ * The ngi_tokens contains:
+ * - the length of the name, which starts at the beginning of the line
+ * - the offset of the value, after the token
+ * - the length of the value, up to the new line
+ */
+typedef struct ngi_tokens {
+    size_t name_len;
+    size_t value_start;
+    size_t value_len;
+} ngi_tokens_t;
+
 /**
  * @brief Gets the type of the line, see ngi_type
  *
@@ -41,11 +90,39 @@ extern "C" {
  */
 enum ngi_type ngi_get_type(const char* buff);
 
-enum ngi_type {
-    SECTION,
-    PROPERTY,
-    UNKNOWN,
-};
+/**
+ * @brief Classifies the lines at the beginning of a buffer (**internal**)
+ *
+ * The new lines and the tokens are found in one sweep over the buffer,
+ * using SSE2 or AVX2 when the CPU supports it.
+ * The classification stops after max_lines lines,
+ * the next call starts after the end of the last returned line.
+ *
+ * @param[in] buff
+ * @param[in] size
+ * @param[out] lines
+ * @param[in] max_lines
+ *
+ * @return The number of classified lines
+ */
+size_t ngi_classify_lines(const char* buff, size_t size, ngi_line_t* lines,
+                          size_t max_lines);
+
+/**
+ * @brief Finds the name and the value of a line (**internal**)
+ *
+ * The spans are only set for a SECTION or a PROPERTY,
+ * a section has an empty value.
+ * The line is not modified and may end with a new line.
+ *
+ * @param[in] line
+ * @param[in] len
+ * @param[out] tokens
+ *
+ * @return The ngi_type of the line
+ */
+enum ngi_type ngi_tokenize_line(const char* line, size_t len,
+                                ngi_tokens_t* tokens);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,111 @@
+/**
+ * @file watch.h
+ * @brief The libgni watch header
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WATCH_H
+#define WATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libngi.h"
+
+typedef struct ngi_watcher ngi_watcher_t;
+
+/**
+ * @brief Called by the watcher after a recache who changed the tree
+ *
+ * @param[in] ngi_header
+ * @param[in] ngi_changes The changes of the tree, freed after the call
+ * @param[in] data The data given to ngi_watch
+ */
+typedef void (*ngi_watch_callback_t)(ngi_header_t* ngi_header,
+                                     const ngi_changes_t* ngi_changes,
+                                     void* data);
+
+/**
+ * @brief Starts a thread recaching the watched files when they change
+ *
+ * The directories of the files are watched with inotify,
+ * so the files replaced by a rename are seen too.
+ * A watcher can be shared by several headers.
+ *
+ * @return A new ngi_watcher or NULL if it can't be started
+ */
+ngi_watcher_t* ngi_watcher_create(void);
+
+/**
+ * @brief Stops the thread and frees the ngi_watcher
+ *
+ * Must not be called from a callback
+ *
+ * @param[in] ngi_watcher
+ */
+void ngi_watcher_free(ngi_watcher_t* ngi_watcher);
+
+/**
+ * @brief Recaches the file of the ngi_header each time it's written
+ *
+ * The callback is called only when the tree changed, it can be NULL.
+ * The recache and the callback run on the thread of the watcher
+ * with the lock held, so the other threads must use the ngi_header
+ * between ngi_watcher_lock and ngi_watcher_unlock.
+ *
+ * @param[in] ngi_watcher
+ * @param[in] ngi_header
+ * @param[in] callback
+ * @param[in] data Passed to the callback
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_watch(ngi_watcher_t* ngi_watcher, ngi_header_t* ngi_header,
+              ngi_watch_callback_t callback, void* data);
+
+/**
+ * @brief Stops watching the file of the ngi_header
+ *
+ * @param[in] ngi_watcher
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_unwatch(ngi_watcher_t* ngi_watcher, ngi_header_t* ngi_header);
+
+/**
+ * @brief Prevents the watcher from recaching the watched headers
+ *
+ * The lock is recursive, so it can also be taken by the callbacks
+ *
+ * @param[in] ngi_watcher
+ */
+void ngi_watcher_lock(ngi_watcher_t* ngi_watcher);
+
+/**
+ * @brief Lets the watcher recache the watched headers again
+ *
+ * @param[in] ngi_watcher
+ */
+void ngi_watcher_unlock(ngi_watcher_t* ngi_watcher);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WATCH_H */
@@ -27,6 +27,7 @@ extern "C" {
 
 #include <stdio.h>
 #include "libngi_internal.h"
+#include "type.h"
 
 /**
  * @brief Writes the section name in the file
@@ -49,6 +50,35 @@ int ngi_write_section(FILE* fd, const char* name);
  */
 int ngi_write_property(FILE* fd, const char* name, const char* value);
 
+/**
+ * @brief Writes the whole tree at the current position (**internal**)
+ *
+ * The tree is rendered in one buffer written at once
+ *
+ * @param[in] fd
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_write_tree(FILE* fd, ngi_header_t* ngi_header);
+
+/**
+ * @brief Replaces the bytes of a span in the file (**internal**)
+ *
+ * Only the bytes after the span are moved when the length changes,
+ * and the file is truncated when it gets shorter.
+ * An empty span inserts the buffer at his offset.
+ *
+ * @param[in] fd
+ * @param[in] span
+ * @param[in] buff
+ * @param[in] len
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+int ngi_write_span(FILE* fd, const ngi_span_t* span, const char* buff,
+                   size_t len);
+
 #ifdef __cplusplus
 }
 #endif
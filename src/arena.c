@@ -0,0 +1,239 @@
+/**
+ * @file arena.c
+ * @brief The libgni arena allocator implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Bump allocator holding the nodes and the strings of a tree
+ * in large contiguous blocks
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libngi/libngi.h"
+#include "libngi/libngi_internal.h"
+
+/* Sizes of the blocks, doubled for each new block */
+#define MIN_BLOCK_SIZE (4 * 1024)
+#define MAX_BLOCK_SIZE (1024 * 1024)
+
+/**
+ * @brief Contains a memory block of the arena (**private**)
+ *
+ * The ngi_arena_block contains:
+ * - the next (older) block
+ * - the size of the data
+ * - the used size of the data
+ * - the data
+ */
+struct ngi_arena_block {
+    ngi_arena_block_t* next;
+    size_t size;
+    size_t used;
+    _Alignas(NGI_ARENA_ALIGNMENT) char data[];
+};
+
+void ngi_arena_init(ngi_arena_t* arena);
+void ngi_arena_free(ngi_arena_t* arena);
+void* ngi_arena_alloc(ngi_arena_t* arena, size_t size);
+void* ngi_arena_calloc(ngi_arena_t* arena, size_t size);
+void* ngi_arena_realloc(ngi_arena_t* arena, void* ptr, size_t old_size,
+                        size_t new_size);
+void ngi_arena_release(ngi_arena_t* arena, void* ptr, size_t size);
+int ngi_arena_contains(const ngi_arena_t* arena, const void* ptr);
+char* ngi_arena_strndup(ngi_arena_t* arena, const char* str, size_t len);
+static inline size_t align_size(size_t size);
+static ngi_arena_block_t* ngi_arena_add_block(ngi_arena_t* arena,
+                                              size_t size);
+
+void ngi_arena_init(ngi_arena_t* arena) {
+    arena->blocks = NULL;
+    arena->next_block_size = MIN_BLOCK_SIZE;
+    memset(arena->free_lists, 0, sizeof(arena->free_lists));
+}
+
+void ngi_arena_free(ngi_arena_t* arena) {
+    ngi_arena_block_t* block = arena->blocks;
+
+    while (block != NULL) {
+        ngi_arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    ngi_arena_init(arena);
+}
+
+void* ngi_arena_alloc(ngi_arena_t* arena, size_t size) {
+    size = align_size(size);
+
+    /* Reuse a released allocation of the same size class */
+    const size_t class = size / NGI_ARENA_ALIGNMENT - 1;
+    if (class < NGI_ARENA_SIZE_CLASSES && arena->free_lists[class] != NULL) {
+        void* ptr = arena->free_lists[class];
+        arena->free_lists[class] = *(void**)ptr;
+        return ptr;
+    }
+
+    ngi_arena_block_t* block = arena->blocks;
+
+    /* Check if the allocation can fit in the current block */
+    if (block == NULL || block->size - block->used < size) {
+        block = ngi_arena_add_block(arena, size);
+        if (block == NULL)
+            return NULL;
+    }
+
+    void* ptr = block->data + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+void* ngi_arena_calloc(ngi_arena_t* arena, size_t size) {
+    void* ptr = ngi_arena_alloc(arena, size);
+
+    if (ptr != NULL)
+        memset(ptr, 0, size);
+
+    return ptr;
+}
+
+void* ngi_arena_realloc(ngi_arena_t* arena, void* ptr, size_t old_size,
+                        size_t new_size) {
+    if (ptr == NULL)
+        return ngi_arena_alloc(arena, new_size);
+
+    ngi_arena_block_t* block = arena->blocks;
+    const size_t aligned_size = align_size(new_size);
+    old_size = align_size(old_size);
+
+    /* Check if the allocation is already big enough */
+    if (aligned_size <= old_size)
+        return ptr;
+
+    /* Extend in place the last allocation of the current block */
+    if ((char*)ptr + old_size == block->data + block->used &&
+        aligned_size - old_size <= block->size - block->used) {
+        block->used += aligned_size - old_size;
+        return ptr;
+    }
+
+    void* new_ptr = ngi_arena_alloc(arena, new_size);
+    if (new_ptr == NULL)
+        return NULL;
+
+    memcpy(new_ptr, ptr, old_size);
+    ngi_arena_release(arena, ptr, old_size);
+
+    return new_ptr;
+}
+
+void ngi_arena_release(ngi_arena_t* arena, void* ptr, size_t size) {
+    if (ptr == NULL)
+        return;
+
+    const size_t class = align_size(size) / NGI_ARENA_ALIGNMENT - 1;
+
+    /* Bigger allocations are only reclaimed when the arena is freed */
+    if (class >= NGI_ARENA_SIZE_CLASSES)
+        return;
+
+    *(void**)ptr = arena->free_lists[class];
+    arena->free_lists[class] = ptr;
+}
+
+int ngi_arena_contains(const ngi_arena_t* arena, const void* ptr) {
+    const uintptr_t addr = (uintptr_t)ptr;
+
+    for (const ngi_arena_block_t* block = arena->blocks; block != NULL;
+         block = block->next) {
+        const uintptr_t start = (uintptr_t)block->data;
+
+        if (addr >= start && addr < start + block->size)
+            return 1;
+    }
+
+    return 0;
+}
+
+char* ngi_arena_strndup(ngi_arena_t* arena, const char* str, size_t len) {
+    char* copy = ngi_arena_alloc(arena, len + 1);
+
+    if (copy == NULL)
+        return NULL;
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    return copy;
+}
+
+/**
+ * @brief Rounds up a size to the arena alignment (**private**)
+ *
+ * @param[in] size
+ *
+ * @return The aligned size, never zero
+ */
+static inline size_t align_size(size_t size) {
+    if (size == 0)
+        size = 1;
+
+    return (size + NGI_ARENA_ALIGNMENT - 1) & ~(size_t)(NGI_ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * @brief Allocates a new block able to hold at least size bytes (**private**)
+ *
+ * Big allocations get their own block behind the current one
+ * to keep filling the current block
+ *
+ * @param[in] arena
+ * @param[in] size
+ *
+ * @return The block to allocate from
+ */
+static ngi_arena_block_t* ngi_arena_add_block(ngi_arena_t* arena,
+                                              size_t size) {
+    const int dedicated = size > arena->next_block_size / 4;
+    const size_t block_size = dedicated ? size : arena->next_block_size;
+
+    ngi_arena_block_t* block =
+        malloc(sizeof(ngi_arena_block_t) + block_size);
+    if (block == NULL)
+        return NULL;
+
+    block->size = block_size;
+    block->used = 0;
+
+    if (dedicated && arena->blocks != NULL) {
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+    } else {
+        block->next = arena->blocks;
+        arena->blocks = block;
+
+        if (arena->next_block_size < MAX_BLOCK_SIZE)
+            arena->next_block_size *= 2;
+    }
+
+    return block;
+}
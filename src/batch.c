@@ -0,0 +1,272 @@
+/**
+ * @file batch.c
+ * @brief The libgni batch implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Lookup of several properties at once, with the names hashed
+ * when the batch is created and the keys grouped by section
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libngi/libngi.h"
+#include "libngi/batch.h"
+#include "libngi/libngi_internal.h"
+
+/**
+ * @brief Contains a section searched by the batch (**private**)
+ *
+ * The ngi_batch_section contains:
+ * - the name of the section and his hash
+ * - the position of his first key in the batch
+ * - the number of his keys
+ */
+struct ngi_batch_section {
+    const char* name;
+    uint32_t hash;
+    int first;
+    int len;
+};
+
+/**
+ * @brief Contains a property searched by the batch (**private**)
+ *
+ * The ngi_batch_key contains:
+ * - the name of the property and his hash
+ * - the position of the key given to ngi_batch_create
+ */
+struct ngi_batch_key {
+    const char* name;
+    uint32_t hash;
+    int position;
+};
+
+/**
+ * @brief Contains the prepared keys of a lookup
+ *
+ * The ngi_batch contains:
+ * - the searched sections
+ * - the number of sections
+ * - the keys in the order of their sections
+ * - the number of keys
+ * - the copies of the names
+ */
+typedef struct ngi_batch {
+    struct ngi_batch_section* sections;
+    int sections_len;
+    struct ngi_batch_key* keys;
+    int keys_len;
+    char* names;
+} ngi_batch_t;
+
+ngi_batch_t* ngi_batch_create(const ngi_key_t* keys, int len);
+void ngi_batch_free(ngi_batch_t* ngi_batch);
+int ngi_batch_get_properties(const ngi_batch_t* ngi_batch,
+                             const ngi_header_t* ngi_header,
+                             ngi_property_t** properties);
+int ngi_batch_get_values(const ngi_batch_t* ngi_batch,
+                         const ngi_header_t* ngi_header, const char** values);
+static int ngi_batch_lookup(const ngi_batch_t* ngi_batch,
+                            const ngi_header_t* ngi_header,
+                            ngi_property_t** properties, const char** values);
+static ngi_section_t* ngi_batch_section_find(const ngi_batch_t* ngi_batch,
+                                             const ngi_header_t* ngi_header,
+                                             int index);
+
+ngi_batch_t* ngi_batch_create(const ngi_key_t* keys, int len) {
+    if (len < 0 || (len > 0 && keys == NULL))
+        return NULL;
+
+    size_t names_size = 0;
+    for (int i = 0; i < len; i++)
+        names_size += strlen(keys[i].section) + strlen(keys[i].property) + 2;
+
+    ngi_batch_t* ngi_batch = malloc(sizeof(ngi_batch_t));
+    if (ngi_batch == NULL)
+        return NULL;
+
+    ngi_batch->sections = malloc(len * sizeof(struct ngi_batch_section));
+    ngi_batch->sections_len = 0;
+    ngi_batch->keys = malloc(len * sizeof(struct ngi_batch_key));
+    ngi_batch->keys_len = len;
+    ngi_batch->names = malloc(names_size);
+
+    /* The section of each key, before they're grouped */
+    int* groups = malloc(len * sizeof(int));
+
+    if ((len != 0 && (ngi_batch->sections == NULL ||
+                      ngi_batch->keys == NULL || groups == NULL)) ||
+        (names_size != 0 && ngi_batch->names == NULL)) {
+        free(groups);
+        ngi_batch_free(ngi_batch);
+        return NULL;
+    }
+
+    char* names = ngi_batch->names;
+
+    for (int i = 0; i < len; i++) {
+        int group = 0;
+
+        /* The batches are small, the sections are compared once here */
+        while (group < ngi_batch->sections_len &&
+               strcmp(ngi_batch->sections[group].name, keys[i].section))
+            group++;
+
+        if (group == ngi_batch->sections_len) {
+            const size_t size = strlen(keys[i].section) + 1;
+            struct ngi_batch_section* section = &ngi_batch->sections[group];
+
+            section->name = memcpy(names, keys[i].section, size);
+            section->hash = ngi_hash_string(section->name);
+            section->len = 0;
+            names += size;
+            ngi_batch->sections_len++;
+        }
+
+        ngi_batch->sections[group].len++;
+        groups[i] = group;
+    }
+
+    /* Place the keys after those of the previous sections */
+    int first = 0;
+    for (int i = 0; i < ngi_batch->sections_len; i++) {
+        ngi_batch->sections[i].first = first;
+        first += ngi_batch->sections[i].len;
+        ngi_batch->sections[i].len = 0;
+    }
+
+    for (int i = 0; i < len; i++) {
+        struct ngi_batch_section* section = &ngi_batch->sections[groups[i]];
+        struct ngi_batch_key* key =
+            &ngi_batch->keys[section->first + section->len];
+        const size_t size = strlen(keys[i].property) + 1;
+
+        key->name = memcpy(names, keys[i].property, size);
+        key->hash = ngi_hash_string(key->name);
+        key->position = i;
+        names += size;
+        section->len++;
+    }
+
+    free(groups);
+
+    return ngi_batch;
+}
+
+void ngi_batch_free(ngi_batch_t* ngi_batch) {
+    if (ngi_batch == NULL)
+        return;
+
+    free(ngi_batch->sections);
+    free(ngi_batch->keys);
+    free(ngi_batch->names);
+    free(ngi_batch);
+}
+
+int ngi_batch_get_properties(const ngi_batch_t* ngi_batch,
+                             const ngi_header_t* ngi_header,
+                             ngi_property_t** properties) {
+    return ngi_batch_lookup(ngi_batch, ngi_header, properties, NULL);
+}
+
+int ngi_batch_get_values(const ngi_batch_t* ngi_batch,
+                         const ngi_header_t* ngi_header, const char** values) {
+    return ngi_batch_lookup(ngi_batch, ngi_header, NULL, values);
+}
+
+/**
+ * @brief Finds the keys of all the sections (**private**)
+ *
+ * The next section is found while the properties of the current one
+ * are searched, so the memory accesses overlap
+ *
+ * @param[in] ngi_batch
+ * @param[in] ngi_header
+ * @param[out] properties The properties of the keys, or NULL
+ * @param[out] values The values of the keys, or NULL
+ *
+ * @return The number of found keys
+ */
+static int ngi_batch_lookup(const ngi_batch_t* ngi_batch,
+                            const ngi_header_t* ngi_header,
+                            ngi_property_t** properties, const char** values) {
+    int found = 0;
+
+    for (int i = 0; i < ngi_batch->sections_len; i++)
+        ngi_prefetch_section(ngi_header, ngi_batch->sections[i].hash);
+
+    ngi_section_t* next = ngi_batch_section_find(ngi_batch, ngi_header, 0);
+
+    for (int i = 0; i < ngi_batch->sections_len; i++) {
+        const struct ngi_batch_section* section = &ngi_batch->sections[i];
+        ngi_section_t* ngi_section = next;
+
+        next = ngi_batch_section_find(ngi_batch, ngi_header, i + 1);
+
+        for (int j = section->first; j < section->first + section->len; j++) {
+            const struct ngi_batch_key* key = &ngi_batch->keys[j];
+            ngi_property_t* ngi_property =
+                ngi_section == NULL
+                    ? NULL
+                    : ngi_get_property_by_hash(ngi_section, key->name,
+                                               key->hash);
+
+            if (ngi_property != NULL)
+                found++;
+
+            if (properties != NULL)
+                properties[key->position] = ngi_property;
+            if (values != NULL)
+                values[key->position] =
+                    ngi_property == NULL ? NULL
+                                         : ngi_get_property_value(ngi_property);
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief Finds a section and loads the slots of his keys (**private**)
+ *
+ * @param[in] ngi_batch
+ * @param[in] ngi_header
+ * @param[in] index The position of the section in the batch
+ *
+ * @return The ngi_section or NULL if it's not in the tree
+ */
+static ngi_section_t* ngi_batch_section_find(const ngi_batch_t* ngi_batch,
+                                             const ngi_header_t* ngi_header,
+                                             int index) {
+    if (index >= ngi_batch->sections_len)
+        return NULL;
+
+    const struct ngi_batch_section* section = &ngi_batch->sections[index];
+    ngi_section_t* ngi_section =
+        ngi_get_section_by_hash(ngi_header, section->name, section->hash);
+
+    if (ngi_section != NULL) {
+        for (int i = section->first; i < section->first + section->len; i++)
+            ngi_prefetch_property(ngi_section, ngi_batch->keys[i].hash);
+    }
+
+    return ngi_section;
+}
@@ -32,233 +32,487 @@
 
 int ngi_cache_file(ngi_header_t* ngi_header);
 int ngi_recache_file(ngi_header_t* ngi_header);
+int ngi_recache(ngi_header_t* ngi_header, int* changed,
+                ngi_changes_t* ngi_changes);
 
 /* Recache sub functions */
-static inline int create_section_if_needeed(ngi_header_t* ngi_header,
-                                            ngi_section_t* ngi_section,
-                                            uint processed_sections,
-                                            uint processed_properties,
-                                            uint max_sections, char* buff);
-static inline void remove_unused_sections(ngi_header_t* ngi_header,
-                                          uint processed_sections,
-                                          uint max_sections);
-
-static inline ngi_property_t*
-create_property_if_needeed(ngi_header_t* ngi_header, ngi_section_t* ngi_section,
-                           uint processed_properties, int max_properties,
-                           const char* name, const char* value);
-
-static inline int remove_unused_properties(ngi_header_t* ngi_header,
-                                           ngi_section_t* ngi_section,
-                                           uint processed_properties,
-                                           int max_properties);
+static int recache_tree(ngi_header_t* ngi_header, int* changed,
+                        ngi_changes_t* ngi_changes);
+static int recache_section(void* ctx, char* name, int name_len,
+                           const ngi_span_t* span);
+static int recache_property(void* ctx, char* name, int name_len, char* value,
+                            int value_len, const ngi_span_t* span);
+static int recache_body(void* ctx, char* body, size_t size);
+static inline int remove_unused_sections(ngi_header_t* ngi_header,
+                                         int processed_sections);
+static inline int remove_unused_properties(ngi_section_t* ngi_section,
+                                           int processed_properties);
+
+/**
+ * @brief Stores the current location on the tree while recaching (**private**)
+ *
+ * data is the new contents of the file when they're mapped,
+ * the nodes are pointed in them when views is set,
+ * new_section is set when the current section is created by the recache,
+ * moved is the shift of the lines of the current section in the file,
+ * changed is set when the tree is not the same as before
+ */
+struct recache_state {
+    ngi_header_t* ngi_header;
+    ngi_section_t* current_section;
+    char* data;
+    int processed_sections;
+    int processed_properties;
+    int views;
+    int new_section;
+    long moved;
+    int changed;
+};
 
 inline int ngi_cache_file(ngi_header_t* ngi_header) {
+    const char* filename = ngi_get_filename(ngi_header);
+    const ngi_source_t* source = ngi_get_source(ngi_header);
+    FILE* fd = ngi_get_file(ngi_header);
+
+    /* Stamp the file before reading it, a change while parsing
+     * is then seen by the next recache.
+     * The open file is stamped rather than the path,
+     * who may already name a file renamed over it
+     */
+    if (filename != NULL && fd != NULL)
+        ngi_stamp_fd(ngi_get_stamp(ngi_header), fileno(fd));
+    else if (filename != NULL && source->fd != -1)
+        ngi_stamp_fd(ngi_get_stamp(ngi_header), source->fd);
+    else if (filename != NULL)
+        ngi_stamp_file(ngi_get_stamp(ngi_header), filename);
+
     int res = ngi_parse_file(ngi_header);
+    if (!res)
+        ngi_get_stamp(ngi_header)->valid = 0;
+
     return res;
 }
 
 int ngi_recache_file(ngi_header_t* ngi_header) {
+    return ngi_recache(ngi_header, NULL, NULL);
+}
+
+int ngi_recache(ngi_header_t* ngi_header, int* changed,
+                ngi_changes_t* ngi_changes) {
+    /* The readers can't see the nodes while they're moved */
+    ngi_write_lock(ngi_header);
+    const int res = recache_tree(ngi_header, changed, ngi_changes);
+    ngi_write_unlock(ngi_header);
+
+    return res;
+}
+
+/**
+ * @brief Updates the tree with the ngi_header locked (**private**)
+ *
+ * @param[in] ngi_header
+ * @param[out] changed
+ * @param[out] ngi_changes
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int recache_tree(ngi_header_t* ngi_header, int* changed,
+                        ngi_changes_t* ngi_changes) {
     FILE* fd = ngi_get_file(ngi_header);
-    char buff[NGI_MAX_LINE_LENGTH];
-
-    /* Store the current location on the tree */
-    uint processed_sections = 0;
-    uint processed_properties = 0;
-
-    /* Store the maximum number of expected nodes on the tree */
-    uint max_sections = ngi_get_sections_number(ngi_header);
-    /* The value is changed for each sections */
-    uint max_properties = 0;
-
-    /* Store the current section and the current property */
-    ngi_section_t* current_section = NULL;
-    ngi_property_t* current_property = NULL;
-
-    /* Go to the beginning of the file to cache the whole file */
-    rewind(fd);
-    while (!feof(fd)) {
-        fgets(buff, NGI_MAX_LINE_LENGTH, fd);
-
-        if (ngi_get_type(buff) == SECTION) {
-            ngi_strip_section_name(buff);
-
-            /* Remove old properties */
-            if (remove_unused_properties(ngi_header, current_section,
-                                         processed_properties,
-                                         max_properties)) {
-                continue;
+    ngi_source_t* source = ngi_get_source(ngi_header);
+    ngi_source_t new_source;
+    ngi_stamp_t* stamp = ngi_get_stamp(ngi_header);
+    ngi_stamp_t new_stamp = {.valid = 0, .hashed = 0};
+    const char* filename = ngi_get_filename(ngi_header);
+    const int check = ngi_get_recache_check(ngi_header);
+    int mapped = 0;
+    int res = 0;
+
+    const ngi_parser_ops_t ops = {
+        .section = recache_section,
+        .property = recache_property,
+        .body = recache_body,
+    };
+    struct recache_state state = {
+        .ngi_header = ngi_header,
+        .current_section = NULL,
+        .data = NULL,
+        .processed_sections = 0,
+        .processed_properties = 0,
+        .views = 0,
+        .new_section = 0,
+        .moved = 0,
+        .changed = 0,
+    };
+
+    if (changed != NULL)
+        *changed = 0;
+
+    /* The file doesn't have the changes of the transaction yet */
+    if (ngi_in_transaction(ngi_header))
+        return 0;
+
+    /* A parsed buffer has no file to read again */
+    if (source->data != NULL && filename == NULL)
+        return 0;
+
+    /* Skip the parsing when the file didn't change */
+    if (filename != NULL && check != NGI_RECACHE_ALWAYS &&
+        ngi_stamp_file(&new_stamp, filename)) {
+        if (check == NGI_RECACHE_STAT && ngi_stamp_equals(&new_stamp, stamp))
+            return 1;
+
+        if (check == NGI_RECACHE_HASH) {
+            if (!ngi_source_map(&new_source, filename))
+                return 0;
+
+            mapped = 1;
+            new_stamp.hash = ngi_hash_bytes(new_source.data, new_source.size);
+            new_stamp.hashed = 1;
+
+            if (stamp->valid && stamp->hashed &&
+                stamp->hash == new_stamp.hash) {
+                ngi_source_free(&new_source);
+                *stamp = new_stamp;
+
+                /* The same contents may be in a new file */
+                return ngi_reopen_file(ngi_header);
             }
+        }
+    }
 
-            /* Check if we need to create a new section */
-            if (create_section_if_needeed(
-                    ngi_header, current_section, processed_sections,
-                    processed_properties, max_sections, buff)) {
-                continue;
+    /* The bodies of a compiled image can't be compared with the file */
+    if (ngi_is_compiled(ngi_header)) {
+        for (int i = 0; i < ngi_get_sections_number(ngi_header); i++) {
+            if (!ngi_section_load(ngi_get_section(ngi_header, i))) {
+                if (mapped)
+                    ngi_source_free(&new_source);
+                return 0;
             }
+        }
+    }
+
+    /* Keep the old tree to compare it with the new one */
+    if (ngi_changes != NULL && !ngi_changes_snapshot(ngi_changes, ngi_header)) {
+        if (mapped)
+            ngi_source_free(&new_source);
+        return 0;
+    }
 
-            /* Core of the loop for a section */
+    /* Update the tree while reading the file once,
+     * only the sections whose lines changed are parsed again
+     */
+    if (source->data != NULL || (fd != NULL && filename != NULL)) {
+        /* Read the new file when it was replaced by a rename */
+        if (source->data == NULL && !ngi_reopen_file(ngi_header)) {
+            if (mapped)
+                ngi_source_free(&new_source);
+            return 0;
+        }
+
+        /* Map the new contents of the file */
+        if (!mapped && !ngi_source_map(&new_source, filename))
+            return 0;
 
-            /* Reset properties count */
-            processed_properties = 0;
+        /* The nodes of a read file keep copies of the strings */
+        mapped = 1;
+        state.views = source->data != NULL;
+        state.data = new_source.data;
 
-            /* Get the next section to process */
-            current_section = ngi_get_section(ngi_header, processed_sections);
+        res = ngi_parse_sections(new_source.data, new_source.size, &ops,
+                                 &state);
+    } else if (fd != NULL) {
+        /* A stream without a name can only be read again */
+        if (mapped)
+            ngi_source_free(&new_source);
+        mapped = 0;
 
-            /* Store the max properties count */
-            max_properties = ngi_get_properties_number(current_section);
+        res = ngi_parse_stream(fd, &ops, &state);
+    }
+
+    /* Drop the whole tree if it's partially updated
+     * as some nodes may point to the old source
+     */
+    if (!res && state.views)
+        state.processed_sections = 0;
+
+    /* Remove the nodes who are no longer in the file */
+    if (state.current_section != NULL &&
+        remove_unused_properties(state.current_section,
+                                 state.processed_properties))
+        state.changed = 1;
+    if (remove_unused_sections(ngi_header, state.processed_sections))
+        state.changed = 1;
+
+    if (changed != NULL)
+        *changed = state.changed;
+
+    /* The diff is only needed when a node changed */
+    if (res && state.changed && ngi_changes != NULL)
+        res = ngi_changes_diff(ngi_changes, ngi_header);
+
+    /* Nothing points to the old source anymore */
+    if (state.views) {
+        ngi_source_free(source);
+        *source = new_source;
+        ngi_set_compiled(ngi_header, 0);
+    } else if (mapped) {
+        ngi_source_free(&new_source);
+    }
 
-            /* Check if the name has been modified */
-            if (strcmp(ngi_get_section_name(current_section), buff))
-                ngi_set_section_name(current_section, buff);
+    /* The tree is now the version of the file stamped before reading it */
+    *stamp = new_stamp;
+    if (!res)
+        stamp->valid = 0;
 
-            /* We have processed a section, ready to process his properties */
-            processed_sections++;
+    return res;
+}
 
-        } else if (ngi_get_type(buff) == PROPERTY) {
-            char* name = buff;
-            char value[NGI_MAX_LINE_LENGTH];
+/**
+ * @brief Updates or creates the ngi_section at the current location
+ * (**private**)
+ *
+ * @param[in] ctx
+ * @param[in] name
+ * @param[in] name_len
+ * @param[in] span
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int recache_section(void* ctx, char* name, int name_len,
+                           const ngi_span_t* span) {
+    struct recache_state* state = ctx;
+    ngi_header_t* ngi_header = state->ngi_header;
 
-            /* Strip the freshly acquired name and value */
-            strcpy(value, name);
-            ngi_strip_property_name(name);
-            ngi_strip_property_value(value);
+    /* Remove old properties of the previous section */
+    if (state->current_section != NULL &&
+        remove_unused_properties(state->current_section,
+                                 state->processed_properties))
+        state->changed = 1;
 
-            current_property = create_property_if_needeed(
-                ngi_header, current_section, processed_properties,
-                max_properties, name, value);
-            if (current_property == NULL)
-                /* Get the next property to process */
-                current_property =
-                    ngi_get_property(current_section, processed_properties);
-            else
-                continue;
+    /* Reset properties count */
+    state->processed_properties = 0;
 
-            /* Core of the loop for a property */
+    /* Check if we need to create a new section */
+    state->new_section =
+        state->processed_sections >= ngi_get_sections_number(ngi_header);
 
-            /* Check if the name has been modified */
-            if (strcmp(ngi_get_property_name(current_property), name))
-                ngi_set_property_name(current_property, name);
+    /* The lines of an existing section move with the end of his line */
+    if (!state->new_section) {
+        const ngi_span_t* old_span = ngi_get_section_span(
+            ngi_get_section(ngi_header, state->processed_sections));
 
-            /* Check if the value has been modified */
-            if (strcmp(ngi_get_property_value(current_property), value))
-                ngi_set_property_value(current_property, value);
+        state->moved = (span->offset + span->length) -
+                       (old_span->offset + old_span->length);
+    }
 
-            /* We have processed a property */
-            processed_properties++;
+    if (state->new_section) {
+        state->changed = 1;
+        state->current_section =
+            state->views ? ngi_section_alloc_view(ngi_header, name, name_len)
+                         : ngi_section_alloc(ngi_header, name);
+        if (state->current_section == NULL)
+            return 0;
+    } else {
+        /* Get the next section to process */
+        state->current_section =
+            ngi_get_section(ngi_header, state->processed_sections);
+
+        /* Check if the name has been modified */
+        if (strcmp(ngi_get_section_name(state->current_section), name)) {
+            state->changed = 1;
+
+            if (!state->views)
+                ngi_set_section_name(state->current_section, name);
         }
+
+        /* Point to the new source */
+        if (state->views)
+            ngi_set_section_name_view(state->current_section, name, name_len);
     }
 
-    /* Check if we need to remove unused sections */
-    remove_unused_sections(ngi_header, processed_sections, max_sections);
+    ngi_set_section_span(state->current_section, span);
+
+    /* We have processed a section, ready to process his properties */
+    state->processed_sections++;
 
     return 1;
 }
 
 /**
- * @brief Creates a new ngi_section if needed (**private**)
+ * @brief Updates or creates the ngi_property at the current location
+ * (**private**)
  *
- * @param[in] ngi_header
- * @param[out] ngi_section
- * @param processed
- * @param max
- * @param[in] buff
+ * @param[in] ctx
+ * @param[in] name
+ * @param[in] name_len
+ * @param[in] value
+ * @param[in] value_len
+ * @param[in] span
  *
  * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
  */
-static inline int create_section_if_needeed(ngi_header_t* ngi_header,
-                                            ngi_section_t* ngi_section,
-                                            uint processed_sections,
-                                            uint processed_properties,
-                                            uint max_sections, char* buff) {
-    /* Check if we need to create a new section */
-    if (processed_sections >= max_sections) {
-        ngi_section = ngi_create_section(ngi_header, buff);
-        processed_sections++;
-
-        /* Reset properties count */
-        processed_properties = 0;
-
-        /* Return 1 to trigger the continue keyword */
+static int recache_property(void* ctx, char* name, int name_len, char* value,
+                            int value_len, const ngi_span_t* span) {
+    struct recache_state* state = ctx;
+    ngi_section_t* ngi_section = state->current_section;
+    ngi_property_t* ngi_property;
+
+    /* Skip the properties outside of a section */
+    if (ngi_section == NULL)
         return 1;
+
+    /* Check if we need to create a new property */
+    if (state->processed_properties >= ngi_get_properties_number(ngi_section)) {
+        state->changed = 1;
+        ngi_property =
+            state->views ? ngi_property_alloc_view(ngi_section, name, name_len,
+                                                   value, value_len)
+                         : ngi_property_alloc(ngi_section, name, value);
+        if (ngi_property == NULL)
+            return 0;
+    } else {
+        /* Get the next property to process */
+        ngi_property =
+            ngi_get_property(ngi_section, state->processed_properties);
+
+        /* Check if the name or the value has been modified */
+        const int name_changed = strcmp(ngi_get_property_name(ngi_property), name);
+        const int value_changed =
+            strcmp(ngi_get_property_value(ngi_property), value);
+
+        if (name_changed || value_changed)
+            state->changed = 1;
+
+        if (state->views) {
+            /* Point to the new source */
+            ngi_set_property_view(ngi_property, name, name_len, value,
+                                  value_len);
+        } else {
+            if (name_changed)
+                ngi_set_property_name(ngi_property, name);
+            if (value_changed)
+                ngi_set_property_value(ngi_property, value);
+        }
     }
 
-    /* Return 0 to do the rest of the loop */
-    return 0;
+    ngi_set_property_span(ngi_property, span);
+
+    /* We have processed a property */
+    state->processed_properties++;
+
+    return 1;
 }
 
 /**
- * @brief Removes all unused sections/removed sections (**private**)
+ * @brief Updates the properties of the current section (**private**)
  *
- * @param[in] ngi_header
- * @param[in] processed
- * @param[in] max
+ * The loaded sections are updated now to keep their ngi_properties,
+ * only when the hash of their lines changed.
+ * The other sections of a lazy header keep the new body
+ * to parse it on first access
+ *
+ * @param[in] ctx
+ * @param[in] body
+ * @param[in] size
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
  */
-static inline void remove_unused_sections(ngi_header_t* ngi_header,
-                                          uint processed_sections,
-                                          uint max_sections) {
-    if (processed_sections < max_sections) {
-        for (int i = processed_sections; i < max_sections; i++)
-            ngi_section_free(ngi_header, ngi_get_section(ngi_header, i));
+static int recache_body(void* ctx, char* body, size_t size) {
+    struct recache_state* state = ctx;
+    ngi_section_t* ngi_section = state->current_section;
+    ngi_header_t* ngi_header = state->ngi_header;
+
+    if (ngi_is_lazy(ngi_header) &&
+        (state->new_section || !ngi_section_is_loaded(ngi_section))) {
+        /* The properties are compared through the bodies */
+        size_t old_size;
+        const char* old_body = ngi_get_section_body(ngi_section, &old_size);
+
+        if (!state->new_section &&
+            (old_size != size || memcmp(old_body, body, size)))
+            state->changed = 1;
+
+        ngi_set_section_body(ngi_section, body, size);
+        return 1;
+    }
+
+    /* Hash the lines before the parser writes in them */
+    const uint64_t hash = ngi_hash_bytes(body, size);
+    uint64_t old_hash;
+
+    /* The properties are the same, only their position changed */
+    if (!state->new_section && ngi_get_section_hash(ngi_section, &old_hash) &&
+        old_hash == hash) {
+        ngi_move_properties(ngi_section, state->moved,
+                            ngi_get_source(ngi_header),
+                            state->views ? state->data : NULL);
+        state->processed_properties = ngi_get_properties_number(ngi_section);
+        return 1;
     }
+
+    /* The body has no section line, it starts after it in the file */
+    const ngi_parser_ops_t ops = {
+        .section = recache_section,
+        .property = recache_property,
+    };
+    const ngi_span_t* span = ngi_get_section_span(ngi_section);
+
+    if (!ngi_parse_memory(body, size, span->offset + span->length + 1, &ops,
+                          state))
+        return 0;
+
+    /* Remove the old properties now, so the hash is kept */
+    if (remove_unused_properties(ngi_section, state->processed_properties))
+        state->changed = 1;
+
+    ngi_set_section_hash(ngi_section, hash);
+
+    return 1;
 }
 
 /**
- * @brief Creates a new ngi_property if needed (**private**)
+ * @brief Removes all unused sections/removed sections (**private**)
  *
  * @param[in] ngi_header
- * @param[in] ngi_section
- * @param processed
- * @param[in] max
- * @param[in] name
- * @param[in] value
+ * @param[in] processed_sections
  *
- * @return The newly created ngi_property
+ * @return The number of removed sections
  */
-static inline ngi_property_t*
-create_property_if_needeed(ngi_header_t* ngi_header, ngi_section_t* ngi_section,
-                           uint processed_properties, int max_properties,
-                           const char* name, const char* value)
-
-{
-    if (processed_properties >= max_properties) {
-        ngi_property_t* ngi_property =
-            ngi_create_property(ngi_header, ngi_section, name, value);
-        processed_properties++;
-
-        /* Return the property to trigger the continue keyword */
-        return ngi_property;
-    }
+static inline int remove_unused_sections(ngi_header_t* ngi_header,
+                                         int processed_sections) {
+    const int sections_number = ngi_get_sections_number(ngi_header);
 
-    /* Return 0 to do the rest of the loop */
-    return NULL;
+    /* Remove from the end to avoid balancing the array */
+    for (int i = sections_number - 1; i >= processed_sections; i--)
+        ngi_section_free(ngi_header, ngi_get_section(ngi_header, i));
+
+    return sections_number > processed_sections
+               ? sections_number - processed_sections
+               : 0;
 }
 
 /**
  * @brief Removes all unused properties/removed properties (**private**)
  *
- * @param[in] ngi_header
  * @param[in] ngi_section
- * @param processed
- * @param[in] max
+ * @param[in] processed_properties
  *
- * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ * @return The number of removed properties
  */
-static inline int remove_unused_properties(ngi_header_t* ngi_header,
-                                           ngi_section_t* ngi_section,
-                                           uint processed_properties,
-                                           int max_properties) {
-    if (processed_properties < max_properties) {
-        for (int i = processed_properties; i < max_properties; i++)
-            ngi_property_free(ngi_section, ngi_get_property(ngi_section, i));
-
-        /* Reset properties count */
-        processed_properties = 0;
-
-        /* Return 1 to trigger the continue keyword */
-        return 1;
-    }
+static inline int remove_unused_properties(ngi_section_t* ngi_section,
+                                           int processed_properties) {
+    /* The properties of a lazy section are not parsed yet */
+    if (!ngi_section_is_loaded(ngi_section))
+        return 0;
+
+    const int properties_number = ngi_get_properties_number(ngi_section);
+
+    /* Remove from the end to avoid balancing the array */
+    for (int i = properties_number - 1; i >= processed_properties; i--)
+        ngi_property_free(ngi_section, ngi_get_property(ngi_section, i));
 
-    /* Return 0 to do the rest of the loop */
-    return 0;
+    return properties_number > processed_properties
+               ? properties_number - processed_properties
+               : 0;
 }
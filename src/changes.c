@@ -0,0 +1,526 @@
+/**
+ * @file changes.c
+ * @brief The libgni changes implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * List of the changes made by a recache
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libngi/libngi.h"
+#include "libngi/changes.h"
+#include "libngi/libngi_internal.h"
+
+/* Multiplier mixing the hashes of the properties of a section */
+#define COMBINE_PRIME 0x9e3779b97f4a7c15ull
+
+/**
+ * @brief Contains a section before the recache (**private**)
+ *
+ * The ngi_old_section contains:
+ * - a copy of the name
+ * - the hash of the properties, or of the body if they're not parsed
+ * - if the properties are parsed
+ * - the index of the first property and the number of properties
+ * - if a section of the new tree has the same name or was renamed from it
+ */
+struct ngi_old_section {
+    const char* name;
+    uint64_t hash;
+    int loaded;
+    int first_property;
+    int properties_number;
+    int matched;
+};
+
+/**
+ * @brief Contains a property before the recache (**private**)
+ *
+ * The ngi_old_property contains:
+ * - a copy of the name
+ * - the hash of the value
+ * - if a property of the new tree has the same name or was renamed from it
+ */
+struct ngi_old_property {
+    const char* name;
+    uint64_t hash;
+    int matched;
+};
+
+/**
+ * @brief Contains the changes of a recache
+ *
+ * The ngi_changes contains:
+ * - the arena holding the changes, their strings and the snapshot
+ * - a growable array of changes
+ * - the current length of the changes array
+ * - the allocated capacity of the changes array
+ * - the sections of the tree before the recache
+ * - the number of sections before the recache
+ * - the properties of the tree before the recache
+ * - the number of properties before the recache
+ */
+typedef struct ngi_changes {
+    ngi_arena_t arena;
+    ngi_change_t* changes;
+    int changes_len;
+    int changes_capacity;
+    struct ngi_old_section* sections;
+    int sections_len;
+    struct ngi_old_property* properties;
+    int properties_len;
+} ngi_changes_t;
+
+int ngi_recache_changes(ngi_header_t* ngi_header, ngi_changes_t** ngi_changes);
+int ngi_get_changes_number(const ngi_changes_t* ngi_changes);
+const ngi_change_t* ngi_get_change(const ngi_changes_t* ngi_changes,
+                                   int change_num);
+void ngi_changes_free(ngi_changes_t* ngi_changes);
+ngi_changes_t* ngi_changes_alloc(void);
+int ngi_changes_snapshot(ngi_changes_t* ngi_changes, ngi_header_t* ngi_header);
+int ngi_changes_diff(ngi_changes_t* ngi_changes, ngi_header_t* ngi_header);
+static uint64_t ngi_section_hash(const ngi_section_t* ngi_section);
+static uint64_t ngi_value_hash(const ngi_property_t* ngi_property);
+static int ngi_diff_properties(ngi_changes_t* ngi_changes,
+                               ngi_hash_table_t* index,
+                               const struct ngi_old_section* old_section,
+                               const ngi_section_t* ngi_section);
+static int ngi_changes_add(ngi_changes_t* ngi_changes, int type,
+                           const char* section, const char* property,
+                           const char* old_name);
+
+int ngi_recache_changes(ngi_header_t* ngi_header, ngi_changes_t** ngi_changes) {
+    if (ngi_header == NULL || ngi_changes == NULL)
+        return 0;
+
+    *ngi_changes = ngi_changes_alloc();
+    if (*ngi_changes == NULL)
+        return 0;
+
+    if (!ngi_recache(ngi_header, NULL, *ngi_changes)) {
+        ngi_changes_free(*ngi_changes);
+        *ngi_changes = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+int ngi_get_changes_number(const ngi_changes_t* ngi_changes) {
+    return ngi_changes->changes_len;
+}
+
+const ngi_change_t* ngi_get_change(const ngi_changes_t* ngi_changes,
+                                   int change_num) {
+    /* Check if the index is valid */
+    if (change_num < 0 || change_num >= ngi_changes->changes_len)
+        return NULL;
+
+    return &ngi_changes->changes[change_num];
+}
+
+void ngi_changes_free(ngi_changes_t* ngi_changes) {
+    if (ngi_changes == NULL)
+        return;
+
+    ngi_arena_free(&ngi_changes->arena);
+    free(ngi_changes);
+}
+
+ngi_changes_t* ngi_changes_alloc(void) {
+    ngi_changes_t* ngi_changes = malloc(sizeof(ngi_changes_t));
+
+    if (ngi_changes == NULL)
+        return NULL;
+
+    ngi_arena_init(&ngi_changes->arena);
+    ngi_changes->changes = NULL;
+    ngi_changes->changes_len = 0;
+    ngi_changes->changes_capacity = 0;
+    ngi_changes->sections = NULL;
+    ngi_changes->sections_len = 0;
+    ngi_changes->properties = NULL;
+    ngi_changes->properties_len = 0;
+
+    return ngi_changes;
+}
+
+int ngi_changes_snapshot(ngi_changes_t* ngi_changes, ngi_header_t* ngi_header) {
+    ngi_arena_t* arena = &ngi_changes->arena;
+    const int sections_number = ngi_get_sections_number(ngi_header);
+    int properties_number = 0;
+
+    /* Count the parsed properties without parsing the others */
+    for (int i = 0; i < sections_number; i++) {
+        const ngi_section_t* ngi_section = ngi_get_section(ngi_header, i);
+
+        if (ngi_section_is_loaded(ngi_section))
+            properties_number += ngi_get_properties_number(ngi_section);
+    }
+
+    ngi_changes->sections = ngi_arena_alloc(
+        arena, (sections_number + 1) * sizeof(struct ngi_old_section));
+    ngi_changes->properties = ngi_arena_alloc(
+        arena, (properties_number + 1) * sizeof(struct ngi_old_property));
+
+    if (ngi_changes->sections == NULL || ngi_changes->properties == NULL)
+        return 0;
+
+    /* The names are copied as the recache changes them in place */
+    for (int i = 0; i < sections_number; i++) {
+        const ngi_section_t* ngi_section = ngi_get_section(ngi_header, i);
+        struct ngi_old_section* old_section = &ngi_changes->sections[i];
+
+        old_section->name =
+            ngi_arena_strndup(arena, ngi_get_section_name(ngi_section),
+                              ngi_get_section_name_len(ngi_section));
+        if (old_section->name == NULL)
+            return 0;
+
+        old_section->hash = ngi_section_hash(ngi_section);
+        old_section->loaded = ngi_section_is_loaded(ngi_section);
+        old_section->first_property = ngi_changes->properties_len;
+        old_section->properties_number = 0;
+        old_section->matched = 0;
+
+        if (!old_section->loaded)
+            continue;
+
+        old_section->properties_number =
+            ngi_get_properties_number(ngi_section);
+
+        for (int j = 0; j < old_section->properties_number; j++) {
+            const ngi_property_t* ngi_property =
+                ngi_get_property(ngi_section, j);
+            struct ngi_old_property* old_property =
+                &ngi_changes->properties[ngi_changes->properties_len++];
+
+            old_property->name =
+                ngi_arena_strndup(arena, ngi_get_property_name(ngi_property),
+                                  ngi_get_property_name_len(ngi_property));
+            if (old_property->name == NULL)
+                return 0;
+
+            old_property->hash = ngi_value_hash(ngi_property);
+            old_property->matched = 0;
+        }
+    }
+
+    ngi_changes->sections_len = sections_number;
+
+    return 1;
+}
+
+int ngi_changes_diff(ngi_changes_t* ngi_changes, ngi_header_t* ngi_header) {
+    ngi_arena_t* arena = &ngi_changes->arena;
+    const int sections_number = ngi_get_sections_number(ngi_header);
+    int res = 0;
+
+    /* Index the old sections by name, a match removes them */
+    ngi_hash_table_t sections_index;
+    ngi_hash_table_t properties_index;
+    ngi_hash_table_init(&sections_index, arena);
+    ngi_hash_table_init(&properties_index, arena);
+
+    for (int i = 0; i < ngi_changes->sections_len; i++)
+        if (!ngi_hash_table_insert(&sections_index,
+                                   ngi_changes->sections[i].name,
+                                   &ngi_changes->sections[i]))
+            goto end;
+
+    /* The new sections without an old one, in the order of the tree */
+    const ngi_section_t** unmatched =
+        ngi_arena_alloc(arena, (sections_number + 1) * sizeof(void*));
+    int unmatched_len = 0;
+
+    if (unmatched == NULL)
+        goto end;
+
+    for (int i = 0; i < sections_number; i++) {
+        const ngi_section_t* ngi_section = ngi_get_section(ngi_header, i);
+        const char* name = ngi_get_section_name(ngi_section);
+        struct ngi_old_section* old_section =
+            ngi_hash_table_find(&sections_index, name);
+
+        if (old_section == NULL) {
+            unmatched[unmatched_len++] = ngi_section;
+            continue;
+        }
+
+        ngi_hash_table_remove(&sections_index, old_section->name, old_section);
+        old_section->matched = 1;
+
+        /* Compare the properties when they're parsed on both sides */
+        if (old_section->loaded && ngi_section_is_loaded(ngi_section)) {
+            if (!ngi_diff_properties(ngi_changes, &properties_index,
+                                     old_section, ngi_section))
+                goto end;
+        } else if (old_section->loaded != ngi_section_is_loaded(ngi_section) ||
+                   old_section->hash != ngi_section_hash(ngi_section)) {
+            if (!ngi_changes_add(ngi_changes, NGI_CHANGE_MODIFIED, name, NULL,
+                                 NULL))
+                goto end;
+        }
+    }
+
+    /* A new section with the same properties as the next old one
+     * without a match is renamed from it
+     */
+    int old_index = 0;
+    for (int i = 0; i < unmatched_len; i++) {
+        const ngi_section_t* ngi_section = unmatched[i];
+        const char* name = ngi_get_section_name(ngi_section);
+
+        while (old_index < ngi_changes->sections_len &&
+               ngi_changes->sections[old_index].matched)
+            old_index++;
+
+        struct ngi_old_section* old_section =
+            old_index < ngi_changes->sections_len
+                ? &ngi_changes->sections[old_index]
+                : NULL;
+
+        if (old_section != NULL &&
+            old_section->loaded == ngi_section_is_loaded(ngi_section) &&
+            old_section->hash == ngi_section_hash(ngi_section)) {
+            old_section->matched = 1;
+            if (!ngi_changes_add(ngi_changes, NGI_CHANGE_RENAMED, name, NULL,
+                                 old_section->name))
+                goto end;
+        } else if (!ngi_changes_add(ngi_changes, NGI_CHANGE_ADDED, name, NULL,
+                                    NULL)) {
+            goto end;
+        }
+    }
+
+    for (int i = 0; i < ngi_changes->sections_len; i++)
+        if (!ngi_changes->sections[i].matched &&
+            !ngi_changes_add(ngi_changes, NGI_CHANGE_REMOVED,
+                             ngi_changes->sections[i].name, NULL, NULL))
+            goto end;
+
+    res = 1;
+
+end:
+    ngi_hash_table_free(&properties_index);
+    ngi_hash_table_free(&sections_index);
+
+    return res;
+}
+
+/**
+ * @brief Hashes the properties of a ngi_section (**private**)
+ *
+ * The body is hashed instead when the properties are not parsed
+ *
+ * @param[in] ngi_section
+ *
+ * @return The hash of the contents of the ngi_section
+ */
+static uint64_t ngi_section_hash(const ngi_section_t* ngi_section) {
+    if (!ngi_section_is_loaded(ngi_section)) {
+        size_t size;
+        const char* body = ngi_get_section_body(ngi_section, &size);
+        return ngi_hash_bytes(body, size);
+    }
+
+    uint64_t hash = 0;
+
+    for (int i = 0; i < ngi_get_properties_number(ngi_section); i++) {
+        const ngi_property_t* ngi_property = ngi_get_property(ngi_section, i);
+
+        hash = (hash ^ ngi_hash_bytes(ngi_get_property_name(ngi_property),
+                                      ngi_get_property_name_len(ngi_property))) *
+               COMBINE_PRIME;
+        hash = (hash ^ ngi_value_hash(ngi_property)) * COMBINE_PRIME;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Hashes the value of a ngi_property (**private**)
+ *
+ * @param[in] ngi_property
+ *
+ * @return The hash of the value
+ */
+static uint64_t ngi_value_hash(const ngi_property_t* ngi_property) {
+    return ngi_hash_bytes(ngi_get_property_value(ngi_property),
+                          ngi_get_property_value_len(ngi_property));
+}
+
+/**
+ * @brief Lists the changes of the properties of a section (**private**)
+ *
+ * The index is empty before and after the call
+ *
+ * @param[in] ngi_changes
+ * @param[in] index
+ * @param[in] old_section
+ * @param[in] ngi_section
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_diff_properties(ngi_changes_t* ngi_changes,
+                               ngi_hash_table_t* index,
+                               const struct ngi_old_section* old_section,
+                               const ngi_section_t* ngi_section) {
+    struct ngi_old_property* old_properties =
+        &ngi_changes->properties[old_section->first_property];
+    const int old_number = old_section->properties_number;
+    const int properties_number = ngi_get_properties_number(ngi_section);
+    const char* section_name = ngi_get_section_name(ngi_section);
+    int res = 0;
+
+    /* Nothing to list when the properties are the same */
+    if (old_section->hash == ngi_section_hash(ngi_section))
+        return 1;
+
+    /* The new properties without an old one, in the order of the section */
+    const ngi_property_t** unmatched =
+        ngi_arena_alloc(&ngi_changes->arena,
+                        (properties_number + 1) * sizeof(void*));
+    int unmatched_len = 0;
+
+    if (unmatched == NULL)
+        return 0;
+
+    for (int i = 0; i < old_number; i++)
+        if (!ngi_hash_table_insert(index, old_properties[i].name,
+                                   &old_properties[i]))
+            goto end;
+
+    for (int i = 0; i < properties_number; i++) {
+        const ngi_property_t* ngi_property = ngi_get_property(ngi_section, i);
+        const char* name = ngi_get_property_name(ngi_property);
+        struct ngi_old_property* old_property =
+            ngi_hash_table_find(index, name);
+
+        if (old_property == NULL) {
+            unmatched[unmatched_len++] = ngi_property;
+            continue;
+        }
+
+        ngi_hash_table_remove(index, old_property->name, old_property);
+        old_property->matched = 1;
+
+        if (old_property->hash != ngi_value_hash(ngi_property) &&
+            !ngi_changes_add(ngi_changes, NGI_CHANGE_MODIFIED, section_name,
+                             name, NULL))
+            goto end;
+    }
+
+    /* A new property with the value of the next old one
+     * without a match is renamed from it
+     */
+    int old_index = 0;
+    for (int i = 0; i < unmatched_len; i++) {
+        const char* name = ngi_get_property_name(unmatched[i]);
+
+        while (old_index < old_number && old_properties[old_index].matched)
+            old_index++;
+
+        if (old_index < old_number &&
+            old_properties[old_index].hash == ngi_value_hash(unmatched[i])) {
+            old_properties[old_index].matched = 1;
+            if (!ngi_changes_add(ngi_changes, NGI_CHANGE_RENAMED, section_name,
+                                 name, old_properties[old_index].name))
+                goto end;
+        } else if (!ngi_changes_add(ngi_changes, NGI_CHANGE_ADDED,
+                                    section_name, name, NULL)) {
+            goto end;
+        }
+    }
+
+    for (int i = 0; i < old_number; i++)
+        if (!old_properties[i].matched &&
+            !ngi_changes_add(ngi_changes, NGI_CHANGE_REMOVED, section_name,
+                             old_properties[i].name, NULL))
+            goto end;
+
+    res = 1;
+
+end:
+    /* Leave the index empty for the next section */
+    for (int i = 0; i < old_number; i++)
+        ngi_hash_table_remove(index, old_properties[i].name,
+                              &old_properties[i]);
+
+    return res;
+}
+
+/**
+ * @brief Adds a change with copies of his strings (**private**)
+ *
+ * @param[in] ngi_changes
+ * @param[in] type
+ * @param[in] section
+ * @param[in] property
+ * @param[in] old_name
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_changes_add(ngi_changes_t* ngi_changes, int type,
+                           const char* section, const char* property,
+                           const char* old_name) {
+    ngi_arena_t* arena = &ngi_changes->arena;
+
+    if (ngi_changes->changes_len == ngi_changes->changes_capacity) {
+        const int capacity = ngi_changes->changes_capacity
+                                 ? ngi_changes->changes_capacity * 2
+                                 : 8;
+        ngi_change_t* changes = ngi_arena_realloc(
+            arena, ngi_changes->changes,
+            ngi_changes->changes_capacity * sizeof(ngi_change_t),
+            capacity * sizeof(ngi_change_t));
+
+        if (changes == NULL)
+            return 0;
+
+        ngi_changes->changes = changes;
+        ngi_changes->changes_capacity = capacity;
+    }
+
+    ngi_change_t change = {.type = type};
+
+    /* The strings of the tree may change after the call */
+    change.section = ngi_arena_strndup(arena, section, strlen(section));
+    if (change.section == NULL)
+        return 0;
+
+    if (property != NULL) {
+        change.property = ngi_arena_strndup(arena, property, strlen(property));
+        if (change.property == NULL)
+            return 0;
+    }
+
+    if (old_name != NULL) {
+        change.old_name = ngi_arena_strndup(arena, old_name, strlen(old_name));
+        if (change.old_name == NULL)
+            return 0;
+    }
+
+    ngi_changes->changes[ngi_changes->changes_len++] = change;
+
+    return 1;
+}
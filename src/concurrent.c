@@ -0,0 +1,200 @@
+/**
+ * @file concurrent.c
+ * @brief The libgni concurrent access implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Lock letting the readers of a tree run in parallel
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "libngi/libngi.h"
+#include "libngi/concurrent.h"
+#include "libngi/libngi_internal.h"
+
+/* Number of counters sharing the readers */
+#define LOCK_SLOTS 64
+/* Size of a cache line, so the counters don't share one */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @brief Contains the readers of one slot (**private**)
+ *
+ * The ngi_lock_slot contains:
+ * - the number of readers holding the lock in this slot
+ */
+struct ngi_lock_slot {
+    int readers;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/**
+ * @brief Contains the lock of a concurrent ngi_header
+ *
+ * The ngi_lock contains:
+ * - the counters of the readers, a thread always uses the same one
+ * - the mutex held by the writer, the readers blocked sleep on it
+ * - if a writer holds or waits for the lock
+ * - the mutex serializing the parsing of the lazy sections
+ *
+ * A reader counts itself in his slot then checks that there is no writer,
+ * a writer announces itself then waits for all the slots to be empty,
+ * so the readers only touch their own cache line
+ */
+typedef struct ngi_lock {
+    struct ngi_lock_slot slots[LOCK_SLOTS];
+    pthread_mutex_t writers;
+    int writing;
+    pthread_mutex_t loads;
+} ngi_lock_t;
+
+/* Slot of the current thread, -1 until his first read */
+static __thread int thread_slot = -1;
+/* Next slot given to a thread */
+static int next_slot;
+
+int ngi_set_concurrent(ngi_header_t* ngi_header);
+void ngi_read_lock(ngi_header_t* ngi_header);
+void ngi_read_unlock(ngi_header_t* ngi_header);
+void ngi_write_lock(ngi_header_t* ngi_header);
+void ngi_write_unlock(ngi_header_t* ngi_header);
+void ngi_load_lock(ngi_header_t* ngi_header);
+void ngi_load_unlock(ngi_header_t* ngi_header);
+void ngi_lock_free(ngi_lock_t* ngi_lock);
+static inline struct ngi_lock_slot* ngi_lock_slot(ngi_lock_t* ngi_lock);
+
+int ngi_set_concurrent(ngi_header_t* ngi_header) {
+    if (ngi_header == NULL)
+        return 0;
+
+    if (ngi_get_lock(ngi_header) != NULL)
+        return 1;
+
+    ngi_lock_t* ngi_lock = aligned_alloc(CACHE_LINE_SIZE, sizeof(ngi_lock_t));
+
+    if (ngi_lock == NULL)
+        return 0;
+
+    for (int i = 0; i < LOCK_SLOTS; i++)
+        ngi_lock->slots[i].readers = 0;
+
+    pthread_mutex_init(&ngi_lock->writers, NULL);
+    ngi_lock->writing = 0;
+    pthread_mutex_init(&ngi_lock->loads, NULL);
+
+    ngi_set_lock(ngi_header, ngi_lock);
+
+    return 1;
+}
+
+void ngi_read_lock(ngi_header_t* ngi_header) {
+    ngi_lock_t* ngi_lock = ngi_get_lock(ngi_header);
+
+    if (ngi_lock == NULL)
+        return;
+
+    struct ngi_lock_slot* slot = ngi_lock_slot(ngi_lock);
+
+    for (;;) {
+        __atomic_add_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST);
+
+        if (!__atomic_load_n(&ngi_lock->writing, __ATOMIC_SEQ_CST))
+            return;
+
+        /* Let the writer finish, sleeping until he releases the mutex */
+        __atomic_sub_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_lock(&ngi_lock->writers);
+        pthread_mutex_unlock(&ngi_lock->writers);
+    }
+}
+
+void ngi_read_unlock(ngi_header_t* ngi_header) {
+    ngi_lock_t* ngi_lock = ngi_get_lock(ngi_header);
+
+    if (ngi_lock == NULL)
+        return;
+
+    __atomic_sub_fetch(&ngi_lock_slot(ngi_lock)->readers, 1, __ATOMIC_RELEASE);
+}
+
+void ngi_write_lock(ngi_header_t* ngi_header) {
+    ngi_lock_t* ngi_lock = ngi_get_lock(ngi_header);
+
+    if (ngi_lock == NULL)
+        return;
+
+    pthread_mutex_lock(&ngi_lock->writers);
+    __atomic_store_n(&ngi_lock->writing, 1, __ATOMIC_SEQ_CST);
+
+    /* The readers who came before leave soon, the next ones wait */
+    for (int i = 0; i < LOCK_SLOTS; i++)
+        while (__atomic_load_n(&ngi_lock->slots[i].readers,
+                               __ATOMIC_SEQ_CST) != 0)
+            sched_yield();
+}
+
+void ngi_write_unlock(ngi_header_t* ngi_header) {
+    ngi_lock_t* ngi_lock = ngi_get_lock(ngi_header);
+
+    if (ngi_lock == NULL)
+        return;
+
+    __atomic_store_n(&ngi_lock->writing, 0, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&ngi_lock->writers);
+}
+
+void ngi_load_lock(ngi_header_t* ngi_header) {
+    ngi_lock_t* ngi_lock = ngi_get_lock(ngi_header);
+
+    if (ngi_lock != NULL)
+        pthread_mutex_lock(&ngi_lock->loads);
+}
+
+void ngi_load_unlock(ngi_header_t* ngi_header) {
+    ngi_lock_t* ngi_lock = ngi_get_lock(ngi_header);
+
+    if (ngi_lock != NULL)
+        pthread_mutex_unlock(&ngi_lock->loads);
+}
+
+void ngi_lock_free(ngi_lock_t* ngi_lock) {
+    if (ngi_lock == NULL)
+        return;
+
+    pthread_mutex_destroy(&ngi_lock->writers);
+    pthread_mutex_destroy(&ngi_lock->loads);
+    free(ngi_lock);
+}
+
+/**
+ * @brief Gets the slot of the current thread (**private**)
+ *
+ * @param[in] ngi_lock
+ *
+ * @return The slot counting the readers of the thread
+ */
+static inline struct ngi_lock_slot* ngi_lock_slot(ngi_lock_t* ngi_lock) {
+    /* The threads are spread over the slots in turn */
+    if (thread_slot < 0)
+        thread_slot =
+            __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED) % LOCK_SLOTS;
+
+    return &ngi_lock->slots[thread_slot];
+}
@@ -28,6 +28,7 @@
 #include <string.h>
 #include <unistd.h>
 #include "libngi/libngi.h"
+#include "libngi/write.h"
 #include "libngi/libngi_internal.h"
 
 int ngi_create(const char* restrict filename);
@@ -35,6 +36,12 @@ ngi_section_t* ngi_create_section(ngi_header_t* ngi_header, const char* name);
 ngi_property_t* ngi_create_property(ngi_header_t* ngi_header,
                                     ngi_section_t* ngi_section,
                                     const char* name, const char* value);
+static ngi_section_t* ngi_create_section_unlocked(ngi_header_t* ngi_header,
+                                                  const char* name);
+static ngi_property_t* ngi_create_property_unlocked(ngi_header_t* ngi_header,
+                                                    ngi_section_t* ngi_section,
+                                                    const char* name,
+                                                    const char* value);
 
 int ngi_create(const char* restrict filename) {
     if ((access(filename, F_OK)) != 0) {
@@ -53,35 +60,146 @@ int ngi_create(const char* restrict filename) {
 
 ngi_section_t* ngi_create_section(ngi_header_t* ngi_header, const char* name) {
     if (ngi_header == NULL)
-        return 0;
+        return NULL;
+
+    ngi_write_lock(ngi_header);
+    ngi_section_t* ngi_section = ngi_create_section_unlocked(ngi_header, name);
+    ngi_write_unlock(ngi_header);
+
+    return ngi_section;
+}
+
+ngi_property_t* ngi_create_property(ngi_header_t* ngi_header,
+                                    ngi_section_t* ngi_section,
+                                    const char* name, const char* value) {
+    if (ngi_header == NULL || ngi_section == NULL)
+        return NULL;
+
+    ngi_write_lock(ngi_header);
+    ngi_property_t* ngi_property =
+        ngi_create_property_unlocked(ngi_header, ngi_section, name, value);
+    ngi_write_unlock(ngi_header);
+
+    return ngi_property;
+}
 
+/**
+ * @brief Creates a ngi_section with the ngi_header locked (**private**)
+ *
+ * @param[in] ngi_header
+ * @param[in] name
+ *
+ * @return The new ngi_section or NULL if the creation failed
+ */
+static ngi_section_t* ngi_create_section_unlocked(ngi_header_t* ngi_header,
+                                                  const char* name) {
     FILE* fd = ngi_get_file(ngi_header);
 
+    /* Check if the file is writable */
+    if (fd == NULL)
+        return NULL;
+
+    /* The file is written on commit */
+    if (ngi_in_transaction(ngi_header))
+        return ngi_section_alloc(ngi_header, name);
+
     fseek(fd, 0, SEEK_END);
+    const long end = ftell(fd);
 
     /* Write the section in the file */
-    ngi_write_section(fd, name);
+    if (!ngi_write_section(fd, name))
+        return NULL;
 
     /* Add the section in memory */
-    return ngi_section_alloc(ngi_header, name);
-}
+    ngi_section_t* ngi_section = ngi_section_alloc(ngi_header, name);
+    if (ngi_section == NULL)
+        return NULL;
 
-ngi_property_t* ngi_create_property(ngi_header_t* ngi_header,
-                                    ngi_section_t* ngi_section,
-                                    const char* name, const char* value) {
-    if (ngi_header == NULL || ngi_section == NULL)
-        return 0;
+    /* The line starts after the separating new line */
+    const ngi_span_t span = {end + (end != 0),
+                             (int)(strlen(name) + strlen(SECTION_TKN))};
+    ngi_set_section_span(ngi_section, &span);
 
+    return ngi_section;
+}
+
+/**
+ * @brief Creates a ngi_property with the ngi_header locked (**private**)
+ *
+ * @param[in] ngi_header
+ * @param[in] ngi_section
+ * @param[in] name
+ * @param[in] value
+ *
+ * @return The new ngi_property or NULL if the creation failed
+ */
+static ngi_property_t* ngi_create_property_unlocked(ngi_header_t* ngi_header,
+                                                    ngi_section_t* ngi_section,
+                                                    const char* name,
+                                                    const char* value) {
     FILE* fd = ngi_get_file(ngi_header);
 
-    fseek(fd, ngi_find_section(ngi_header, ngi_get_section_name(ngi_section)),
-          SEEK_SET);
+    /* Check if the file is writable */
+    if (fd == NULL)
+        return NULL;
+
+    /* The file is written on commit */
+    if (ngi_in_transaction(ngi_header))
+        return ngi_property_alloc(ngi_section, name, value);
 
-    /* Write the property in the file */
-    ngi_write_property(fd, name, value);
+    /* The property goes after the last line of the section */
+    const int properties_number = ngi_get_properties_number(ngi_section);
+    const ngi_span_t* last =
+        properties_number > 0
+            ? ngi_get_property_span(
+                  ngi_get_property(ngi_section, properties_number - 1))
+            : ngi_get_section_span(ngi_section);
+
+    if (last->offset < 0)
+        return NULL;
+
+    const size_t name_len = strlen(name);
+    const size_t tkn_len = strlen(PROPERTY_TKN);
+    const size_t value_len = strlen(value);
+    const size_t len = name_len + tkn_len + value_len;
+
+    /* Check if the last line ends with a new line */
+    const long end = last->offset + last->length;
+    fseek(fd, end, SEEK_SET);
+    const int has_eol = fgetc(fd) == '\n';
+
+    /* Insert "line\n" after the new line, or "\nline" at the end of file */
+    char* line = malloc(len + 1);
+    if (line == NULL)
+        return NULL;
+
+    char* start = has_eol ? line : line + 1;
+    memcpy(start, name, name_len);
+    memcpy(start + name_len, PROPERTY_TKN, tkn_len);
+    memcpy(start + name_len + tkn_len, value, value_len);
+    if (has_eol)
+        line[len] = '\n';
+    else
+        line[0] = '\n';
+
+    const long pos = has_eol ? end + 1 : end;
+    const ngi_span_t insert = {pos, 0};
+    int res = ngi_write_span(fd, &insert, line, len + 1);
+    free(line);
+
+    if (!res)
+        return NULL;
+
+    /* The next lines moved with the new one */
+    ngi_shift_spans(ngi_header, pos, (long)len + 1);
 
     /* Add the property in memory */
-    return ngi_property_alloc(ngi_section, NGI_MAX_NAME_LENGTH,
-                              NGI_MAX_LINE_LENGTH);
-    ;
+    ngi_property_t* ngi_property = ngi_property_alloc(ngi_section, name, value);
+    if (ngi_property == NULL)
+        return NULL;
+
+    const ngi_span_t span = {end + 1, (int)len};
+    ngi_set_property_span(ngi_property, &span);
+
+    return ngi_property;
 }
@@ -36,6 +36,8 @@ long ngi_find_property(ngi_header_t* ngi_header, const char* section,
                        const char* name);
 long ngi_find_next_property(ngi_header_t* ngi_header, const char* section,
                             long previous_offset);
+static int ngi_name_equals(const char* line, const ngi_tokens_t* tokens,
+                           const char* name);
 
 long ngi_find_section(ngi_header_t* ngi_header, const char* name) {
     FILE* fd = ngi_get_file(ngi_header);
@@ -43,22 +45,17 @@ long ngi_find_section(ngi_header_t* ngi_header, const char* name) {
         return -1;
 
     char buff[NGI_MAX_LINE_LENGTH];
+    ngi_tokens_t tokens;
     long previous_line_offset = 0;
 
     rewind(fd);
-    while (!feof(fd)) {
-        fgets(buff, NGI_MAX_LINE_LENGTH, fd);
-
+    while (fgets(buff, NGI_MAX_LINE_LENGTH, fd) != NULL) {
         /* Check if the line is a section
          * and if the name is the requested one
          */
-        if (ngi_get_type(buff) == SECTION) {
-            ngi_strip_section_name(buff);
-
-            /* Return the previous line offset */
-            if (!strcmp(buff, name))
-                return previous_line_offset;
-        }
+        if (ngi_tokenize_line(buff, strlen(buff), &tokens) == SECTION &&
+            ngi_name_equals(buff, &tokens, name))
+            return previous_line_offset;
 
         previous_line_offset = ftell(fd);
     }
@@ -73,9 +70,7 @@ long ngi_find_next_section(ngi_header_t* ngi_header) {
     char buff[NGI_MAX_LINE_LENGTH];
     long previous_line_offset = 0;
 
-    while (!feof(fd)) {
-        fgets(buff, NGI_MAX_LINE_LENGTH, fd);
-
+    while (fgets(buff, NGI_MAX_LINE_LENGTH, fd) != NULL) {
         /* Return the previous line offset */
         if (ngi_get_type(buff) == SECTION)
             return previous_line_offset;
@@ -101,24 +96,22 @@ long ngi_find_property(ngi_header_t* ngi_header, const char* section,
     fseek(fd, offset, SEEK_SET);
 
     char buff[NGI_MAX_LINE_LENGTH];
+    ngi_tokens_t tokens;
 
     rewind(fd);
-    while (!feof(fd)) {
-        fgets(buff, NGI_MAX_LINE_LENGTH, fd);
+    while (fgets(buff, NGI_MAX_LINE_LENGTH, fd) != NULL) {
+        /* Tokenize the line only once */
+        const enum ngi_type type =
+            ngi_tokenize_line(buff, strlen(buff), &tokens);
 
-        /* Check if the line is a section
+        /* Check if the line is a property
          * and if the name is the requested one
          */
-        if (ngi_get_type(buff) == PROPERTY) {
-            ngi_strip_property_name(buff);
-
-            /* Return the previous line offset */
-            if (!strcmp(buff, name))
-                return previous_line_offset;
-        }
+        if (type == PROPERTY && ngi_name_equals(buff, &tokens, name))
+            return previous_line_offset;
 
         /* Check if we are in a new section */
-        if (ngi_get_type(buff) == SECTION)
+        if (type == SECTION)
             return -1;
 
         previous_line_offset = ftell(fd);
@@ -145,23 +138,38 @@ long ngi_find_next_property(ngi_header_t* ngi_header, const char* section,
     char buff[NGI_MAX_LINE_LENGTH];
 
     /* Skip the first line */
-    fgets(buff, NGI_MAX_LINE_LENGTH, fd);
-    /* Clear the buffer */
-    memset(buff, 0, NGI_MAX_LINE_LENGTH);
+    if (fgets(buff, NGI_MAX_LINE_LENGTH, fd) == NULL)
+        return -1;
     long previous_line_offset = ftell(fd);
 
-    while (!feof(fd)) {
-        fgets(buff, NGI_MAX_LINE_LENGTH, fd);
+    while (fgets(buff, NGI_MAX_LINE_LENGTH, fd) != NULL) {
+        /* Classify the line only once */
+        const enum ngi_type type = ngi_get_type(buff);
 
         /* Return the previous line offset */
-        if (ngi_get_type(buff) == PROPERTY)
+        if (type == PROPERTY)
             return previous_line_offset;
 
         /* Check if we are in a new section */
-        if (ngi_get_type(buff) == SECTION)
+        if (type == SECTION)
             return -1;
 
         previous_line_offset = ftell(fd);
     }
     return -1;
 }
+
+/**
+ * @brief Compares the name of a tokenized line (**private**)
+ *
+ * @param[in] line
+ * @param[in] tokens
+ * @param[in] name
+ *
+ * @return 1 if the name of the line is the requested one, 0 otherwise
+ */
+static int ngi_name_equals(const char* line, const ngi_tokens_t* tokens,
+                           const char* name) {
+    return strlen(name) == tokens->name_len &&
+           !memcmp(line, name, tokens->name_len);
+}
@@ -0,0 +1,316 @@
+/**
+ * @file hash.c
+ * @brief The libgni hash index implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Hash index used to find the sections and the properties by name
+ * with linear probing and backward shift deletion
+ */
+#include <stdint.h>
+#include <string.h>
+#include "libngi/libngi.h"
+#include "libngi/libngi_internal.h"
+
+/* Initial number of slots of an index */
+#define MIN_TABLE_CAPACITY 8
+
+/* FNV-1a constants */
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME        16777619u
+
+/* Multiplier mixing the words of the hashed buffers */
+#define MIX_PRIME 0x9e3779b97f4a7c15ull
+
+uint32_t ngi_hash_string(const char* str);
+uint64_t ngi_hash_bytes(const void* data, size_t size);
+void ngi_hash_init(ngi_hash_state_t* state);
+void ngi_hash_update(ngi_hash_state_t* state, const void* data, size_t size);
+uint64_t ngi_hash_final(const ngi_hash_state_t* state);
+void ngi_hash_table_init(ngi_hash_table_t* table, ngi_arena_t* arena);
+void ngi_hash_table_free(ngi_hash_table_t* table);
+int ngi_hash_table_insert(ngi_hash_table_t* table, const char* key,
+                          void* node);
+void ngi_hash_table_remove(ngi_hash_table_t* table, const char* key,
+                           const void* node);
+int ngi_hash_table_reserve(ngi_hash_table_t* table, int len);
+void* ngi_hash_table_find(const ngi_hash_table_t* table, const char* key);
+void* ngi_hash_table_find_hashed(const ngi_hash_table_t* table,
+                                 const char* key, uint32_t hash);
+void ngi_hash_table_prefetch(const ngi_hash_table_t* table, uint32_t hash);
+static int ngi_hash_table_grow(ngi_hash_table_t* table);
+static void ngi_hash_table_place(ngi_hash_table_t* table,
+                                 const ngi_hash_entry_t* entry);
+static inline uint64_t ngi_hash_mix(uint64_t hash, uint64_t word);
+
+uint32_t ngi_hash_string(const char* str) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (const unsigned char* c = (const unsigned char*)str; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+uint64_t ngi_hash_bytes(const void* data, size_t size) {
+    ngi_hash_state_t state;
+
+    ngi_hash_init(&state);
+    ngi_hash_update(&state, data, size);
+
+    return ngi_hash_final(&state);
+}
+
+void ngi_hash_init(ngi_hash_state_t* state) {
+    state->hash = MIX_PRIME;
+    state->tail = 0;
+    state->size = 0;
+}
+
+void ngi_hash_update(ngi_hash_state_t* state, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    const size_t tail_len = state->size % sizeof(state->tail);
+    uint64_t word;
+
+    state->size += size;
+
+    /* Complete the word started by the previous update */
+    if (tail_len != 0) {
+        size_t len = sizeof(state->tail) - tail_len;
+        if (len > size)
+            len = size;
+
+        memcpy((unsigned char*)&state->tail + tail_len, bytes, len);
+        bytes += len;
+        size -= len;
+
+        if (tail_len + len < sizeof(state->tail))
+            return;
+
+        state->hash = ngi_hash_mix(state->hash, state->tail);
+    }
+
+    for (; size >= sizeof(word); size -= sizeof(word)) {
+        memcpy(&word, bytes, sizeof(word));
+        bytes += sizeof(word);
+
+        state->hash = ngi_hash_mix(state->hash, word);
+    }
+
+    /* Keep the last bytes for the next update */
+    state->tail = 0;
+    memcpy(&state->tail, bytes, size);
+}
+
+uint64_t ngi_hash_final(const ngi_hash_state_t* state) {
+    /* The last bytes are padded with zeros */
+    uint64_t hash = (state->hash ^ state->tail) * MIX_PRIME;
+    hash ^= hash >> 29;
+
+    /* The size tells apart the buffers ending with zeros */
+    hash = (hash ^ state->size) * MIX_PRIME;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+void ngi_hash_table_init(ngi_hash_table_t* table, ngi_arena_t* arena) {
+    table->entries = NULL;
+    table->capacity = 0;
+    table->len = 0;
+    table->arena = arena;
+}
+
+void ngi_hash_table_free(ngi_hash_table_t* table) {
+    ngi_arena_release(table->arena, table->entries,
+                      table->capacity * sizeof(ngi_hash_entry_t));
+    ngi_hash_table_init(table, table->arena);
+}
+
+int ngi_hash_table_insert(ngi_hash_table_t* table, const char* key,
+                          void* node) {
+    /* Keep the load factor under 3/4 */
+    if ((table->len + 1) * 4 > table->capacity * 3) {
+        if (!ngi_hash_table_grow(table))
+            return 0;
+    }
+
+    const ngi_hash_entry_t entry = {
+        .hash = ngi_hash_string(key),
+        .key = key,
+        .node = node,
+    };
+
+    ngi_hash_table_place(table, &entry);
+    table->len++;
+
+    return 1;
+}
+
+int ngi_hash_table_reserve(ngi_hash_table_t* table, int len) {
+    int capacity = MIN_TABLE_CAPACITY;
+
+    /* Keep the load factor under 3/4 once the nodes are added */
+    while (len * 4 > capacity * 3)
+        capacity *= 2;
+
+    if (table->len != 0 || capacity <= table->capacity)
+        return 1;
+
+    ngi_hash_entry_t* entries =
+        ngi_arena_calloc(table->arena, capacity * sizeof(ngi_hash_entry_t));
+    if (entries == NULL)
+        return 0;
+
+    ngi_arena_release(table->arena, table->entries,
+                      table->capacity * sizeof(ngi_hash_entry_t));
+    table->entries = entries;
+    table->capacity = capacity;
+
+    return 1;
+}
+
+void ngi_hash_table_remove(ngi_hash_table_t* table, const char* key,
+                           const void* node) {
+    if (table->len == 0)
+        return;
+
+    const uint32_t mask = table->capacity - 1;
+    uint32_t i = ngi_hash_string(key) & mask;
+
+    /* Find the slot of the node */
+    while (table->entries[i].node != node) {
+        if (table->entries[i].node == NULL)
+            return;
+
+        i = (i + 1) & mask;
+    }
+
+    /* Shift back the next entries of the cluster to fill the hole */
+    uint32_t hole = i;
+    for (uint32_t j = (i + 1) & mask; table->entries[j].node != NULL;
+         j = (j + 1) & mask) {
+        uint32_t home = table->entries[j].hash & mask;
+
+        /* Check if the entry can be moved to the hole */
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            table->entries[hole] = table->entries[j];
+            hole = j;
+        }
+    }
+
+    table->entries[hole].node = NULL;
+    table->len--;
+}
+
+void* ngi_hash_table_find(const ngi_hash_table_t* table, const char* key) {
+    if (table->len == 0)
+        return NULL;
+
+    return ngi_hash_table_find_hashed(table, key, ngi_hash_string(key));
+}
+
+void* ngi_hash_table_find_hashed(const ngi_hash_table_t* table,
+                                 const char* key, uint32_t hash) {
+    if (table->len == 0)
+        return NULL;
+
+    const uint32_t mask = table->capacity - 1;
+
+    for (uint32_t i = hash & mask; table->entries[i].node != NULL;
+         i = (i + 1) & mask) {
+        const ngi_hash_entry_t* entry = &table->entries[i];
+
+        if (entry->hash == hash && !strcmp(entry->key, key))
+            return entry->node;
+    }
+
+    return NULL;
+}
+
+void ngi_hash_table_prefetch(const ngi_hash_table_t* table, uint32_t hash) {
+    if (table->len != 0)
+        __builtin_prefetch(&table->entries[hash & (table->capacity - 1)]);
+}
+
+/**
+ * @brief Mixes a word in the hash (**private**)
+ *
+ * @param[in] hash
+ * @param[in] word
+ *
+ * @return The new hash
+ */
+static inline uint64_t ngi_hash_mix(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * MIX_PRIME;
+    return hash ^ hash >> 32;
+}
+
+/**
+ * @brief Doubles the number of slots of the index (**private**)
+ *
+ * @param[in] table
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_hash_table_grow(ngi_hash_table_t* table) {
+    ngi_hash_table_t new_table = {
+        .capacity = table->capacity < MIN_TABLE_CAPACITY ? MIN_TABLE_CAPACITY
+                                                         : table->capacity * 2,
+        .len = table->len,
+        .arena = table->arena,
+    };
+
+    new_table.entries = ngi_arena_calloc(
+        table->arena, new_table.capacity * sizeof(ngi_hash_entry_t));
+    if (new_table.entries == NULL)
+        return 0;
+
+    /* Reinsert all the entries */
+    for (int i = 0; i < table->capacity; i++) {
+        if (table->entries[i].node != NULL)
+            ngi_hash_table_place(&new_table, &table->entries[i]);
+    }
+
+    ngi_arena_release(table->arena, table->entries,
+                      table->capacity * sizeof(ngi_hash_entry_t));
+    *table = new_table;
+
+    return 1;
+}
+
+/**
+ * @brief Copies an entry in the first free slot (**private**)
+ *
+ * @param[in] table
+ * @param[in] entry
+ */
+static void ngi_hash_table_place(ngi_hash_table_t* table,
+                                 const ngi_hash_entry_t* entry) {
+    const uint32_t mask = table->capacity - 1;
+    uint32_t i = entry->hash & mask;
+
+    while (table->entries[i].node != NULL)
+        i = (i + 1) & mask;
+
+    table->entries[i] = *entry;
+}
@@ -0,0 +1,429 @@
+/**
+ * @file image.c
+ * @brief The libgni compiled image implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Binary image of a parsed tree, written next to the file
+ * so the next opens don't parse it again
+ *
+ * The image is made of an ngi_image_header, the records of the sections,
+ * the records of all the properties in the order of their sections,
+ * then the table of the NUL terminated names and values.
+ * The records only hold offsets in the table,
+ * so the nodes point directly in the mapped image.
+ * Like a lazy header, the properties are allocated on first access
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "libngi/libngi.h"
+#include "libngi/libngi_internal.h"
+
+/* Identifies an image and the layout of its records */
+#define IMAGE_MAGIC "NGIC"
+#define IMAGE_VERSION 1
+/* Suffix of the image, added after the name of the file */
+#define IMAGE_SUFFIX "c"
+#define IMAGE_EXTENSION ".ngic"
+/* Suffix of the temporary file, completed by mkstemp */
+#define TEMP_SUFFIX ".XXXXXX"
+
+/**
+ * @brief Contains the beginning of an image (**private**)
+ *
+ * The ngi_image_header contains:
+ * - the magic and the version of the layout
+ * - the size, the modification time and the hash of the parsed file
+ * - the number of sections and properties records
+ * - the size of the strings table
+ */
+struct ngi_image_header {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t source_hash;
+    uint32_t sections_len;
+    uint32_t properties_len;
+    uint64_t strings_size;
+};
+
+/**
+ * @brief Contains a section of an image (**private**)
+ *
+ * The name is an offset in the strings table,
+ * the properties follow those of the previous sections
+ */
+struct ngi_image_section {
+    uint32_t name;
+    uint32_t name_len;
+    uint32_t properties_len;
+    int32_t span_length;
+    int64_t span_offset;
+};
+
+/**
+ * @brief Contains a property of an image (**private**)
+ *
+ * The name is an offset in the strings table, the value follows it
+ */
+struct ngi_image_property {
+    uint32_t name;
+    uint32_t name_len;
+    uint32_t value_len;
+    int32_t span_length;
+    int64_t span_offset;
+};
+
+char* ngi_image_name(const char* filename);
+int ngi_image_load(ngi_header_t* ngi_header, const char* image_name,
+                   const ngi_stamp_t* stamp);
+int ngi_image_read(ngi_header_t* ngi_header, const ngi_stamp_t* stamp);
+int ngi_image_load_properties(ngi_section_t* ngi_section, const char* body,
+                              size_t size);
+int ngi_image_dump(FILE* fd, ngi_header_t* ngi_header,
+                   const ngi_stamp_t* stamp);
+int ngi_image_write(ngi_header_t* ngi_header, const char* image_name,
+                    const ngi_stamp_t* stamp);
+static char* ngi_image_string(char* strings, uint64_t strings_size,
+                              uint32_t offset, uint32_t len);
+
+char* ngi_image_name(const char* filename) {
+    const size_t len = strlen(filename);
+    const size_t ext_len = strlen(IMAGE_EXTENSION) - strlen(IMAGE_SUFFIX);
+
+    /* "file.ngi" gives "file.ngic", the other names get ".ngic" */
+    const char* suffix = len >= ext_len &&
+                                 !strcmp(filename + len - ext_len, ".ngi")
+                             ? IMAGE_SUFFIX
+                             : IMAGE_EXTENSION;
+    char* image_name = malloc(len + strlen(suffix) + 1);
+
+    if (image_name == NULL)
+        return NULL;
+
+    memcpy(image_name, filename, len);
+    strcpy(image_name + len, suffix);
+
+    return image_name;
+}
+
+int ngi_image_load(ngi_header_t* ngi_header, const char* image_name,
+                   const ngi_stamp_t* stamp) {
+    /* The strings of the nodes are views in the mapped image,
+     * whose pages are only read with the sections who use them
+     */
+    if (!ngi_source_map_sparse(ngi_get_source(ngi_header), image_name))
+        return 0;
+
+    return ngi_image_read(ngi_header, stamp);
+}
+
+int ngi_image_read(ngi_header_t* ngi_header, const ngi_stamp_t* stamp) {
+    ngi_source_t* source = ngi_get_source(ngi_header);
+    const struct ngi_image_header* image = (void*)source->data;
+
+    if (source->size < sizeof(*image) ||
+        memcmp(image->magic, IMAGE_MAGIC, sizeof(image->magic)) ||
+        image->version != IMAGE_VERSION)
+        return 0;
+
+    /* The image is only used for the contents it was built from */
+    if (stamp != NULL &&
+        (!stamp->hashed || image->source_size != (uint64_t)stamp->size ||
+        image->mtime_sec != stamp->mtime.tv_sec ||
+        image->mtime_nsec != stamp->mtime.tv_nsec ||
+         image->source_hash != stamp->hash))
+        return 0;
+
+    const size_t records_size =
+        image->sections_len * sizeof(struct ngi_image_section) +
+        (size_t)image->properties_len * sizeof(struct ngi_image_property);
+
+    if (source->size - sizeof(*image) < records_size ||
+        source->size - sizeof(*image) - records_size != image->strings_size)
+        return 0;
+
+    const struct ngi_image_section* sections = (void*)(image + 1);
+    struct ngi_image_property* properties =
+        (void*)(sections + image->sections_len);
+    char* strings = (char*)(properties + image->properties_len);
+    uint32_t property_num = 0;
+
+    /* The array and the index are allocated once at their final size */
+    if (image->sections_len > INT32_MAX ||
+        !ngi_header_reserve(ngi_header, image->sections_len))
+        return 0;
+
+    for (uint32_t i = 0; i < image->sections_len; i++) {
+        const struct ngi_image_section* record = &sections[i];
+        char* name = ngi_image_string(strings, image->strings_size,
+                                      record->name, record->name_len);
+
+        if (name == NULL ||
+            record->properties_len > image->properties_len - property_num)
+            return 0;
+
+        ngi_section_t* ngi_section =
+            ngi_section_alloc_view(ngi_header, name, record->name_len);
+        if (ngi_section == NULL)
+            return 0;
+
+        const ngi_span_t span = {record->span_offset, record->span_length};
+        ngi_set_section_span(ngi_section, &span);
+
+        /* Only the sections are allocated,
+         * the body of a section is the records of his properties
+         */
+        if (record->properties_len != 0)
+            ngi_set_section_body(
+                ngi_section, (char*)&properties[property_num],
+                record->properties_len * sizeof(struct ngi_image_property));
+
+        property_num += record->properties_len;
+    }
+
+    return property_num == image->properties_len;
+}
+
+int ngi_image_load_properties(ngi_section_t* ngi_section, const char* body,
+                              size_t size) {
+    ngi_source_t* source = ngi_get_source(ngi_get_section_parent(ngi_section));
+    const struct ngi_image_header* image = (void*)source->data;
+    const struct ngi_image_property* properties = (const void*)body;
+    const size_t properties_len = size / sizeof(struct ngi_image_property);
+
+    /* The strings table follows the records, checked by ngi_image_load */
+    char* strings = source->data + source->size - image->strings_size;
+
+    if (!ngi_section_reserve(ngi_section, properties_len))
+        return 0;
+
+    for (size_t i = 0; i < properties_len; i++) {
+        const struct ngi_image_property* record = &properties[i];
+        char* name = ngi_image_string(strings, image->strings_size,
+                                      record->name, record->name_len);
+        char* value =
+            name == NULL ? NULL
+                         : ngi_image_string(strings, image->strings_size,
+                                            record->name + record->name_len + 1,
+                                            record->value_len);
+
+        if (value == NULL)
+            return 0;
+
+        ngi_property_t* ngi_property = ngi_property_alloc_view(
+            ngi_section, name, record->name_len, value, record->value_len);
+        if (ngi_property == NULL)
+            return 0;
+
+        const ngi_span_t span = {record->span_offset, record->span_length};
+        ngi_set_property_span(ngi_property, &span);
+    }
+
+    return 1;
+}
+
+int ngi_image_write(ngi_header_t* ngi_header, const char* image_name,
+                    const ngi_stamp_t* stamp) {
+    const size_t image_name_len = strlen(image_name);
+
+    /* The image is written aside then renamed,
+     * so the other processes never map a partial image
+     */
+    char* temp_name = malloc(image_name_len + sizeof(TEMP_SUFFIX));
+    if (temp_name == NULL)
+        return 0;
+
+    memcpy(temp_name, image_name, image_name_len);
+    memcpy(temp_name + image_name_len, TEMP_SUFFIX, sizeof(TEMP_SUFFIX));
+
+    int temp_fd = mkstemp(temp_name);
+    if (temp_fd < 0) {
+        free(temp_name);
+        return 0;
+    }
+
+    /* The image is as readable as the file */
+    struct stat file_stat;
+    if (stat(ngi_get_filename(ngi_header), &file_stat) == 0)
+        fchmod(temp_fd, file_stat.st_mode & 0666);
+
+    FILE* fd = fdopen(temp_fd, "w");
+    int res = 0;
+
+    if (fd == NULL) {
+        close(temp_fd);
+    } else {
+        res = ngi_image_dump(fd, ngi_header, stamp);
+
+        if (fclose(fd) != 0)
+            res = 0;
+    }
+
+    if (!res || rename(temp_name, image_name) != 0) {
+        unlink(temp_name);
+        res = 0;
+    }
+
+    free(temp_name);
+
+    return res;
+}
+
+int ngi_image_dump(FILE* fd, ngi_header_t* ngi_header,
+                   const ngi_stamp_t* stamp) {
+    const int sections_number = ngi_get_sections_number(ngi_header);
+    struct ngi_image_header image = {
+        .magic = IMAGE_MAGIC,
+        .version = IMAGE_VERSION,
+        .source_size = stamp->size,
+        .mtime_sec = stamp->mtime.tv_sec,
+        .mtime_nsec = stamp->mtime.tv_nsec,
+        .source_hash = stamp->hash,
+        .sections_len = sections_number,
+        .properties_len = 0,
+        .strings_size = 0,
+    };
+
+    /* Count the records and the strings before writing them */
+    for (int i = 0; i < sections_number; i++) {
+        ngi_section_t* ngi_section = ngi_get_section(ngi_header, i);
+        const int properties_number = ngi_get_properties_number(ngi_section);
+
+        image.properties_len += properties_number;
+        image.strings_size += ngi_get_section_name_len(ngi_section) + 1;
+
+        for (int j = 0; j < properties_number; j++) {
+            ngi_property_t* ngi_property = ngi_get_property(ngi_section, j);
+
+            image.strings_size += ngi_get_property_name_len(ngi_property) +
+                                  ngi_get_property_value_len(ngi_property) + 2;
+        }
+    }
+
+    /* The offsets of the strings are 32 bits */
+    if (image.strings_size > UINT32_MAX)
+        return 0;
+
+    if (fwrite(&image, sizeof(image), 1, fd) != 1)
+        return 0;
+
+    uint32_t offset = 0;
+
+    for (int i = 0; i < sections_number; i++) {
+        ngi_section_t* ngi_section = ngi_get_section(ngi_header, i);
+        const ngi_span_t* span = ngi_get_section_span(ngi_section);
+        const struct ngi_image_section record = {
+            .name = offset,
+            .name_len = ngi_get_section_name_len(ngi_section),
+            .properties_len = ngi_get_properties_number(ngi_section),
+            .span_length = span->length,
+            .span_offset = span->offset,
+        };
+
+        if (fwrite(&record, sizeof(record), 1, fd) != 1)
+            return 0;
+
+        offset += record.name_len + 1;
+
+        /* The properties strings follow the name of their section */
+        for (uint32_t j = 0; j < record.properties_len; j++) {
+            ngi_property_t* ngi_property = ngi_get_property(ngi_section, j);
+
+            offset += ngi_get_property_name_len(ngi_property) +
+                      ngi_get_property_value_len(ngi_property) + 2;
+        }
+    }
+
+    offset = 0;
+
+    for (int i = 0; i < sections_number; i++) {
+        ngi_section_t* ngi_section = ngi_get_section(ngi_header, i);
+        const int properties_number = ngi_get_properties_number(ngi_section);
+
+        offset += ngi_get_section_name_len(ngi_section) + 1;
+
+        for (int j = 0; j < properties_number; j++) {
+            ngi_property_t* ngi_property = ngi_get_property(ngi_section, j);
+            const ngi_span_t* span = ngi_get_property_span(ngi_property);
+            const struct ngi_image_property record = {
+                .name = offset,
+                .name_len = ngi_get_property_name_len(ngi_property),
+                .value_len = ngi_get_property_value_len(ngi_property),
+                .span_length = span->length,
+                .span_offset = span->offset,
+            };
+
+            if (fwrite(&record, sizeof(record), 1, fd) != 1)
+                return 0;
+
+            offset += record.name_len + record.value_len + 2;
+        }
+    }
+
+    /* The strings table, in the order of the offsets */
+    for (int i = 0; i < sections_number; i++) {
+        ngi_section_t* ngi_section = ngi_get_section(ngi_header, i);
+        const int properties_number = ngi_get_properties_number(ngi_section);
+
+        if (fwrite(ngi_get_section_name(ngi_section),
+                   ngi_get_section_name_len(ngi_section) + 1, 1, fd) != 1)
+            return 0;
+
+        for (int j = 0; j < properties_number; j++) {
+            ngi_property_t* ngi_property = ngi_get_property(ngi_section, j);
+
+            if (fwrite(ngi_get_property_name(ngi_property),
+                       ngi_get_property_name_len(ngi_property) + 1, 1,
+                       fd) != 1 ||
+                fwrite(ngi_get_property_value(ngi_property),
+                       ngi_get_property_value_len(ngi_property) + 1, 1,
+                       fd) != 1)
+                return 0;
+        }
+    }
+
+    return fflush(fd) == 0;
+}
+
+/**
+ * @brief Gets a string of the strings table (**private**)
+ *
+ * @param[in] strings
+ * @param[in] strings_size
+ * @param[in] offset
+ * @param[in] len
+ *
+ * @return The string or NULL if it's not NUL terminated in the table
+ */
+static char* ngi_image_string(char* strings, uint64_t strings_size,
+                              uint32_t offset, uint32_t len) {
+    if (offset >= strings_size || len >= strings_size - offset ||
+        strings[offset + len] != '\0')
+        return NULL;
+
+    return strings + offset;
+}
@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include "libngi/libngi.h"
 #include "libngi/libngi_internal.h"
 
@@ -48,14 +49,20 @@
  * - the value of the property
  * - the size of the name buffer
  * - the size of the value buffer
+ * - the length of the name
+ * - the length of the value
  * - a pointer to the parent ngi_section of the property
+ * - the position of the line in the file
  */
 typedef struct ngi_property {
     char* name;
     char* value;
     int name_size;
     int value_size;
+    int name_len;
+    int value_len;
     ngi_section_t* parent;
+    ngi_span_t span;
 } ngi_property_t;
 
 /**
@@ -64,37 +71,100 @@ typedef struct ngi_property {
  * The ngi_section contains:
  * - the name of the section
  * - the size of the name buffer
- * - an array of pointers pointing a ngi_property
+ * - the length of the name
+ * - a growable array of pointers pointing a ngi_property
  * - the current length of the properties array
+ * - the allocated capacity of the properties array
+ * - a hash index of the properties by name
+ * - the properties sorted by name, built on first search
+ * - a pointer to the parent ngi_header of the section
+ * - the unparsed properties of a lazy section, NULL once they're parsed
+ * - the size of the unparsed properties
+ * - the position of the line in the file
+ * - the hash of the lines of the properties in the file
+ * - if the hash matches the parsed properties
  */
 typedef struct ngi_section {
     char* name;
     int name_size;
-    ngi_property_t* properties[NGI_MAX_PROPERTIES];
+    int name_len;
+    ngi_property_t** properties;
     int properties_len;
+    int properties_capacity;
+    ngi_hash_table_t properties_index;
+    ngi_sorted_index_t properties_order;
+    ngi_header_t* parent;
+    char* body;
+    size_t body_size;
+    ngi_span_t span;
+    uint64_t hash;
+    int hashed;
 } ngi_section_t;
 
 /**
  * @brief Contains the file data
  *
  * The ngi_header contains:
- * - an array of pointers pointing a ngi_section
+ * - the arena holding all the nodes and their strings
+ * - a growable array of pointers pointing a ngi_section
  * - the current length of the sections array
+ * - the allocated capacity of the sections array
+ * - a hash index of the sections by name
+ * - the sections sorted by name, built on first search
  * - the file descriptor as a FILE*
+ * - the name of the file
+ * - the source of the file when it's parsed in place
+ * - the version of the file when it was last read
+ * - the check skipping the recache of an unchanged file
+ * - if the properties are parsed on first access
+ * - if the unparsed properties are records of a compiled image
+ * - the number of references to a header published by a ngi_reloader
+ * - the lock shared by the threads, NULL if the header isn't concurrent
  */
 typedef struct ngi_header {
-    ngi_section_t* sections[NGI_MAX_SECTIONS];
+    ngi_arena_t arena;
+    ngi_section_t** sections;
     int sections_len;
+    int sections_capacity;
+    ngi_hash_table_t sections_index;
+    ngi_sorted_index_t sections_order;
     FILE* fd;
+    char* filename;
+    char* mode;
+    ngi_source_t source;
+    ngi_stamp_t stamp;
+    int recache_check;
+    int lazy;
+    int compiled;
+    int transaction;
+    int refs;
+    ngi_lock_t* lock;
 } ngi_header_t;
 
+/* Initial capacity of the sections and properties arrays */
+#define MIN_ARRAY_CAPACITY 4
+
 /* Private methods */
 void ngi_header_free(ngi_header_t* ngi_header);
 static ngi_header_t* ngi_header_alloc(void);
-static void ngi_balance_sections(ngi_header_t* ngi_header);
-static void ngi_balance_properties(ngi_section_t* ngi_section);
-static void ngi_sections_free(ngi_header_t* ngi_header);
+static void* ngi_array_grow(ngi_arena_t* arena, void* array, int* capacity,
+                            size_t elem_size);
+static void ngi_balance_sections(ngi_header_t* ngi_header, int index);
+static void ngi_balance_properties(ngi_section_t* ngi_section, int index);
 static void ngi_properties_free(ngi_section_t* ngi_section);
+static char* ngi_string_realloc(ngi_header_t* ngi_header, char* str,
+                                int old_size, int new_size);
+static void ngi_string_release(ngi_header_t* ngi_header, char* str, int size);
+static ngi_header_t* ngi_open_source(const char* filename, int lazy);
+static const ngi_sorted_index_t*
+ngi_sections_sorted(const ngi_header_t* ngi_header);
+static const ngi_sorted_index_t*
+ngi_properties_sorted(const ngi_section_t* ngi_section);
+static const char* ngi_section_key(const void* node);
+static const char* ngi_property_key(const void* node);
+static inline const ngi_section_t*
+ngi_section_loaded(const ngi_section_t* ngi_section);
+static char* ngi_tree_render(const ngi_header_t* ngi_header, char* buff);
 
 ngi_header_t* ngi_open(const char* restrict filename, const char* mode) {
     FILE* fd = NULL;
@@ -119,8 +189,16 @@ ngi_header_t* ngi_open(const char* restrict filename, const char* mode) {
     /* Allocate the header */
     ngi_header_t* ngi_header = ngi_header_alloc();
 
+    if (ngi_header == NULL) {
+        fclose(fd);
+        return NULL;
+    }
+
     /* Add the file pointer */
     ngi_header->fd = fd;
+    ngi_header->filename =
+        ngi_arena_strndup(&ngi_header->arena, filename, strlen(filename));
+    ngi_header->mode = ngi_arena_strndup(&ngi_header->arena, mode, strlen(mode));
 
     /* Cache the file */
     ngi_cache_file(ngi_header);
@@ -128,19 +206,142 @@ ngi_header_t* ngi_open(const char* restrict filename, const char* mode) {
     return ngi_header;
 }
 
+ngi_header_t* ngi_open_mmap(const char* restrict filename) {
+    return ngi_open_source(filename, 0);
+}
+
+ngi_header_t* ngi_open_lazy(const char* restrict filename) {
+    return ngi_open_source(filename, 1);
+}
+
+ngi_header_t* ngi_open_compiled(const char* restrict filename) {
+    ngi_stamp_t stamp;
+
+    /* The image is checked against the hash of the contents */
+    if (!ngi_stamp_hash_file(&stamp, filename))
+        return NULL;
+
+    char* image_name = ngi_image_name(filename);
+    if (image_name == NULL)
+        return NULL;
+
+    ngi_header_t* ngi_header = ngi_header_alloc();
+
+    if (ngi_header != NULL) {
+        ngi_header->filename =
+            ngi_arena_strndup(&ngi_header->arena, filename, strlen(filename));
+
+        if (ngi_header->filename != NULL &&
+            ngi_image_load(ngi_header, image_name, &stamp)) {
+            ngi_header->stamp = stamp;
+            ngi_header->compiled = 1;
+            free(image_name);
+            return ngi_header;
+        }
+
+        ngi_header_free(ngi_header);
+    }
+
+    /* Parse the file and build the image for the next opens,
+     * unless the file changed since it was hashed
+     */
+    ngi_header = ngi_open_source(filename, 0);
+
+    if (ngi_header != NULL && ngi_stamp_equals(&ngi_header->stamp, &stamp)) {
+        ngi_header->stamp = stamp;
+        ngi_image_write(ngi_header, image_name, &stamp);
+    }
+
+    free(image_name);
+
+    return ngi_header;
+}
+
+ngi_header_t* ngi_parse_buffer(const char* buff, size_t size) {
+    /* Allocate the header */
+    ngi_header_t* ngi_header = ngi_header_alloc();
+
+    if (ngi_header == NULL)
+        return NULL;
+
+    /* Copy the buffer to parse it in place */
+    if (!ngi_source_copy(&ngi_header->source, buff, size) ||
+        !ngi_cache_file(ngi_header)) {
+        ngi_header_free(ngi_header);
+        return NULL;
+    }
+
+    return ngi_header;
+}
+
+ngi_header_t* ngi_attach_image(int fd) {
+    ngi_header_t* ngi_header = ngi_header_alloc();
+
+    if (ngi_header == NULL)
+        return NULL;
+
+    /* The image has no file to be checked against */
+    if (!ngi_source_map_fd(&ngi_header->source, fd) ||
+        !ngi_image_read(ngi_header, NULL)) {
+        ngi_header_free(ngi_header);
+        return NULL;
+    }
+
+    ngi_header->compiled = 1;
+
+    return ngi_header;
+}
+
 void ngi_close(ngi_header_t* ngi_header) { ngi_header_free(ngi_header); }
 
 void ngi_dump_tree_to_file(ngi_header_t* ngi_header, FILE* fd) {
     /* Dump all the tree in memory in a file */
+    ngi_write_tree(fd, ngi_header);
+}
+
+size_t ngi_dump_size(ngi_header_t* ngi_header) {
+    size_t size = 0;
+
     for (int i = 0; i < ngi_header->sections_len; i++) {
         ngi_section_t* ngi_section = ngi_header->sections[i];
-        ngi_write_section(fd, ngi_section->name);
+        ngi_section_load(ngi_section);
+
+        /* The sections are separated by an empty line */
+        if (i != 0)
+            size++;
+
+        size += ngi_section->name_len + sizeof(SECTION_TKN);
 
         for (int j = 0; j < ngi_section->properties_len; j++) {
             ngi_property_t* ngi_property = ngi_section->properties[j];
-            ngi_write_property(fd, ngi_property->name, ngi_property->value);
+
+            size += ngi_property->name_len + sizeof(PROPERTY_TKN) +
+                    ngi_property->value_len;
         }
     }
+
+    return size;
+}
+
+char* ngi_dump_to_buffer(ngi_header_t* ngi_header, char* buff, size_t* size) {
+    const size_t dump_size = ngi_dump_size(ngi_header);
+
+    if (buff == NULL) {
+        buff = malloc(dump_size + 1);
+
+        if (buff == NULL)
+            return NULL;
+    } else if (*size < dump_size + 1) {
+        /* Tell the caller how much is needed */
+        *size = dump_size;
+        return NULL;
+    }
+
+    /* The size is exact so the buffer is written in one pass */
+    *ngi_tree_render(ngi_header, buff) = '\0';
+    *size = dump_size;
+
+    return buff;
 }
 
 /* Getters */
@@ -148,7 +349,7 @@ void ngi_dump_tree_to_file(ngi_header_t* ngi_header, FILE* fd) {
 ngi_section_t* ngi_get_section(const ngi_header_t* ngi_header,
                                const int section_num) {
     /* Check if the index is valid */
-    if (section_num > ngi_header->sections_len)
+    if (section_num < 0 || section_num >= ngi_header->sections_len)
         return NULL;
 
     return ngi_header->sections[section_num];
@@ -156,27 +357,15 @@ ngi_section_t* ngi_get_section(const ngi_header_t* ngi_header,
 
 ngi_section_t* ngi_get_section_by_name(const ngi_header_t* ngi_header,
                                        const char* name) {
-    ngi_section_t* ngi_section = NULL;
-
-    for (int i = 0; i < ngi_header->sections_len; i++) {
-        ngi_section = ngi_header->sections[i];
-
-        /* Check if the section is NULL */
-        if (ngi_section == NULL)
-            return NULL;
-
-        if (!strcmp(ngi_section->name, name)) {
-            return ngi_section;
-        }
-    }
-
-    return NULL;
+    return ngi_hash_table_find(&ngi_header->sections_index, name);
 }
 
 ngi_property_t* ngi_get_property(const ngi_section_t* ngi_section,
                                  const int property_num) {
+    ngi_section = ngi_section_loaded(ngi_section);
+
     /* Check if the index is valid */
-    if (property_num > ngi_section->properties_len)
+    if (property_num < 0 || property_num >= ngi_section->properties_len)
         return NULL;
 
     return ngi_section->properties[property_num];
@@ -184,21 +373,77 @@ ngi_property_t* ngi_get_property(const ngi_section_t* ngi_section,
 
 ngi_property_t* ngi_get_property_by_name(const ngi_section_t* ngi_section,
                                          const char* name) {
-    ngi_property_t* ngi_property = NULL;
+    ngi_section = ngi_section_loaded(ngi_section);
 
-    for (int i = 0; i < ngi_section->properties_len; i++) {
-        ngi_property = ngi_section->properties[i];
+    return ngi_hash_table_find(&ngi_section->properties_index, name);
+}
 
-        /* Check if the section is NULL */
-        if (ngi_property == NULL)
-            return NULL;
+ngi_section_t* ngi_get_section_by_hash(const ngi_header_t* ngi_header,
+                                       const char* name, uint32_t hash) {
+    return ngi_hash_table_find_hashed(&ngi_header->sections_index, name, hash);
+}
 
-        if (!strcmp(ngi_property->name, name)) {
-            return ngi_property;
-        }
-    }
+ngi_property_t* ngi_get_property_by_hash(const ngi_section_t* ngi_section,
+                                         const char* name, uint32_t hash) {
+    ngi_section = ngi_section_loaded(ngi_section);
 
-    return NULL;
+    return ngi_hash_table_find_hashed(&ngi_section->properties_index, name,
+                                      hash);
+}
+
+void ngi_prefetch_section(const ngi_header_t* ngi_header, uint32_t hash) {
+    ngi_hash_table_prefetch(&ngi_header->sections_index, hash);
+}
+
+void ngi_prefetch_property(const ngi_section_t* ngi_section, uint32_t hash) {
+    ngi_section = ngi_section_loaded(ngi_section);
+
+    ngi_hash_table_prefetch(&ngi_section->properties_index, hash);
+}
+
+int ngi_get_sections_by_prefix(const ngi_header_t* ngi_header,
+                               const char* prefix, int* first) {
+    const ngi_sorted_index_t* index = ngi_sections_sorted(ngi_header);
+
+    return index == NULL ? -1 : ngi_sorted_index_prefix(index, prefix, first);
+}
+
+int ngi_get_sections_by_range(const ngi_header_t* ngi_header,
+                              const char* from, const char* to, int* first) {
+    const ngi_sorted_index_t* index = ngi_sections_sorted(ngi_header);
+
+    return index == NULL ? -1
+                         : ngi_sorted_index_range(index, from, to, first);
+}
+
+ngi_section_t* ngi_get_sorted_section(const ngi_header_t* ngi_header,
+                                      int position) {
+    const ngi_sorted_index_t* index = ngi_sections_sorted(ngi_header);
+
+    return index == NULL ? NULL : ngi_sorted_index_get(index, position);
+}
+
+int ngi_get_properties_by_prefix(const ngi_section_t* ngi_section,
+                                 const char* prefix, int* first) {
+    const ngi_sorted_index_t* index = ngi_properties_sorted(ngi_section);
+
+    return index == NULL ? -1 : ngi_sorted_index_prefix(index, prefix, first);
+}
+
+int ngi_get_properties_by_range(const ngi_section_t* ngi_section,
+                                const char* from, const char* to,
+                                int* first) {
+    const ngi_sorted_index_t* index = ngi_properties_sorted(ngi_section);
+
+    return index == NULL ? -1
+                         : ngi_sorted_index_range(index, from, to, first);
+}
+
+ngi_property_t* ngi_get_sorted_property(const ngi_section_t* ngi_section,
+                                        int position) {
+    const ngi_sorted_index_t* index = ngi_properties_sorted(ngi_section);
+
+    return index == NULL ? NULL : ngi_sorted_index_get(index, position);
 }
 
 int ngi_get_section_index(const ngi_header_t* ngi_header,
@@ -222,6 +467,8 @@ int ngi_get_section_name_size(const ngi_section_t* ngi_section) {
 
 int ngi_get_property_index(const ngi_section_t* ngi_section,
                            const ngi_property_t* ngi_property) {
+    ngi_section = ngi_section_loaded(ngi_section);
+
     for (int i = 0; i < ngi_section->properties_len; i++) {
         if (ngi_section->properties[i] == ngi_property) {
             return i;
@@ -236,6 +483,8 @@ int ngi_get_sections_number(const ngi_header_t* ngi_header) {
 }
 
 int ngi_get_properties_number(const ngi_section_t* ngi_section) {
+    ngi_section = ngi_section_loaded(ngi_section);
+
     return ngi_section->properties_len;
 }
 
@@ -261,53 +510,410 @@ ngi_section_t* ngi_get_property_parent(const ngi_property_t* ngi_property) {
 
 FILE* ngi_get_file(const ngi_header_t* ngi_header) { return ngi_header->fd; }
 
+void ngi_set_file(ngi_header_t* ngi_header, FILE* fd) {
+    if (ngi_header->fd != NULL)
+        fclose(ngi_header->fd);
+
+    ngi_header->fd = fd;
+}
+
+int ngi_reopen_file(ngi_header_t* ngi_header) {
+    struct stat file_stat;
+    struct stat path_stat;
+
+    if (ngi_header->fd == NULL || ngi_header->filename == NULL)
+        return 1;
+
+    /* Check if the file is still the one at the path */
+    if (fstat(fileno(ngi_header->fd), &file_stat) != 0 ||
+        stat(ngi_header->filename, &path_stat) != 0)
+        return 0;
+    if (file_stat.st_dev == path_stat.st_dev &&
+        file_stat.st_ino == path_stat.st_ino)
+        return 1;
+
+    /* Don't truncate or append to the new file */
+    const char* mode = ngi_header->mode[0] == 'r' ? ngi_header->mode : "r+";
+    FILE* fd = fopen(ngi_header->filename, mode);
+
+    if (fd == NULL)
+        return 0;
+
+    ngi_set_file(ngi_header, fd);
+
+    return 1;
+}
+
+ngi_source_t* ngi_get_source(ngi_header_t* ngi_header) {
+    return &ngi_header->source;
+}
+
+int ngi_get_section_name_len(const ngi_section_t* ngi_section) {
+    return ngi_section->name_len;
+}
+
+int ngi_get_property_name_len(const ngi_property_t* ngi_property) {
+    return ngi_property->name_len;
+}
+
+int ngi_get_property_value_len(const ngi_property_t* ngi_property) {
+    return ngi_property->value_len;
+}
+
+ngi_stamp_t* ngi_get_stamp(ngi_header_t* ngi_header) {
+    return &ngi_header->stamp;
+}
+
+int* ngi_get_refs(ngi_header_t* ngi_header) {
+    return &ngi_header->refs;
+}
+
+ngi_lock_t* ngi_get_lock(const ngi_header_t* ngi_header) {
+    return ngi_header->lock;
+}
+
+int ngi_get_recache_check(const ngi_header_t* ngi_header) {
+    return ngi_header->recache_check;
+}
+
+void ngi_set_recache_check(ngi_header_t* ngi_header, int check) {
+    ngi_header->recache_check = check;
+
+    /* The contents may not have been hashed when the file was read */
+    if (check == NGI_RECACHE_HASH && !ngi_header->stamp.hashed)
+        ngi_header->stamp.valid = 0;
+}
+
+const char* ngi_get_filename(const ngi_header_t* ngi_header) {
+    return ngi_header->filename;
+}
+
+int ngi_is_lazy(const ngi_header_t* ngi_header) { return ngi_header->lazy; }
+
+int ngi_is_compiled(const ngi_header_t* ngi_header) {
+    return ngi_header->compiled;
+}
+
+void ngi_set_compiled(ngi_header_t* ngi_header, int compiled) {
+    ngi_header->compiled = compiled;
+}
+
+int ngi_in_transaction(const ngi_header_t* ngi_header) {
+    return ngi_header->transaction;
+}
+
+void ngi_set_transaction(ngi_header_t* ngi_header, int transaction) {
+    ngi_header->transaction = transaction;
+}
+
+const ngi_span_t* ngi_get_section_span(const ngi_section_t* ngi_section) {
+    return &ngi_section->span;
+}
+
+const ngi_span_t* ngi_get_property_span(const ngi_property_t* ngi_property) {
+    return &ngi_property->span;
+}
+
+ngi_header_t* ngi_get_section_parent(const ngi_section_t* ngi_section) {
+    return ngi_section->parent;
+}
+
+int ngi_section_is_loaded(const ngi_section_t* ngi_section) {
+    /* Pairs with the publication of the parsed properties */
+    return __atomic_load_n(&ngi_section->body, __ATOMIC_ACQUIRE) == NULL;
+}
+
+int ngi_section_load(ngi_section_t* ngi_section) {
+    if (ngi_section_is_loaded(ngi_section))
+        return 1;
+
+    /* The readers of a concurrent header may load the section together */
+    ngi_load_lock(ngi_section->parent);
+
+    char* body = ngi_section->body;
+    int res = 1;
+
+    if (body != NULL && ngi_section->parent->compiled) {
+        /* The body holds the records of the properties in the image */
+        res = ngi_image_load_properties(ngi_section, body,
+                                        ngi_section->body_size);
+    } else if (body != NULL &&
+               ngi_source_changed(&ngi_section->parent->source)) {
+        /* The untouched pages of the body show the file written in place,
+         * the offsets are stale until the header is recached
+         */
+        res = 0;
+    } else if (body != NULL) {
+        /* The parser writes in the body, so it's hashed before */
+        const uint64_t hash = ngi_hash_bytes(body, ngi_section->body_size);
+
+        res = ngi_parse_body(ngi_section, body, ngi_section->body_size);
+        if (res)
+            ngi_set_section_hash(ngi_section, hash);
+    }
+
+    if (res) {
+        /* Mark the section as loaded once the properties are complete */
+        __atomic_store_n(&ngi_section->body, NULL, __ATOMIC_RELEASE);
+    } else {
+        /* Retry on the next access */
+        ngi_properties_free(ngi_section);
+        ngi_hash_table_free(&ngi_section->properties_index);
+        ngi_sorted_index_free(&ngi_section->properties_order);
+    }
+
+    ngi_load_unlock(ngi_section->parent);
+
+    return res;
+}
+
+int ngi_get_section_hash(const ngi_section_t* ngi_section, uint64_t* hash) {
+    *hash = ngi_section->hash;
+    return ngi_section->hashed;
+}
+
 /* Setters */
 
+const char* ngi_get_section_body(const ngi_section_t* ngi_section,
+                                 size_t* size) {
+    *size = ngi_section->body_size;
+    return ngi_section->body;
+}
+
+void ngi_set_section_body(ngi_section_t* ngi_section, char* body,
+                          size_t size) {
+    ngi_section->body = body;
+    ngi_section->body_size = size;
+}
+
+void ngi_set_section_hash(ngi_section_t* ngi_section, uint64_t hash) {
+    ngi_section->hash = hash;
+    ngi_section->hashed = 1;
+}
+
+void ngi_set_lock(ngi_header_t* ngi_header, ngi_lock_t* ngi_lock) {
+    ngi_header->lock = ngi_lock;
+}
+
+void ngi_set_section_span(ngi_section_t* ngi_section, const ngi_span_t* span) {
+    ngi_section->span = *span;
+}
+
+void ngi_set_property_span(ngi_property_t* ngi_property,
+                           const ngi_span_t* span) {
+    ngi_property->span = *span;
+}
+
+void ngi_shift_spans(ngi_header_t* ngi_header, long from, long delta) {
+    for (int i = 0; i < ngi_header->sections_len; i++) {
+        ngi_section_t* ngi_section = ngi_header->sections[i];
+
+        if (ngi_section->span.offset >= from)
+            ngi_section->span.offset += delta;
+
+        for (int j = 0; j < ngi_section->properties_len; j++) {
+            ngi_property_t* ngi_property = ngi_section->properties[j];
+
+            if (ngi_property->span.offset >= from)
+                ngi_property->span.offset += delta;
+        }
+    }
+}
+
+void ngi_move_properties(ngi_section_t* ngi_section, long delta,
+                         const ngi_source_t* old_source, char* new_data) {
+    ngi_hash_table_t* index = &ngi_section->properties_index;
+
+    for (int i = 0; i < ngi_section->properties_len; i++) {
+        ngi_property_t* ngi_property = ngi_section->properties[i];
+
+        ngi_property->span.offset += delta;
+
+        if (new_data == NULL)
+            continue;
+
+        /* The strings are at the same place in the new source,
+         * terminate them as the parser would have done
+         */
+        if (ngi_source_contains(old_source, ngi_property->name)) {
+            ngi_property->name =
+                new_data + ((ngi_property->name - old_source->data) + delta);
+            ngi_property->name[ngi_property->name_len] = '\0';
+        }
+
+        if (ngi_source_contains(old_source, ngi_property->value)) {
+            ngi_property->value =
+                new_data + ((ngi_property->value - old_source->data) + delta);
+            ngi_property->value[ngi_property->value_len] = '\0';
+        }
+    }
+
+    /* The keys of the indexes are the names of the properties */
+    for (int i = 0; i < index->capacity; i++) {
+        if (index->entries[i].node != NULL)
+            index->entries[i].key =
+                ((ngi_property_t*)index->entries[i].node)->name;
+    }
+
+    ngi_sorted_index_refresh(&ngi_section->properties_order, ngi_property_key);
+}
+
+void ngi_update_spans(ngi_header_t* ngi_header) {
+    long offset = 0;
+
+    /* Follow the layout of ngi_dump_tree_to_file */
+    for (int i = 0; i < ngi_header->sections_len; i++) {
+        ngi_section_t* ngi_section = ngi_header->sections[i];
+
+        /* The sections are separated by an empty line */
+        if (offset != 0)
+            offset++;
+
+        ngi_section->span.offset = offset;
+        ngi_section->span.length =
+            ngi_section->name_len + sizeof(SECTION_TKN) - 1;
+        offset += ngi_section->span.length + 1;
+
+        for (int j = 0; j < ngi_section->properties_len; j++) {
+            ngi_property_t* ngi_property = ngi_section->properties[j];
+
+            ngi_property->span.offset = offset;
+            ngi_property->span.length = ngi_property->name_len +
+                                        sizeof(PROPERTY_TKN) - 1 +
+                                        ngi_property->value_len;
+            offset += ngi_property->span.length + 1;
+        }
+    }
+}
+
 void ngi_set_section_name(ngi_section_t* ngi_section, const char* name) {
     if (name == NULL)
         return;
 
-    size_t new_name_size = strlen(name);
+    ngi_hash_table_t* index = &ngi_section->parent->sections_index;
+    ngi_sorted_index_t* order = &ngi_section->parent->sections_order;
+    size_t new_name_size = strlen(name) + 1;
+
+    /* The section is indexed by his old name */
+    ngi_hash_table_remove(index, ngi_section->name, ngi_section);
+    ngi_sorted_index_remove(order, ngi_section->name, ngi_section);
 
     /* Check if the new name can fit in the section buffer */
-    if (new_name_size <= ngi_section->name_size) {
-        strncpy(ngi_section->name, name, ngi_section->name_size);
-    } else {
+    if (new_name_size > ngi_section->name_size) {
         /* Realloc the name buffer */
-        ngi_section_realloc(ngi_section, new_name_size);
+        if (!ngi_section_realloc(ngi_section, new_name_size)) {
+            ngi_hash_table_insert(index, ngi_section->name, ngi_section);
+            ngi_sorted_index_insert(order, ngi_section->name, ngi_section);
+            return;
+        }
     }
+
+    /* Copy the new name */
+    memcpy(ngi_section->name, name, new_name_size);
+    ngi_section->name_len = new_name_size - 1;
+
+    /* Can't fail as the indexes have one free entry since the removal */
+    ngi_hash_table_insert(index, ngi_section->name, ngi_section);
+    ngi_sorted_index_insert(order, ngi_section->name, ngi_section);
 }
 
 void ngi_set_property_name(ngi_property_t* ngi_property, const char* name) {
     if (name == NULL)
         return;
 
-    size_t new_name_size = strlen(name);
+    ngi_hash_table_t* index = &ngi_property->parent->properties_index;
+    ngi_sorted_index_t* order = &ngi_property->parent->properties_order;
+    size_t new_name_size = strlen(name) + 1;
+
+    /* The property is indexed by his old name */
+    ngi_hash_table_remove(index, ngi_property->name, ngi_property);
+    ngi_sorted_index_remove(order, ngi_property->name, ngi_property);
 
     /* Check if the new name can fit in the property buffer */
     if (new_name_size > ngi_property->name_size) {
         /* Realloc the name buffer */
-        ngi_property_realloc(ngi_property, new_name_size, 0);
+        if (!ngi_property_realloc(ngi_property, new_name_size, 0)) {
+            ngi_hash_table_insert(index, ngi_property->name, ngi_property);
+            ngi_sorted_index_insert(order, ngi_property->name, ngi_property);
+            return;
+        }
     }
 
     /* Copy the new name */
-    strcpy(ngi_property->name, name);
+    memcpy(ngi_property->name, name, new_name_size);
+    ngi_property->name_len = new_name_size - 1;
+    ngi_property->parent->hashed = 0;
+
+    /* Can't fail as the indexes have one free entry since the removal */
+    ngi_hash_table_insert(index, ngi_property->name, ngi_property);
+    ngi_sorted_index_insert(order, ngi_property->name, ngi_property);
 }
 
 void ngi_set_property_value(ngi_property_t* ngi_property, const char* value) {
     if (value == NULL)
         return;
 
-    size_t new_value_size = strlen(value);
+    size_t new_value_size = strlen(value) + 1;
 
     /* Check if the new value can fit in the property buffer */
     if (new_value_size > ngi_property->value_size) {
         /* Realloc the value buffer */
-        ngi_property_realloc(ngi_property, 0, new_value_size);
+        if (!ngi_property_realloc(ngi_property, 0, new_value_size))
+            return;
     }
 
-    /* Copy the new name */
-    strcpy(ngi_property->value, value);
+    /* Copy the new value */
+    memcpy(ngi_property->value, value, new_value_size);
+    ngi_property->value_len = new_value_size - 1;
+    ngi_property->parent->hashed = 0;
+}
+
+void ngi_set_section_name_view(ngi_section_t* ngi_section, char* name,
+                               int name_len) {
+    ngi_header_t* ngi_header = ngi_section->parent;
+
+    /* The section is indexed by his old name */
+    ngi_hash_table_remove(&ngi_header->sections_index, ngi_section->name,
+                          ngi_section);
+    ngi_sorted_index_rename(&ngi_header->sections_order, ngi_section->name,
+                            name, ngi_section);
+    ngi_string_release(ngi_header, ngi_section->name, ngi_section->name_size);
+
+    ngi_section->name = name;
+    ngi_section->name_size = name_len + 1;
+    ngi_section->name_len = name_len;
+
+    /* Can't fail as the index has one free slot since the removal */
+    ngi_hash_table_insert(&ngi_header->sections_index, ngi_section->name,
+                          ngi_section);
+}
+
+void ngi_set_property_view(ngi_property_t* ngi_property, char* name,
+                           int name_len, char* value, int value_len) {
+    ngi_section_t* ngi_section = ngi_property->parent;
+    ngi_header_t* ngi_header = ngi_section->parent;
+
+    /* The property is indexed by his old name */
+    ngi_hash_table_remove(&ngi_section->properties_index, ngi_property->name,
+                          ngi_property);
+    ngi_sorted_index_rename(&ngi_section->properties_order,
+                            ngi_property->name, name, ngi_property);
+    ngi_string_release(ngi_header, ngi_property->name,
+                       ngi_property->name_size);
+    ngi_string_release(ngi_header, ngi_property->value,
+                       ngi_property->value_size);
+
+    ngi_property->name = name;
+    ngi_property->name_size = name_len + 1;
+    ngi_property->name_len = name_len;
+    ngi_property->value = value;
+    ngi_property->value_size = value_len + 1;
+    ngi_property->value_len = value_len;
+    ngi_section->hashed = 0;
+
+    /* Can't fail as the index has one free slot since the removal */
+    ngi_hash_table_insert(&ngi_section->properties_index, ngi_property->name,
+                          ngi_property);
 }
 
 /**
@@ -323,61 +929,219 @@ static ngi_header_t* ngi_header_alloc(void) {
         return NULL;
 
     /* Initialize the header */
+    ngi_arena_init(&ngi_header->arena);
+    ngi_header->sections = NULL;
     ngi_header->sections_len = 0;
+    ngi_header->sections_capacity = 0;
+    ngi_hash_table_init(&ngi_header->sections_index, &ngi_header->arena);
+    ngi_sorted_index_init(&ngi_header->sections_order, &ngi_header->arena);
     ngi_header->fd = NULL;
+    ngi_header->filename = NULL;
+    ngi_header->mode = NULL;
+    ngi_source_init(&ngi_header->source);
+    ngi_header->stamp.valid = 0;
+    ngi_header->stamp.hashed = 0;
+    ngi_header->recache_check = NGI_RECACHE_STAT;
+    ngi_header->refs = 0;
+    ngi_header->lock = NULL;
+    ngi_header->lazy = 0;
+    ngi_header->compiled = 0;
+    ngi_header->transaction = 0;
 
     return ngi_header;
 }
 
+/* Make room for the sections */
+int ngi_header_reserve(ngi_header_t* ngi_header, int sections) {
+    if (sections > ngi_header->sections_capacity) {
+        ngi_section_t** new_sections = ngi_arena_realloc(
+            &ngi_header->arena, ngi_header->sections,
+            ngi_header->sections_capacity * sizeof(ngi_section_t*),
+            sections * sizeof(ngi_section_t*));
+
+        if (new_sections == NULL)
+            return 0;
+
+        ngi_header->sections = new_sections;
+        ngi_header->sections_capacity = sections;
+    }
+
+    return ngi_hash_table_reserve(&ngi_header->sections_index, sections);
+}
+
+/* Make room for the properties */
+int ngi_section_reserve(ngi_section_t* ngi_section, int properties) {
+    if (properties > ngi_section->properties_capacity) {
+        ngi_property_t** new_properties = ngi_arena_realloc(
+            &ngi_section->parent->arena, ngi_section->properties,
+            ngi_section->properties_capacity * sizeof(ngi_property_t*),
+            properties * sizeof(ngi_property_t*));
+
+        if (new_properties == NULL)
+            return 0;
+
+        ngi_section->properties = new_properties;
+        ngi_section->properties_capacity = properties;
+    }
+
+    return ngi_hash_table_reserve(&ngi_section->properties_index, properties);
+}
+
 /* Allocate a section */
 ngi_section_t* ngi_section_alloc(ngi_header_t* ngi_header, const char* name) {
-    ngi_section_t* ngi_section = malloc(sizeof(ngi_section_t));
+    const int name_len = strlen(name);
+    char* name_copy = ngi_arena_strndup(&ngi_header->arena, name, name_len);
+
+    if (name_copy == NULL)
+        return NULL;
+
+    ngi_section_t* ngi_section =
+        ngi_section_alloc_view(ngi_header, name_copy, name_len);
+
+    if (ngi_section == NULL)
+        ngi_arena_release(&ngi_header->arena, name_copy, name_len + 1);
+
+    return ngi_section;
+}
+
+/* Allocate a section using the name buffer */
+ngi_section_t* ngi_section_alloc_view(ngi_header_t* ngi_header, char* name,
+                                      int name_len) {
+    ngi_arena_t* arena = &ngi_header->arena;
+
+    /* Make room for the new section */
+    if (ngi_header->sections_len == ngi_header->sections_capacity) {
+        ngi_section_t** sections =
+            ngi_array_grow(arena, ngi_header->sections,
+                           &ngi_header->sections_capacity,
+                           sizeof(ngi_section_t*));
+
+        if (sections == NULL)
+            return NULL;
+
+        ngi_header->sections = sections;
+    }
+
+    ngi_section_t* ngi_section = ngi_arena_alloc(arena, sizeof(ngi_section_t));
 
     if (ngi_section == NULL)
         return NULL;
 
     /* Initialize the section */
+    ngi_section->name = name;
+    ngi_section->name_size = name_len + 1;
+    ngi_section->name_len = name_len;
+    ngi_section->properties = NULL;
     ngi_section->properties_len = 0;
+    ngi_section->properties_capacity = 0;
+    ngi_hash_table_init(&ngi_section->properties_index, arena);
+    ngi_sorted_index_init(&ngi_section->properties_order, arena);
+    ngi_section->parent = ngi_header;
+    ngi_section->body = NULL;
+    ngi_section->body_size = 0;
+    ngi_section->span = (ngi_span_t){.offset = -1, .length = 0};
+    ngi_section->hash = 0;
+    ngi_section->hashed = 0;
+
+    /* Index the section by name */
+    if (!ngi_hash_table_insert(&ngi_header->sections_index, ngi_section->name,
+                               ngi_section)) {
+        ngi_arena_release(arena, ngi_section, sizeof(ngi_section_t));
+        return NULL;
+    }
+
+    if (!ngi_sorted_index_insert(&ngi_header->sections_order,
+                                 ngi_section->name, ngi_section)) {
+        ngi_hash_table_remove(&ngi_header->sections_index, ngi_section->name,
+                              ngi_section);
+        ngi_arena_release(arena, ngi_section, sizeof(ngi_section_t));
+        return NULL;
+    }
 
     /* Add the section */
     ngi_header->sections[ngi_header->sections_len] = ngi_section;
     ngi_header->sections_len++;
 
-    /* Add the name */
-    ngi_section->name_size = strlen(name) + 1;
-    ngi_section->name = malloc(sizeof(char) * ngi_section->name_size);
+    return ngi_section;
+}
+
+/* Allocate a property */
+ngi_property_t* ngi_property_alloc(ngi_section_t* ngi_section,
+                                   const char* name, const char* value) {
+    ngi_arena_t* arena = &ngi_section->parent->arena;
+    const int name_len = strlen(name);
+    const int value_len = strlen(value);
+    char* name_copy = ngi_arena_strndup(arena, name, name_len);
+    char* value_copy = ngi_arena_strndup(arena, value, value_len);
+    ngi_property_t* ngi_property = NULL;
 
-    if (ngi_section->name == NULL)
-        return NULL;
+    if (name_copy != NULL && value_copy != NULL)
+        ngi_property = ngi_property_alloc_view(ngi_section, name_copy,
+                                               name_len, value_copy, value_len);
 
-    strcpy(ngi_section->name, name);
+    if (ngi_property == NULL) {
+        ngi_arena_release(arena, name_copy, name_len + 1);
+        ngi_arena_release(arena, value_copy, value_len + 1);
+    }
 
-    return ngi_section;
+    return ngi_property;
 }
 
-/* Allocate a property */
-ngi_property_t* ngi_property_alloc(ngi_section_t* ngi_section, int name_size,
-                                   int value_size) {
-    ngi_property_t* ngi_property = malloc(sizeof(ngi_property_t));
+/* Allocate a property using the name and value buffers */
+ngi_property_t* ngi_property_alloc_view(ngi_section_t* ngi_section, char* name,
+                                        int name_len, char* value,
+                                        int value_len) {
+    ngi_arena_t* arena = &ngi_section->parent->arena;
 
-    if (ngi_property == NULL)
-        return NULL;
+    /* Make room for the new property */
+    if (ngi_section->properties_len == ngi_section->properties_capacity) {
+        ngi_property_t** properties = ngi_array_grow(
+            arena, ngi_section->properties, &ngi_section->properties_capacity,
+            sizeof(ngi_property_t*));
 
-    /* Initialize the section */
-    ngi_property->name = malloc(name_size);
-    ngi_property->value = malloc(value_size);
-    ngi_property->name_size = name_size;
-    ngi_property->value_size = value_size;
+        if (properties == NULL)
+            return NULL;
+
+        ngi_section->properties = properties;
+    }
 
-    if (ngi_property->name == NULL || ngi_property->value == NULL)
+    ngi_property_t* ngi_property =
+        ngi_arena_alloc(arena, sizeof(ngi_property_t));
+
+    if (ngi_property == NULL)
         return NULL;
 
+    /* Initialize the property */
+    ngi_property->name = name;
+    ngi_property->value = value;
+    ngi_property->name_size = name_len + 1;
+    ngi_property->value_size = value_len + 1;
+    ngi_property->name_len = name_len;
+    ngi_property->value_len = value_len;
+
     /* Set the parent as the section pointer */
     ngi_property->parent = ngi_section;
+    ngi_property->span = (ngi_span_t){.offset = -1, .length = 0};
+
+    /* Index the property by name */
+    if (!ngi_hash_table_insert(&ngi_section->properties_index,
+                               ngi_property->name, ngi_property)) {
+        ngi_arena_release(arena, ngi_property, sizeof(ngi_property_t));
+        return NULL;
+    }
+
+    if (!ngi_sorted_index_insert(&ngi_section->properties_order,
+                                 ngi_property->name, ngi_property)) {
+        ngi_hash_table_remove(&ngi_section->properties_index,
+                              ngi_property->name, ngi_property);
+        ngi_arena_release(arena, ngi_property, sizeof(ngi_property_t));
+        return NULL;
+    }
 
     /* Add the property */
     ngi_section->properties[ngi_section->properties_len] = ngi_property;
     ngi_section->properties_len++;
+    ngi_section->hashed = 0;
 
     return ngi_property;
 }
@@ -386,88 +1150,103 @@ ngi_property_t* ngi_property_alloc(ngi_section_t* ngi_section, int name_size,
 int ngi_section_realloc(ngi_section_t* ngi_section, int new_name_size) {
     /* Check if the value is above zero */
     if (new_name_size > 0) {
-        ngi_section->name = realloc(ngi_section->name, new_name_size);
+        char* name = ngi_string_realloc(ngi_section->parent, ngi_section->name,
+                                        ngi_section->name_size, new_name_size);
+
+        /* Check for allocation errors */
+        if (name == NULL)
+            return 0;
+
+        ngi_section->name = name;
         ngi_section->name_size = new_name_size;
     }
 
-    /* Check for allocation errors */
-    if (ngi_section->name == NULL)
-        return 0;
-
     return 1;
 }
 
 /* Realloc a property */
 int ngi_property_realloc(ngi_property_t* ngi_property, int new_name_size,
                          int new_value_size) {
-    /* Check if the value is above zero or it's the actual size */
-    if (new_name_size > 0 || ngi_property->name_size == new_name_size) {
-        ngi_property->name = realloc(ngi_property->name, new_name_size);
+    ngi_header_t* ngi_header = ngi_property->parent->parent;
+
+    /* Check if the value is above zero */
+    if (new_name_size > 0) {
+        char* name = ngi_string_realloc(ngi_header, ngi_property->name,
+                                        ngi_property->name_size, new_name_size);
+
+        /* Check for allocation errors */
+        if (name == NULL)
+            return 0;
+
+        ngi_property->name = name;
         ngi_property->name_size = new_name_size;
     }
 
-    /* Check if the value is above zero or it's the actual size */
-    if (new_value_size > 0 || ngi_property->value_size == new_value_size) {
-        ngi_property->value = realloc(ngi_property->value, new_name_size);
+    /* Check if the value is above zero */
+    if (new_value_size > 0) {
+        char* value =
+            ngi_string_realloc(ngi_header, ngi_property->value,
+                               ngi_property->value_size, new_value_size);
+
+        /* Check for allocation errors */
+        if (value == NULL)
+            return 0;
+
+        ngi_property->value = value;
         ngi_property->value_size = new_value_size;
     }
 
-    /* Check for allocation errors */
-    if (ngi_property->name == NULL || ngi_property->value == NULL)
-        return 0;
-
     return 1;
 }
 
 /**
  * @brief Frees a ngi_header (**private**)
  *
+ * All the nodes are in the arena and are freed at once
+ *
  * @param[in] ngi_header
  */
 void ngi_header_free(ngi_header_t* ngi_header) {
-    /* Check for childs */
-    if (ngi_header->sections_len != 0) {
-        ngi_sections_free(ngi_header);
-        fclose(ngi_header->fd);
-        free(ngi_header);
-    } else {
+    ngi_arena_free(&ngi_header->arena);
+    ngi_source_free(&ngi_header->source);
+
+    if (ngi_header->fd != NULL)
         fclose(ngi_header->fd);
-        free(ngi_header);
-    }
+
+    ngi_lock_free(ngi_header->lock);
+    free(ngi_header);
 }
 
 void ngi_section_free(ngi_header_t* ngi_header, ngi_section_t* ngi_section) {
-    /* Check if the property is NULL */
+    /* Check if the section is NULL */
     if (ngi_section == NULL)
         return;
 
-    /* Check if the pointer is the last one */
-    if (ngi_header->sections[ngi_header->sections_len] == ngi_section) {
-        if (ngi_section->properties_len != 0)
-            ngi_properties_free(ngi_section);
-
-        free(ngi_section->name);
-        free(ngi_section);
-
-        /* Ensure to remove the pointer on the array */
-        ngi_header->sections[ngi_header->sections_len] = NULL;
-
-        ngi_header->sections_len--;
-        return;
-    }
+    ngi_arena_t* arena = &ngi_header->arena;
 
-    for (int i = 0; i < ngi_header->sections_len; i++) {
+    /* Start from the end as the last section is the most removed one */
+    for (int i = ngi_header->sections_len - 1; i >= 0; i--) {
         if (ngi_header->sections[i] == ngi_section) {
+            ngi_hash_table_remove(&ngi_header->sections_index,
+                                  ngi_section->name, ngi_section);
+            ngi_sorted_index_remove(&ngi_header->sections_order,
+                                    ngi_section->name, ngi_section);
+
+            /* Check for childs */
             if (ngi_section->properties_len != 0)
                 ngi_properties_free(ngi_section);
 
-            free(ngi_section->name);
-            free(ngi_section);
-
-            /* Ensure to remove the pointer on the array */
-            ngi_header->sections[i] = NULL;
-
-            ngi_balance_sections(ngi_header);
+            /* Give back the memory to the arena to be reused */
+            ngi_hash_table_free(&ngi_section->properties_index);
+            ngi_sorted_index_free(&ngi_section->properties_order);
+            ngi_arena_release(arena, ngi_section->properties,
+                              ngi_section->properties_capacity *
+                                  sizeof(ngi_property_t*));
+            ngi_string_release(ngi_header, ngi_section->name,
+                               ngi_section->name_size);
+            ngi_arena_release(arena, ngi_section, sizeof(ngi_section_t));
+
+            ngi_balance_sections(ngi_header, i);
             return;
         }
     }
@@ -479,59 +1258,156 @@ void ngi_property_free(ngi_section_t* ngi_section,
     if (ngi_property == NULL)
         return;
 
-    /* Check if the pointer is the last one */
-    if (ngi_section->properties[ngi_section->properties_len] == ngi_property) {
-        free(ngi_property->value);
-        free(ngi_property->name);
-        free(ngi_property);
+    ngi_arena_t* arena = &ngi_section->parent->arena;
 
-        /* Ensure to remove the pointer on the array */
-        ngi_section->properties[ngi_section->properties_len] = NULL;
-
-        ngi_section->properties_len--;
-        return;
+    /* Start from the end as the last property is the most removed one */
+    for (int i = ngi_section->properties_len - 1; i >= 0; i--) {
+        if (ngi_section->properties[i] == ngi_property) {
+            ngi_hash_table_remove(&ngi_section->properties_index,
+                                  ngi_property->name, ngi_property);
+            ngi_sorted_index_remove(&ngi_section->properties_order,
+                                    ngi_property->name, ngi_property);
+
+            /* Give back the memory to the arena to be reused */
+            ngi_string_release(ngi_section->parent, ngi_property->value,
+                               ngi_property->value_size);
+            ngi_string_release(ngi_section->parent, ngi_property->name,
+                               ngi_property->name_size);
+            ngi_arena_release(arena, ngi_property, sizeof(ngi_property_t));
+
+            ngi_balance_properties(ngi_section, i);
+            ngi_section->hashed = 0;
+            return;
+        }
     }
+}
 
-    for (int i = 0; i < ngi_section->properties_len; i++) {
-        if (ngi_section->properties[i] == ngi_property) {
-            free(ngi_property->value);
-            free(ngi_property->name);
-            free(ngi_property);
+/**
+ * @brief Opens a file mapped in memory (**private**)
+ *
+ * @param[in] filename
+ * @param[in] lazy
+ *
+ * @return A new ngi_header or NULL if the file can't be mapped or parsed
+ */
+static ngi_header_t* ngi_open_source(const char* restrict filename,
+                                     int lazy) {
+    /* Allocate the header */
+    ngi_header_t* ngi_header = ngi_header_alloc();
 
-            /* Ensure to remove the pointer on the array */
-            ngi_section->properties[i] = NULL;
+    if (ngi_header == NULL)
+        return NULL;
 
-            ngi_balance_properties(ngi_section);
-            return;
-        }
+    /* Map the file to parse it in place */
+    if (!ngi_source_map(&ngi_header->source, filename)) {
+        ngi_header_free(ngi_header);
+        return NULL;
     }
+
+    ngi_header->filename =
+        ngi_arena_strndup(&ngi_header->arena, filename, strlen(filename));
+    ngi_header->lazy = lazy;
+
+    /* Cache the file, a partial tree is not returned */
+    if (ngi_header->filename == NULL || !ngi_cache_file(ngi_header)) {
+        ngi_header_free(ngi_header);
+        return NULL;
+    }
+
+    return ngi_header;
 }
 
 /**
- * @brief Frees all the ngi_sections (**private**)
+ * @brief Parses the properties of a lazy ngi_section if needed (**private**)
+ *
+ * Parsing the properties doesn't change the content of the ngi_section
+ * seen by the getters, so they keep a const parameter
+ *
+ * @param[in] ngi_section
+ *
+ * @return The ngi_section
+ */
+static inline const ngi_section_t*
+ngi_section_loaded(const ngi_section_t* ngi_section) {
+    if (!ngi_section_is_loaded(ngi_section))
+        ngi_section_load((ngi_section_t*)ngi_section);
+
+    return ngi_section;
+}
+
+/**
+ * @brief Builds the sorted index of the sections if needed (**private**)
  *
  * @param[in] ngi_header
+ *
+ * @return The index or NULL if it can't be allocated
  */
-static void ngi_sections_free(ngi_header_t* ngi_header) {
-    for (int i = 0; i < ngi_header->sections_len; i++) {
-        ngi_section_t* ngi_section = ngi_header->sections[i];
+static const ngi_sorted_index_t*
+ngi_sections_sorted(const ngi_header_t* ngi_header) {
+    ngi_header_t* header = (ngi_header_t*)ngi_header;
+    int res = 1;
 
-        if (ngi_section == NULL)
-            break;
+    /* The readers of a concurrent header may search it together */
+    if (!ngi_sorted_index_is_built(&header->sections_order)) {
+        ngi_load_lock(header);
 
-        /* Check for childs */
-        if (ngi_section->properties_len != 0)
-            ngi_properties_free(ngi_section);
+        if (!ngi_sorted_index_is_built(&header->sections_order))
+            res = ngi_sorted_index_build(
+                &header->sections_order, (void* const*)header->sections,
+                header->sections_len, ngi_section_key);
 
-        /* Free the name buffer and the section itself */
-        free(ngi_section->name);
-        free(ngi_section);
+        ngi_load_unlock(header);
+    }
 
-        /* Ensure to remove the pointer on the array */
-        ngi_header->sections[i] = NULL;
+    return res ? &header->sections_order : NULL;
+}
+
+/**
+ * @brief Builds the sorted index of the properties if needed (**private**)
+ *
+ * @param[in] ngi_section
+ *
+ * @return The index or NULL if it can't be allocated
+ */
+static const ngi_sorted_index_t*
+ngi_properties_sorted(const ngi_section_t* ngi_section) {
+    ngi_section_t* section = (ngi_section_t*)ngi_section_loaded(ngi_section);
+    int res = 1;
+
+    if (!ngi_sorted_index_is_built(&section->properties_order)) {
+        ngi_load_lock(section->parent);
+
+        if (!ngi_sorted_index_is_built(&section->properties_order))
+            res = ngi_sorted_index_build(
+                &section->properties_order, (void* const*)section->properties,
+                section->properties_len, ngi_property_key);
+
+        ngi_load_unlock(section->parent);
     }
 
-    ngi_header->sections_len = 0;
+    return res ? &section->properties_order : NULL;
+}
+
+/**
+ * @brief Gets the key of a ngi_section in the sorted index (**private**)
+ *
+ * @param[in] node
+ *
+ * @return The name of the ngi_section
+ */
+static const char* ngi_section_key(const void* node) {
+    return ((const ngi_section_t*)node)->name;
+}
+
+/**
+ * @brief Gets the key of a ngi_property in the sorted index (**private**)
+ *
+ * @param[in] node
+ *
+ * @return The name of the ngi_property
+ */
+static const char* ngi_property_key(const void* node) {
+    return ((const ngi_property_t*)node)->name;
 }
 
 /**
@@ -540,70 +1416,172 @@ static void ngi_sections_free(ngi_header_t* ngi_header) {
  * @param[in] ngi_section
  */
 static void ngi_properties_free(ngi_section_t* ngi_section) {
+    ngi_header_t* ngi_header = ngi_section->parent;
+
     for (int i = 0; i < ngi_section->properties_len; i++) {
         ngi_property_t* ngi_property = ngi_section->properties[i];
 
-        if (ngi_property == NULL)
-            break;
-
-        if (ngi_section != NULL) {
-            /* Free the name and value buffer and the property itself */
-            free(ngi_property->name);
-            free(ngi_property->value);
-            free(ngi_property);
-
-            /* Ensure to remove the pointer on the array */
-            ngi_section->properties[i] = NULL;
-        }
+        /* Give back the name and value buffer and the property itself */
+        ngi_string_release(ngi_header, ngi_property->value,
+                           ngi_property->value_size);
+        ngi_string_release(ngi_header, ngi_property->name,
+                           ngi_property->name_size);
+        ngi_arena_release(&ngi_header->arena, ngi_property,
+                          sizeof(ngi_property_t));
     }
 
     ngi_section->properties_len = 0;
 }
 
 /**
- * @brief Balances all the ngi_sections (**private**)
+ * @brief Grows an array of pointers (**private**)
  *
- * Removes the ngi_sections pointers pointing to NULL in the sections array
+ * The capacity is doubled to keep the insertions in amortized constant time
+ *
+ * @param[in] arena
+ * @param[in] array
+ * @param[in,out] capacity
+ * @param[in] elem_size
+ *
+ * @return The reallocated array or NULL if the allocation has failed
+ */
+static void* ngi_array_grow(ngi_arena_t* arena, void* array, int* capacity,
+                            size_t elem_size) {
+    int new_capacity =
+        *capacity < MIN_ARRAY_CAPACITY ? MIN_ARRAY_CAPACITY : *capacity * 2;
+    void* new_array = ngi_arena_realloc(arena, array, *capacity * elem_size,
+                                        new_capacity * elem_size);
+
+    if (new_array == NULL)
+        return NULL;
+
+    *capacity = new_capacity;
+    return new_array;
+}
+
+/**
+ * @brief Checks if a name or value buffer is in the arena (**private**)
+ *
+ * The other buffers point in a source, the current one in most cases
  *
  * @param[in] ngi_header
+ * @param[in] str
+ *
+ * @return 1 if the buffer is in the arena, 0 otherwise
  */
-static void ngi_balance_sections(ngi_header_t* ngi_header) {
-    /* Alloc a new list */
-    ngi_section_t* new_sections[ngi_header->sections_len];
-    for (int i = 0; i < ngi_header->sections_len; i++) {
-        if (ngi_header->sections[i] != NULL) {
-            new_sections[i] = ngi_header->sections[i];
-        }
-    }
+static inline int ngi_string_owned(const ngi_header_t* ngi_header,
+                                   const char* str) {
+    return !ngi_source_contains(&ngi_header->source, str) &&
+           ngi_arena_contains(&ngi_header->arena, str);
+}
+
+/**
+ * @brief Reallocates a name or value buffer (**private**)
+ *
+ * The buffers pointing in a source are copied in the arena
+ *
+ * @param[in] ngi_header
+ * @param[in] str
+ * @param[in] old_size
+ * @param[in] new_size
+ *
+ * @return The reallocated buffer or NULL if the allocation has failed
+ */
+static char* ngi_string_realloc(ngi_header_t* ngi_header, char* str,
+                                int old_size, int new_size) {
+    if (ngi_string_owned(ngi_header, str))
+        return ngi_arena_realloc(&ngi_header->arena, str, old_size, new_size);
+
+    char* new_str = ngi_arena_alloc(&ngi_header->arena, new_size);
+
+    if (new_str != NULL)
+        memcpy(new_str, str, old_size < new_size ? old_size : new_size);
+
+    return new_str;
+}
+
+/**
+ * @brief Releases a name or value buffer (**private**)
+ *
+ * The buffers pointing in a source are left untouched
+ *
+ * @param[in] ngi_header
+ * @param[in] str
+ * @param[in] size
+ */
+static void ngi_string_release(ngi_header_t* ngi_header, char* str,
+                               int size) {
+    if (ngi_string_owned(ngi_header, str))
+        ngi_arena_release(&ngi_header->arena, str, size);
+}
 
+/**
+ * @brief Balances all the ngi_sections (**private**)
+ *
+ * Removes the hole left by a freed ngi_section in the sections array
+ *
+ * @param[in] ngi_header
+ * @param[in] index
+ */
+static void ngi_balance_sections(ngi_header_t* ngi_header, int index) {
     ngi_header->sections_len--;
 
-    /* Copy the list */
-    for (int i = 0; i < ngi_header->sections_len; i++)
-        ngi_header->sections[i] = new_sections[i];
+    /* Move the next pointers to fill the hole */
+    memmove(&ngi_header->sections[index], &ngi_header->sections[index + 1],
+            (ngi_header->sections_len - index) * sizeof(ngi_section_t*));
 }
 
 /**
  * @brief Balances all the ngi_properties (**private**)
  *
- * Removes the ngi_properties pointers pointing to NULL in the properties array
+ * Removes the hole left by a freed ngi_property in the properties array
  *
  * @param[in] ngi_section
+ * @param[in] index
  */
-static void ngi_balance_properties(ngi_section_t* ngi_section) {
-    /* Alloc a new list */
-    ngi_property_t* new_properties[ngi_section->properties_len];
-    for (int i = 0; i < ngi_section->properties_len; i++) {
-        if (ngi_section->properties[i] != NULL) {
-            new_properties[i] = ngi_section->properties[i];
+static void ngi_balance_properties(ngi_section_t* ngi_section, int index) {
+    ngi_section->properties_len--;
+
+    /* Move the next pointers to fill the hole */
+    memmove(&ngi_section->properties[index],
+            &ngi_section->properties[index + 1],
+            (ngi_section->properties_len - index) * sizeof(ngi_property_t*));
+}
+
+/**
+ * @brief Writes the tree in a buffer of ngi_dump_size bytes (**private**)
+ *
+ * @param[in] ngi_header
+ * @param[out] buff
+ *
+ * @return The end of the written bytes
+ */
+static char* ngi_tree_render(const ngi_header_t* ngi_header, char* buff) {
+    for (int i = 0; i < ngi_header->sections_len; i++) {
+        const ngi_section_t* ngi_section = ngi_header->sections[i];
+
+        if (i != 0)
+            *buff++ = '\n';
+
+        memcpy(buff, ngi_section->name, ngi_section->name_len);
+        buff += ngi_section->name_len;
+        memcpy(buff, SECTION_TKN "\n", sizeof(SECTION_TKN));
+        buff += sizeof(SECTION_TKN);
+
+        for (int j = 0; j < ngi_section->properties_len; j++) {
+            const ngi_property_t* ngi_property = ngi_section->properties[j];
+
+            memcpy(buff, ngi_property->name, ngi_property->name_len);
+            buff += ngi_property->name_len;
+            memcpy(buff, PROPERTY_TKN, sizeof(PROPERTY_TKN) - 1);
+            buff += sizeof(PROPERTY_TKN) - 1;
+            memcpy(buff, ngi_property->value, ngi_property->value_len);
+            buff += ngi_property->value_len;
+            *buff++ = '\n';
         }
     }
 
-    ngi_section->properties_len--;
-
-    /* Copy the list */
-    for (int i = 0; i < ngi_section->properties_len; i++)
-        ngi_section->properties[i] = new_properties[i];
+    return buff;
 }
 
 #ifndef NDEBUG
@@ -626,3 +1604,4 @@ void ngi_print_map(const ngi_header_t* ngi_header) {
     printf("\n");
 }
 #endif
+
@@ -29,144 +29,427 @@
 #include "libngi/libngi.h"
 #include "libngi/libngi_internal.h"
 
-inline int ngi_parse_file(ngi_header_t* ngi_header);
-static int ngi_parse_sections(ngi_header_t* ngi_header);
-static ngi_section_t* ngi_parse_section(ngi_header_t* ngi_header, char* buff);
-static int ngi_parse_properties(ngi_header_t* ngi_header,
-                                ngi_section_t* ngi_section);
-static ngi_property_t* ngi_parse_property(ngi_section_t* ngi_section,
-                                          char* buff);
-
-inline int ngi_parse_file(ngi_header_t* ngi_header) {
-    return ngi_parse_sections(ngi_header);
-}
+/* Number of lines classified at once */
+#define LINES_PER_BATCH 256
+
+int ngi_parse_file(ngi_header_t* ngi_header);
+int ngi_parse_stream(FILE* fd, const ngi_parser_ops_t* ops, void* ctx);
+int ngi_parse_memory(char* buff, size_t size, long offset,
+                     const ngi_parser_ops_t* ops, void* ctx);
+int ngi_parse_sections(char* buff, size_t size, const ngi_parser_ops_t* ops,
+                       void* ctx);
+int ngi_parse_body(ngi_section_t* ngi_section, char* body, size_t size);
+static int ngi_parse_section(void* ctx, char* name, int name_len,
+                             const ngi_span_t* span);
+static int ngi_parse_property(void* ctx, char* name, int name_len, char* value,
+                              int value_len, const ngi_span_t* span);
+static int ngi_parse_section_body(void* ctx, char* body, size_t size);
+static int ngi_parse_section_hash(void* ctx, uint64_t hash);
+static void ngi_hash_lines(const char* buff, size_t size, size_t pos,
+                           const ngi_line_t* lines, size_t lines_len,
+                           ngi_hash_state_t* hash, int* hashing,
+                           uint64_t* hashes);
 
 /**
- * @brief Parses all the sections (**private**)
+ * @brief Stores the parsing state of the tree (**private**)
  *
- * @param[in] ngi_header
- *
- * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ * The nodes point in the parsed buffer when views is set
  */
-static int ngi_parse_sections(ngi_header_t* ngi_header) {
+struct parse_state {
+    ngi_header_t* ngi_header;
+    ngi_section_t* current_section;
+    int views;
+};
+
+int ngi_parse_file(ngi_header_t* ngi_header) {
+    const ngi_parser_ops_t ops = {
+        .section = ngi_parse_section,
+        .property = ngi_parse_property,
+        .body = ngi_parse_section_body,
+        .hash = ngi_parse_section_hash,
+    };
+    struct parse_state state = {
+        .ngi_header = ngi_header,
+        .current_section = NULL,
+        .views = 0,
+    };
+
     FILE* fd = ngi_get_file(ngi_header);
-    if (fd == NULL)
+    ngi_source_t* source = ngi_get_source(ngi_header);
+    int res = 0;
+
+    /* Parse in place the mapped file or read the file,
+     * the properties of a lazy header are parsed on first access
+     */
+    if (source->data != NULL && ngi_is_lazy(ngi_header)) {
+        state.views = 1;
+        res = ngi_parse_sections(source->data, source->size, &ops, &state);
+    } else if (source->data != NULL) {
+        state.views = 1;
+        res = ngi_parse_memory(source->data, source->size, 0, &ops, &state);
+    } else if (fd != NULL) {
+        res = ngi_parse_stream(fd, &ops, &state);
+    }
+
+    if (!res)
         return 0;
 
+#ifndef NDEBUG
+    ngi_print_map(ngi_header);
+#endif
+
+    return 1;
+}
+
+int ngi_parse_stream(FILE* fd, const ngi_parser_ops_t* ops, void* ctx) {
     char buff[NGI_MAX_LINE_LENGTH];
-    long offset = ngi_find_next_section(ngi_header);
+    ngi_tokens_t tokens;
+    ngi_hash_state_t hash;
+    int in_section = 0;
+    long offset = 0;
+
+    /* Go to the beginning of the file to parse the whole file */
+    rewind(fd);
+
+    /* Read each line only once */
+    while (fgets(buff, NGI_MAX_LINE_LENGTH, fd) != NULL) {
+        size_t len = strlen(buff);
+
+        /* The span doesn't include the new line */
+        const ngi_span_t span = {
+            .offset = offset,
+            .length = len - (len > 0 && buff[len - 1] == '\n'),
+        };
+        offset += len;
+
+        const enum ngi_type type = ngi_tokenize_line(buff, len, &tokens);
 
-    /* Loop on all sections */
-    while (offset != -1) {
-        fseek(fd, offset, SEEK_SET);
-        fgets(buff, NGI_MAX_LINE_LENGTH, fd);
+        /* Hash the line before the NUL bytes are written in it */
+        if (ops->hash != NULL && type != SECTION && in_section)
+            ngi_hash_update(&hash, buff, len);
 
-        ngi_section_t* ngi_section = ngi_parse_section(ngi_header, buff);
+        switch (type) {
+        case SECTION:
+            /* The lines of the previous section end here */
+            if (ops->hash != NULL) {
+                if (in_section && !ops->hash(ctx, ngi_hash_final(&hash)))
+                    return 0;
 
-        if (ngi_section == NULL)
-            return 0;
+                ngi_hash_init(&hash);
+                in_section = 1;
+            }
 
-        /* Get next section offset */
-        offset = ngi_find_next_section(ngi_header);
+            /* The name ends before the token */
+            buff[tokens.name_len] = '\0';
+
+            if (!ops->section(ctx, buff, tokens.name_len, &span))
+                return 0;
+            break;
+
+        case PROPERTY: {
+            /* Terminate the name and the value in place */
+            char* value = buff + tokens.value_start;
+            buff[tokens.name_len] = '\0';
+            value[tokens.value_len] = '\0';
+
+            if (!ops->property(ctx, buff, tokens.name_len, value,
+                               tokens.value_len, &span))
+                return 0;
+            break;
+        }
+
+        default:
+            break;
+        }
     }
 
-#ifndef NDEBUG
-    ngi_print_map(ngi_header);
-#endif
+    /* The lines of the last section end with the file */
+    if (ops->hash != NULL && in_section &&
+        !ops->hash(ctx, ngi_hash_final(&hash)))
+        return 0;
+
+    return 1;
+}
+
+int ngi_parse_memory(char* buff, size_t size, long offset,
+                     const ngi_parser_ops_t* ops, void* ctx) {
+    ngi_line_t lines[LINES_PER_BATCH];
+    uint64_t hashes[LINES_PER_BATCH];
+    ngi_hash_state_t hash;
+    int hashing = 0;
+    int in_section = 0;
+    size_t pos = 0;
+
+    while (pos < size) {
+        /* Classify the next lines in one sweep */
+        const size_t lines_len = ngi_classify_lines(
+            buff + pos, size - pos, lines, LINES_PER_BATCH);
+
+        /* Hash the lines before the NUL bytes are written in them */
+        if (ops->hash != NULL)
+            ngi_hash_lines(buff, size, pos, lines, lines_len, &hash, &hashing,
+                           hashes);
+
+        for (size_t i = 0; i < lines_len; i++) {
+            char* line = buff + pos + lines[i].start;
+            char* tkn = buff + pos + lines[i].token;
+            char* eol = buff + pos + lines[i].end;
+            const ngi_span_t span = {
+                .offset = offset + (line - buff),
+                .length = eol - line,
+            };
+
+            /* The last line ends on the NUL byte after the buffer */
+            *eol = '\0';
+
+            switch (lines[i].type) {
+            case SECTION:
+                /* The lines of the previous section end here */
+                if (ops->hash != NULL && in_section &&
+                    !ops->hash(ctx, hashes[i]))
+                    return 0;
+
+                in_section = 1;
+
+                /* The name ends before the token */
+                *tkn = '\0';
+
+                if (!ops->section(ctx, line, tkn - line, &span))
+                    return 0;
+                break;
+
+            case PROPERTY: {
+                /* The name ends before the token and the value starts after */
+                char* value = tkn + strlen(PROPERTY_TKN);
+                *tkn = '\0';
+
+                if (!ops->property(ctx, line, tkn - line, value, eol - value,
+                                   &span))
+                    return 0;
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+
+        /* Continue after the last classified line */
+        pos += lines[lines_len - 1].end + 1;
+    }
+
+    /* The lines of the last section end with the buffer */
+    if (ops->hash != NULL && in_section &&
+        !ops->hash(ctx, ngi_hash_final(&hash)))
+        return 0;
+
+    return 1;
+}
+
+int ngi_parse_sections(char* buff, size_t size, const ngi_parser_ops_t* ops,
+                       void* ctx) {
+    ngi_line_t lines[LINES_PER_BATCH];
+    char* body = NULL;
+    size_t offset = 0;
+
+    while (offset < size) {
+        const size_t lines_len = ngi_classify_lines(
+            buff + offset, size - offset, lines, LINES_PER_BATCH);
+
+        for (size_t i = 0; i < lines_len; i++) {
+            if (lines[i].type != SECTION)
+                continue;
+
+            char* line = buff + offset + lines[i].start;
+            char* tkn = buff + offset + lines[i].token;
+            char* eol = buff + offset + lines[i].end;
+            const ngi_span_t span = {
+                .offset = line - buff,
+                .length = eol - line,
+            };
+
+            /* The body of the previous section ends before this line */
+            if (body != NULL && !ops->body(ctx, body, line - body))
+                return 0;
+
+            *eol = '\0';
+            *tkn = '\0';
+
+            if (!ops->section(ctx, line, tkn - line, &span))
+                return 0;
+
+            /* The body is empty when the section is on the last line */
+            body = eol < buff + size ? eol + 1 : eol;
+        }
+
+        offset += lines[lines_len - 1].end + 1;
+    }
+
+    /* The body of the last section ends with the buffer */
+    if (body != NULL && !ops->body(ctx, body, buff + size - body))
+        return 0;
 
     return 1;
 }
 
+int ngi_parse_body(ngi_section_t* ngi_section, char* body, size_t size) {
+    const ngi_parser_ops_t ops = {
+        .section = ngi_parse_section,
+        .property = ngi_parse_property,
+    };
+    struct parse_state state = {
+        .ngi_header = ngi_get_section_parent(ngi_section),
+        .current_section = ngi_section,
+        .views = 1,
+    };
+
+    /* The body has no section line, it starts after it in the file */
+    const ngi_span_t* span = ngi_get_section_span(ngi_section);
+    return ngi_parse_memory(body, size, span->offset + span->length + 1, &ops,
+                            &state);
+}
+
 /**
  * @brief Parses a section (**private**)
  *
- * @param[in] ngi_header
- * @param[in] buff
+ * @param[in] ctx
+ * @param[in] name
+ * @param[in] name_len
+ * @param[in] span
  *
- * @return The parsed ngi_section
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
  */
-static ngi_section_t* ngi_parse_section(ngi_header_t* ngi_header, char* buff) {
-    /* Strip the token section name */
-    ngi_strip_section_name(buff);
-    ngi_section_t* ngi_section = ngi_section_alloc(ngi_header, buff);
+static int ngi_parse_section(void* ctx, char* name, int name_len,
+                             const ngi_span_t* span) {
+    struct parse_state* state = ctx;
+
+    ngi_section_t* ngi_section =
+        state->views
+            ? ngi_section_alloc_view(state->ngi_header, name, name_len)
+            : ngi_section_alloc(state->ngi_header, name);
 
     if (ngi_section == NULL)
-        return NULL;
+        return 0;
 
-    /* Parse all the properties of the section */
-    if (!ngi_parse_properties(ngi_header, ngi_section)) {
-        /* Free the section if we have encounter an error */
-        ngi_section_free(ngi_header, ngi_section);
-        return NULL;
-    }
+    ngi_set_section_span(ngi_section, span);
+
+    /* The next properties belong to this section */
+    state->current_section = ngi_section;
 
-    return ngi_section;
+    return 1;
 }
 
 /**
- * @brief Parses all the properties (**private**)
+ * @brief Parses a property (**private**)
  *
- * @param[in] ngi_header
- * @param[in] ngi_section
+ * @param[in] ctx
+ * @param[in] name
+ * @param[in] name_len
+ * @param[in] value
+ * @param[in] value_len
+ * @param[in] span
  *
  * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
  */
-static int ngi_parse_properties(ngi_header_t* ngi_header,
-                                ngi_section_t* ngi_section) {
-    FILE* fd = ngi_get_file(ngi_header);
-    char buff[NGI_MAX_LINE_LENGTH];
-    char* section_name = ngi_get_section_name(ngi_section);
-    const long saved_offset = ftell(fd);
-    long offset = ngi_find_next_property(ngi_header, section_name, 0);
+static int ngi_parse_property(void* ctx, char* name, int name_len, char* value,
+                              int value_len, const ngi_span_t* span) {
+    struct parse_state* state = ctx;
+
+    /* Skip the properties outside of a section */
+    if (state->current_section == NULL)
+        return 1;
+
+    /* Allocate a new property with the name and the value */
+    ngi_property_t* ngi_property =
+        state->views ? ngi_property_alloc_view(state->current_section, name,
+                                               name_len, value, value_len)
+                     : ngi_property_alloc(state->current_section, name, value);
 
-    /* Loop on all sections */
-    while (offset != -1) {
-        fseek(fd, offset, SEEK_SET);
-        fgets(buff, NGI_MAX_LINE_LENGTH, fd);
+    if (ngi_property == NULL)
+        return 0;
 
-        ngi_property_t* ngi_property = ngi_parse_property(ngi_section, buff);
+    ngi_set_property_span(ngi_property, span);
 
-        if (ngi_property == NULL)
-            return 0;
+    return 1;
+}
 
-        /* Get next section offset */
-        offset = ngi_find_next_property(ngi_header, section_name, offset);
-    }
+/**
+ * @brief Keeps the body of a section to parse it later (**private**)
+ *
+ * @param[in] ctx
+ * @param[in] body
+ * @param[in] size
+ *
+ * @return NGI_STATUS_SUCCESS
+ */
+static int ngi_parse_section_body(void* ctx, char* body, size_t size) {
+    struct parse_state* state = ctx;
+
+    ngi_set_section_body(state->current_section, body, size);
 
-    /* Go to the saved offset */
-    fseek(fd, saved_offset, SEEK_SET);
     return 1;
 }
 
 /**
- * @brief Parses a property (**private**)
+ * @brief Keeps the hash of the lines of a section (**private**)
  *
- * @param[in] ngi_section
- * @param[in] buff
+ * @param[in] ctx
+ * @param[in] hash
+ *
+ * @return NGI_STATUS_SUCCESS
+ */
+static int ngi_parse_section_hash(void* ctx, uint64_t hash) {
+    struct parse_state* state = ctx;
+
+    ngi_set_section_hash(state->current_section, hash);
+
+    return 1;
+}
+
+/**
+ * @brief Hashes the lines of the sections in a batch (**private**)
  *
- * @return The parsed ngi_property
+ * The lines between two section lines are hashed at once
+ * and the hash of a section is kept at the index of the next section line,
+ * the lines at the end of the batch continue in the next one
+ *
+ * @param[in] buff
+ * @param[in] size
+ * @param[in] pos The position of the batch in the buffer
+ * @param[in] lines
+ * @param[in] lines_len
+ * @param[in,out] hash
+ * @param[in,out] hashing Set when the lines belong to a section
+ * @param[out] hashes
  */
-static ngi_property_t* ngi_parse_property(ngi_section_t* ngi_section,
-                                          char* buff) {
-    char* name = buff;
-    char value[NGI_MAX_LINE_LENGTH];
+static void ngi_hash_lines(const char* buff, size_t size, size_t pos,
+                           const ngi_line_t* lines, size_t lines_len,
+                           ngi_hash_state_t* hash, int* hashing,
+                           uint64_t* hashes) {
+    const char* end = buff + size;
+    const char* from = buff + pos;
 
-    /* Make a copy of the line to the value buffer */
-    strncpy(value, name, NGI_MAX_LINE_LENGTH);
+    for (size_t i = 0; i < lines_len; i++) {
+        if (lines[i].type != SECTION)
+            continue;
 
-    /* Strip the name and the value */
-    ngi_strip_property_name(name);
-    ngi_strip_property_value(value);
+        const char* line = buff + pos + lines[i].start;
+        const char* eol = buff + pos + lines[i].end;
 
-    /* Allocate a new property and add the name and the value */
-    ngi_property_t* ngi_property =
-        ngi_property_alloc(ngi_section, strlen(name), strlen(value));
+        if (*hashing) {
+            ngi_hash_update(hash, from, line - from);
+            hashes[i] = ngi_hash_final(hash);
+        }
 
-    if (ngi_property == NULL)
-        return NULL;
+        ngi_hash_init(hash);
+        *hashing = 1;
 
-    ngi_set_property_name(ngi_property, name);
-    ngi_set_property_value(ngi_property, value);
+        /* The lines of the section start after his new line */
+        from = eol < end ? eol + 1 : eol;
+    }
 
-    return ngi_property;
+    if (*hashing) {
+        const char* eol = buff + pos + lines[lines_len - 1].end;
+        ngi_hash_update(hash, from, (eol < end ? eol + 1 : eol) - from);
+    }
 }
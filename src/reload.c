@@ -0,0 +1,205 @@
+/**
+ * @file reload.c
+ * @brief The libgni reload implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Publication of the trees of a file to reader threads
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libngi/libngi.h"
+#include "libngi/reload.h"
+#include "libngi/libngi_internal.h"
+
+/**
+ * @brief Contains the published tree of a file
+ *
+ * The ngi_reloader contains:
+ * - the lock serializing the reloads
+ * - the name of the file
+ * - the published ngi_header, holding one reference
+ * - the epoch, whose parity selects the readers counter
+ * - the readers between the load of the tree and his reference
+ *
+ * A reader counts itself in the counter of the current epoch
+ * before loading the tree. A reload replaces the tree, moves to the next
+ * epoch and waits for the counter of the previous one to be empty,
+ * so no reader can still take a reference to the old tree
+ */
+typedef struct ngi_reloader {
+    pthread_mutex_t lock;
+    char* filename;
+    ngi_header_t* ngi_header;
+    unsigned int epoch;
+    int readers[2];
+} ngi_reloader_t;
+
+ngi_reloader_t* ngi_reloader_create(const char* filename);
+void ngi_reloader_free(ngi_reloader_t* ngi_reloader);
+int ngi_reloader_reload(ngi_reloader_t* ngi_reloader);
+ngi_header_t* ngi_reloader_acquire(ngi_reloader_t* ngi_reloader);
+void ngi_reloader_release(ngi_reloader_t* ngi_reloader,
+                          ngi_header_t* ngi_header);
+static ngi_header_t* ngi_reloader_open(const char* filename);
+
+ngi_reloader_t* ngi_reloader_create(const char* filename) {
+    if (filename == NULL)
+        return NULL;
+
+    ngi_reloader_t* ngi_reloader = malloc(sizeof(ngi_reloader_t));
+
+    if (ngi_reloader == NULL)
+        return NULL;
+
+    ngi_reloader->filename = strdup(filename);
+    ngi_reloader->ngi_header = ngi_reloader_open(filename);
+    ngi_reloader->epoch = 0;
+    ngi_reloader->readers[0] = 0;
+    ngi_reloader->readers[1] = 0;
+
+    if (ngi_reloader->filename == NULL || ngi_reloader->ngi_header == NULL) {
+        ngi_close(ngi_reloader->ngi_header);
+        free(ngi_reloader->filename);
+        free(ngi_reloader);
+        return NULL;
+    }
+
+    pthread_mutex_init(&ngi_reloader->lock, NULL);
+
+    return ngi_reloader;
+}
+
+void ngi_reloader_free(ngi_reloader_t* ngi_reloader) {
+    if (ngi_reloader == NULL)
+        return;
+
+    ngi_reloader_release(ngi_reloader, ngi_reloader->ngi_header);
+
+    pthread_mutex_destroy(&ngi_reloader->lock);
+    free(ngi_reloader->filename);
+    free(ngi_reloader);
+}
+
+int ngi_reloader_reload(ngi_reloader_t* ngi_reloader) {
+    pthread_mutex_lock(&ngi_reloader->lock);
+
+    /* Only the reloads modify the published tree */
+    ngi_header_t* old_header = ngi_reloader->ngi_header;
+    ngi_stamp_t stamp;
+
+    if (ngi_stamp_file(&stamp, ngi_reloader->filename) &&
+        ngi_stamp_equals(&stamp, ngi_get_stamp(old_header))) {
+        pthread_mutex_unlock(&ngi_reloader->lock);
+        return 1;
+    }
+
+    /* Build the new tree aside from the readers */
+    ngi_header_t* ngi_header = ngi_reloader_open(ngi_reloader->filename);
+
+    if (ngi_header == NULL) {
+        pthread_mutex_unlock(&ngi_reloader->lock);
+        return 0;
+    }
+
+    __atomic_store_n(&ngi_reloader->ngi_header, ngi_header, __ATOMIC_SEQ_CST);
+
+    /* The next readers count themselves in the other counter */
+    const unsigned int epoch =
+        __atomic_fetch_add(&ngi_reloader->epoch, 1, __ATOMIC_SEQ_CST);
+
+    /* Wait for the readers who may have loaded the old tree
+     * without taking their reference yet
+     */
+    while (__atomic_load_n(&ngi_reloader->readers[epoch & 1],
+                           __ATOMIC_SEQ_CST) != 0)
+        sched_yield();
+
+    pthread_mutex_unlock(&ngi_reloader->lock);
+
+    /* The last reader of the old tree frees it */
+    ngi_reloader_release(ngi_reloader, old_header);
+
+    return 1;
+}
+
+ngi_header_t* ngi_reloader_acquire(ngi_reloader_t* ngi_reloader) {
+    unsigned int epoch;
+
+    /* Count the reader in the counter of the current epoch */
+    for (;;) {
+        epoch = __atomic_load_n(&ngi_reloader->epoch, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&ngi_reloader->readers[epoch & 1], 1,
+                           __ATOMIC_SEQ_CST);
+
+        /* A reload may wait on the other counter already */
+        if (__atomic_load_n(&ngi_reloader->epoch, __ATOMIC_SEQ_CST) == epoch)
+            break;
+
+        __atomic_sub_fetch(&ngi_reloader->readers[epoch & 1], 1,
+                           __ATOMIC_SEQ_CST);
+    }
+
+    ngi_header_t* ngi_header =
+        __atomic_load_n(&ngi_reloader->ngi_header, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(ngi_get_refs(ngi_header), 1, __ATOMIC_SEQ_CST);
+
+    __atomic_sub_fetch(&ngi_reloader->readers[epoch & 1], 1,
+                       __ATOMIC_SEQ_CST);
+
+    return ngi_header;
+}
+
+void ngi_reloader_release(ngi_reloader_t* ngi_reloader,
+                          ngi_header_t* ngi_header) {
+    (void)ngi_reloader;
+
+    if (ngi_header == NULL)
+        return;
+
+    if (__atomic_sub_fetch(ngi_get_refs(ngi_header), 1, __ATOMIC_ACQ_REL) == 0)
+        ngi_close(ngi_header);
+}
+
+/**
+ * @brief Parses the file in a tree holding one reference (**private**)
+ *
+ * @param[in] filename
+ *
+ * @return The ngi_header or NULL if the file can't be parsed
+ */
+static ngi_header_t* ngi_reloader_open(const char* filename) {
+    ngi_header_t* ngi_header = ngi_open_mmap(filename);
+
+    if (ngi_header == NULL)
+        return NULL;
+
+    /* A tree partially parsed is not published */
+    if (!ngi_get_stamp(ngi_header)->valid) {
+        ngi_close(ngi_header);
+        return NULL;
+    }
+
+    *ngi_get_refs(ngi_header) = 1;
+
+    return ngi_header;
+}
@@ -24,8 +24,11 @@
  * Replace functions for a section/property
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "libngi/libngi.h"
 #include "libngi/replace.h"
+#include "libngi/write.h"
 #include "libngi/libngi_internal.h"
 
 void ngi_section_replace(ngi_header_t* ngi_header, ngi_section_t* ngi_section,
@@ -33,37 +36,139 @@ void ngi_section_replace(ngi_header_t* ngi_header, ngi_section_t* ngi_section,
 void ngi_property_replace(ngi_header_t* ngi_header,
                           ngi_property_t* ngi_property, const char* new_name,
                           const char* new_value);
+static void ngi_section_replace_unlocked(ngi_header_t* ngi_header,
+                                         ngi_section_t* ngi_section,
+                                         const char* new_name);
+static void ngi_property_replace_unlocked(ngi_header_t* ngi_header,
+                                          ngi_property_t* ngi_property,
+                                          const char* new_name,
+                                          const char* new_value);
+static int ngi_replace_line(ngi_header_t* ngi_header, ngi_span_t* span,
+                            const char* name, const char* tkn,
+                            const char* value);
 
 void ngi_section_replace(ngi_header_t* ngi_header, ngi_section_t* ngi_section,
                          const char* new_name) {
-    /* Get the file descriptor */
-    FILE* fd = ngi_get_file(ngi_header);
+    ngi_write_lock(ngi_header);
+    ngi_section_replace_unlocked(ngi_header, ngi_section, new_name);
+    ngi_write_unlock(ngi_header);
+}
+
+void ngi_property_replace(ngi_header_t* ngi_header,
+                          ngi_property_t* ngi_property, const char* new_name,
+                          const char* new_value) {
+    ngi_write_lock(ngi_header);
+    ngi_property_replace_unlocked(ngi_header, ngi_property, new_name,
+                                  new_value);
+    ngi_write_unlock(ngi_header);
+}
+
+/**
+ * @brief Renames a ngi_section with the ngi_header locked (**private**)
+ *
+ * @param[in] ngi_header
+ * @param[in] ngi_section
+ * @param[in] new_name
+ */
+static void ngi_section_replace_unlocked(ngi_header_t* ngi_header,
+                                         ngi_section_t* ngi_section,
+                                         const char* new_name) {
+    /* Check if the file is writable */
+    if (ngi_get_file(ngi_header) == NULL)
+        return;
 
     /* Change the name of the section in memory */
     ngi_set_section_name(ngi_section, new_name);
 
-    /*
-     *  Change the name of the section in the file
-     *  by overwriting the whole file
-     */
-    rewind(fd);
-    ngi_dump_tree_to_file(ngi_header, fd);
+    /* The file is written on commit */
+    if (ngi_in_transaction(ngi_header))
+        return;
+
+    /* Rewrite only the line of the section */
+    ngi_span_t span = *ngi_get_section_span(ngi_section);
+    if (ngi_replace_line(ngi_header, &span, ngi_get_section_name(ngi_section),
+                         SECTION_TKN, ""))
+        ngi_set_section_span(ngi_section, &span);
 }
 
-void ngi_property_replace(ngi_header_t* ngi_header,
-                          ngi_property_t* ngi_property, const char* new_name,
-                          const char* new_value) {
-    /* Get the file descriptor */
-    FILE* fd = ngi_get_file(ngi_header);
+/**
+ * @brief Replaces a ngi_property with the ngi_header locked (**private**)
+ *
+ * @param[in] ngi_header
+ * @param[in] ngi_property
+ * @param[in] new_name
+ * @param[in] new_value
+ */
+static void ngi_property_replace_unlocked(ngi_header_t* ngi_header,
+                                          ngi_property_t* ngi_property,
+                                          const char* new_name,
+                                          const char* new_value) {
+    /* Check if the file is writable */
+    if (ngi_get_file(ngi_header) == NULL)
+        return;
 
-    /* Change the name of the property in memory */
+    /* Change the name and the value of the property in memory */
     ngi_set_property_name(ngi_property, new_name);
     ngi_set_property_value(ngi_property, new_value);
 
-    /*
-     *  Change the name of the property in the file
-     *  by overwriting the whole file
-     */
-    rewind(fd);
-    ngi_dump_tree_to_file(ngi_header, fd);
+    /* The file is written on commit */
+    if (ngi_in_transaction(ngi_header))
+        return;
+
+    /* Rewrite only the line of the property */
+    ngi_span_t span = *ngi_get_property_span(ngi_property);
+    if (ngi_replace_line(ngi_header, &span,
+                         ngi_get_property_name(ngi_property), PROPERTY_TKN,
+                         ngi_get_property_value(ngi_property)))
+        ngi_set_property_span(ngi_property, &span);
+}
+
+/**
+ * @brief Rewrites a line of the file and moves the next ones (**private**)
+ *
+ * The new line is made of the name, the token and the value,
+ * the spans of the next lines are moved with it
+ *
+ * @param[in] ngi_header
+ * @param[in,out] span The span of the line, updated to the new line
+ * @param[in] name
+ * @param[in] tkn
+ * @param[in] value
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_replace_line(ngi_header_t* ngi_header, ngi_span_t* span,
+                            const char* name, const char* tkn,
+                            const char* value) {
+    /* The line is not in the file */
+    if (span->offset < 0)
+        return 0;
+
+    const size_t name_len = strlen(name);
+    const size_t tkn_len = strlen(tkn);
+    const size_t value_len = strlen(value);
+    const size_t len = name_len + tkn_len + value_len;
+
+    char* line = malloc(len);
+    if (line == NULL)
+        return 0;
+
+    memcpy(line, name, name_len);
+    memcpy(line + name_len, tkn, tkn_len);
+    memcpy(line + name_len + tkn_len, value, value_len);
+
+    int res = ngi_write_span(ngi_get_file(ngi_header), span, line, len);
+    free(line);
+
+    if (!res)
+        return 0;
+
+    /* The next lines moved with the end of the line */
+    if ((long)len != span->length) {
+        ngi_shift_spans(ngi_header, span->offset + span->length,
+                        (long)len - span->length);
+        span->length = (int)len;
+    }
+
+    return 1;
 }
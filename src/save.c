@@ -0,0 +1,156 @@
+/**
+ * @file save.c
+ * @brief The libgni save implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Atomic save of the tree with a rename
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "libngi/libngi.h"
+#include "libngi/save.h"
+#include "libngi/libngi_internal.h"
+
+/* Suffix of the temporary file, completed by mkstemp */
+#define TEMP_SUFFIX ".XXXXXX"
+
+int ngi_save(ngi_header_t* ngi_header, int sync);
+static int ngi_save_unlocked(ngi_header_t* ngi_header, int sync);
+static int ngi_sync_dir(const char* filename);
+
+int ngi_save(ngi_header_t* ngi_header, int sync) {
+    if (ngi_header == NULL || ngi_get_filename(ngi_header) == NULL)
+        return 0;
+
+    ngi_write_lock(ngi_header);
+    const int res = ngi_save_unlocked(ngi_header, sync);
+    ngi_write_unlock(ngi_header);
+
+    return res;
+}
+
+/**
+ * @brief Saves the tree with the ngi_header locked (**private**)
+ *
+ * @param[in] ngi_header
+ * @param[in] sync
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_save_unlocked(ngi_header_t* ngi_header, int sync) {
+    const char* filename = ngi_get_filename(ngi_header);
+    const size_t filename_len = strlen(filename);
+
+    /* The temporary file is a sibling to be renamed on the same filesystem */
+    char* temp_name = malloc(filename_len + sizeof(TEMP_SUFFIX));
+    if (temp_name == NULL)
+        return 0;
+
+    memcpy(temp_name, filename, filename_len);
+    memcpy(temp_name + filename_len, TEMP_SUFFIX, sizeof(TEMP_SUFFIX));
+
+    int temp_fd = mkstemp(temp_name);
+    if (temp_fd < 0) {
+        free(temp_name);
+        return 0;
+    }
+
+    /* Keep the permissions of the file */
+    struct stat file_stat;
+    if (stat(filename, &file_stat) == 0)
+        fchmod(temp_fd, file_stat.st_mode & 07777);
+
+    FILE* fd = fdopen(temp_fd, "w+");
+    if (fd == NULL) {
+        close(temp_fd);
+        goto fail;
+    }
+
+    if (!ngi_write_tree(fd, ngi_header) || fflush(fd) != 0)
+        goto fail_close;
+    if (sync >= NGI_SYNC_FILE && fsync(temp_fd) != 0)
+        goto fail_close;
+    if (rename(temp_name, filename) != 0)
+        goto fail_close;
+
+    free(temp_name);
+
+    /* The file is replaced even if the rename is not on the disk yet */
+    int res = sync < NGI_SYNC_DIR || ngi_sync_dir(filename);
+
+    /* Keep writing to the file now at the path */
+    if (ngi_get_file(ngi_header) != NULL) {
+        ngi_set_file(ngi_header, fd);
+        ngi_update_spans(ngi_header);
+    } else {
+        fclose(fd);
+    }
+
+    ngi_set_transaction(ngi_header, 0);
+
+    return res;
+
+fail_close:
+    fclose(fd);
+fail:
+    /* After a failed rename the temporary file is still there */
+    unlink(temp_name);
+    free(temp_name);
+
+    return 0;
+}
+
+/**
+ * @brief Flushes the directory entries of the file to the disk (**private**)
+ *
+ * @param[in] filename
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_sync_dir(const char* filename) {
+    const char* slash = strrchr(filename, '/');
+    char* dirname;
+
+    if (slash == NULL)
+        dirname = strdup(".");
+    else if (slash == filename)
+        dirname = strdup("/");
+    else
+        dirname = strndup(filename, slash - filename);
+
+    if (dirname == NULL)
+        return 0;
+
+    int dir_fd = open(dirname, O_RDONLY | O_DIRECTORY);
+    free(dirname);
+
+    if (dir_fd < 0)
+        return 0;
+
+    int res = fsync(dir_fd) == 0;
+    close(dir_fd);
+
+    return res;
+}
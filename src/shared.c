@@ -0,0 +1,355 @@
+/**
+ * @file shared.c
+ * @brief The libgni shared implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Publication of the trees to other processes in shared memory
+ *
+ * The shared memory object of the name holds the control block
+ * with the current generation, each generation is a compiled image
+ * in the object of the name followed by its number.
+ * The images only hold offsets, so they are mapped anywhere
+ * and the subscribers read their strings without a copy
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "libngi/libngi.h"
+#include "libngi/shared.h"
+#include "libngi/libngi_internal.h"
+
+/* Identifies a control block and its layout */
+#define SHARED_MAGIC "NGIS"
+#define SHARED_VERSION 1
+/* Permissions of the shared memory objects without a source file */
+#define SHARED_MODE 0600
+/* Attempts to open a generation removed by the next one */
+#define ATTACH_ATTEMPTS 8
+
+/**
+ * @brief Contains the control block of a publication (**private**)
+ *
+ * The ngi_shared_control contains:
+ * - the magic and the version of the layout
+ * - the current generation, 0 until the first publication
+ */
+struct ngi_shared_control {
+    char magic[4];
+    uint32_t version;
+    uint64_t generation;
+};
+
+/**
+ * @brief Contains the publication followed by a process
+ *
+ * The ngi_subscriber contains:
+ * - the name of the publication
+ * - the mapped control block
+ * - the last attached generation
+ */
+typedef struct ngi_subscriber {
+    char* name;
+    const struct ngi_shared_control* control;
+    uint64_t generation;
+} ngi_subscriber_t;
+
+int ngi_publish(ngi_header_t* ngi_header, const char* name);
+int ngi_unpublish(const char* name);
+ngi_subscriber_t* ngi_subscribe(const char* name);
+int ngi_subscriber_changed(const ngi_subscriber_t* ngi_subscriber);
+ngi_header_t* ngi_subscriber_attach(ngi_subscriber_t* ngi_subscriber);
+void ngi_subscriber_free(ngi_subscriber_t* ngi_subscriber);
+static struct ngi_shared_control* ngi_control_map(const char* name,
+                                                  int writable, mode_t mode);
+static char* ngi_generation_name(const char* name, uint64_t generation);
+static int ngi_generation_write(ngi_header_t* ngi_header,
+                                const char* generation_name, mode_t mode);
+static mode_t ngi_shared_mode(ngi_header_t* ngi_header);
+
+int ngi_publish(ngi_header_t* ngi_header, const char* name) {
+    const mode_t mode = ngi_shared_mode(ngi_header);
+    struct ngi_shared_control* control = ngi_control_map(name, 1, mode);
+    if (control == NULL)
+        return 0;
+
+    /* Only the publisher modifies the generation */
+    const uint64_t generation = control->generation + 1;
+    char* generation_name = ngi_generation_name(name, generation);
+    int res = 0;
+
+    if (generation_name != NULL &&
+        ngi_generation_write(ngi_header, generation_name, mode)) {
+        /* Pairs with the subscribers, the image is complete */
+        __atomic_store_n(&control->generation, generation, __ATOMIC_RELEASE);
+        res = 1;
+    }
+
+    free(generation_name);
+
+    /* The attached processes keep their mapping of the old generation */
+    if (res && generation > 1) {
+        char* old_name = ngi_generation_name(name, generation - 1);
+
+        if (old_name != NULL)
+            shm_unlink(old_name);
+
+        free(old_name);
+    }
+
+    munmap(control, sizeof(*control));
+
+    return res;
+}
+
+int ngi_unpublish(const char* name) {
+    struct ngi_shared_control* control = ngi_control_map(name, 0, 0);
+    if (control == NULL)
+        return 0;
+
+    const uint64_t generation =
+        __atomic_load_n(&control->generation, __ATOMIC_ACQUIRE);
+    munmap(control, sizeof(*control));
+
+    if (generation != 0) {
+        char* generation_name = ngi_generation_name(name, generation);
+
+        if (generation_name != NULL)
+            shm_unlink(generation_name);
+
+        free(generation_name);
+    }
+
+    return shm_unlink(name) == 0;
+}
+
+ngi_subscriber_t* ngi_subscribe(const char* name) {
+    ngi_subscriber_t* ngi_subscriber = malloc(sizeof(ngi_subscriber_t));
+
+    if (ngi_subscriber == NULL)
+        return NULL;
+
+    ngi_subscriber->name = strdup(name);
+    ngi_subscriber->control = ngi_control_map(name, 0, 0);
+    ngi_subscriber->generation = 0;
+
+    if (ngi_subscriber->name == NULL || ngi_subscriber->control == NULL) {
+        ngi_subscriber_free(ngi_subscriber);
+        return NULL;
+    }
+
+    return ngi_subscriber;
+}
+
+int ngi_subscriber_changed(const ngi_subscriber_t* ngi_subscriber) {
+    return __atomic_load_n(&ngi_subscriber->control->generation,
+                           __ATOMIC_ACQUIRE) != ngi_subscriber->generation;
+}
+
+ngi_header_t* ngi_subscriber_attach(ngi_subscriber_t* ngi_subscriber) {
+    for (int i = 0; i < ATTACH_ATTEMPTS; i++) {
+        const uint64_t generation = __atomic_load_n(
+            &ngi_subscriber->control->generation, __ATOMIC_ACQUIRE);
+
+        if (generation == 0)
+            return NULL;
+
+        char* generation_name =
+            ngi_generation_name(ngi_subscriber->name, generation);
+        if (generation_name == NULL)
+            return NULL;
+
+        int fd = shm_open(generation_name, O_RDONLY, 0);
+        free(generation_name);
+
+        /* The generation was replaced before being opened */
+        if (fd == -1 && errno == ENOENT)
+            continue;
+        if (fd == -1)
+            return NULL;
+
+        ngi_header_t* ngi_header = ngi_attach_image(fd);
+        close(fd);
+
+        if (ngi_header != NULL)
+            ngi_subscriber->generation = generation;
+
+        return ngi_header;
+    }
+
+    return NULL;
+}
+
+void ngi_subscriber_free(ngi_subscriber_t* ngi_subscriber) {
+    if (ngi_subscriber == NULL)
+        return;
+
+    if (ngi_subscriber->control != NULL)
+        munmap((void*)ngi_subscriber->control,
+               sizeof(*ngi_subscriber->control));
+
+    free(ngi_subscriber->name);
+    free(ngi_subscriber);
+}
+
+/**
+ * @brief Maps the control block of a publication (**private**)
+ *
+ * @param[in] name
+ * @param[in] writable If the control block is created for the publisher
+ * @param[in] mode The permissions of the control block for the publisher
+ *
+ * @return The control block or NULL if it's missing or invalid
+ */
+static struct ngi_shared_control* ngi_control_map(const char* name,
+                                                  int writable, mode_t mode) {
+    struct ngi_shared_control* control;
+    struct stat control_stat;
+
+    int fd = writable ? shm_open(name, O_RDWR | O_CREAT, mode)
+                      : shm_open(name, O_RDONLY, 0);
+    if (fd == -1)
+        return NULL;
+
+    /* Follow the source file, the umask only applies on creation */
+    if (writable)
+        fchmod(fd, mode);
+
+    if (fstat(fd, &control_stat) == -1 ||
+        (writable && control_stat.st_size == 0 &&
+         ftruncate(fd, sizeof(*control)) == -1) ||
+        (!writable && control_stat.st_size < (off_t)sizeof(*control))) {
+        close(fd);
+        return NULL;
+    }
+
+    control = mmap(NULL, sizeof(*control),
+                   writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                   fd, 0);
+    close(fd);
+
+    if (control == MAP_FAILED)
+        return NULL;
+
+    /* A new control block is zeroed */
+    if (writable && control_stat.st_size == 0) {
+        control->version = SHARED_VERSION;
+        memcpy(control->magic, SHARED_MAGIC, sizeof(control->magic));
+    }
+
+    if (memcmp(control->magic, SHARED_MAGIC, sizeof(control->magic)) ||
+        control->version != SHARED_VERSION) {
+        munmap(control, sizeof(*control));
+        return NULL;
+    }
+
+    return control;
+}
+
+/**
+ * @brief Gets the name of a generation (**private**)
+ *
+ * @param[in] name
+ * @param[in] generation
+ *
+ * @return The allocated name or NULL if the allocation failed
+ */
+static char* ngi_generation_name(const char* name, uint64_t generation) {
+    /* The dot and the 20 digits of the generation */
+    const size_t size = strlen(name) + 22;
+    char* generation_name = malloc(size);
+
+    if (generation_name != NULL)
+        snprintf(generation_name, size, "%s.%" PRIu64, name, generation);
+
+    return generation_name;
+}
+
+/**
+ * @brief Writes the image of the tree in a new generation (**private**)
+ *
+ * @param[in] ngi_header
+ * @param[in] generation_name
+ * @param[in] mode
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_generation_write(ngi_header_t* ngi_header,
+                                const char* generation_name, mode_t mode) {
+    /* Left by a publisher who didn't store the generation */
+    shm_unlink(generation_name);
+
+    int temp_fd = shm_open(generation_name, O_RDWR | O_CREAT | O_EXCL, mode);
+    if (temp_fd == -1)
+        return 0;
+
+    fchmod(temp_fd, mode);
+
+    FILE* fd = fdopen(temp_fd, "w");
+    int res = 1;
+
+    if (fd == NULL) {
+        close(temp_fd);
+        shm_unlink(generation_name);
+        return 0;
+    }
+
+    /* The writers of a concurrent header wait for the image */
+    ngi_read_lock(ngi_header);
+
+    for (int i = 0; res && i < ngi_get_sections_number(ngi_header); i++)
+        res = ngi_section_load(ngi_get_section(ngi_header, i));
+
+    res = res && ngi_image_dump(fd, ngi_header, ngi_get_stamp(ngi_header));
+
+    ngi_read_unlock(ngi_header);
+
+    if (fclose(fd) != 0 || !res) {
+        shm_unlink(generation_name);
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Gets the permissions of the published objects (**private**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return The permissions of the source file, SHARED_MODE without one
+ */
+static mode_t ngi_shared_mode(ngi_header_t* ngi_header) {
+    const char* filename = ngi_get_filename(ngi_header);
+    struct stat file_stat;
+
+    /* The tree is as readable as the file */
+    if (filename != NULL && stat(filename, &file_stat) == 0)
+        return file_stat.st_mode & 0666;
+
+    return SHARED_MODE;
+}
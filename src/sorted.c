@@ -0,0 +1,323 @@
+/**
+ * @file sorted.c
+ * @brief The libgni sorted index implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Sorted index used to find the sections and the properties
+ * by prefix or range of names with a binary search
+ *
+ * The index is only built when it's first searched,
+ * so the parsing doesn't sort the names who are never searched
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "libngi/libngi.h"
+#include "libngi/libngi_internal.h"
+
+/* Initial number of entries of an index */
+#define MIN_SORTED_CAPACITY 8
+
+void ngi_sorted_index_init(ngi_sorted_index_t* index, ngi_arena_t* arena);
+void ngi_sorted_index_free(ngi_sorted_index_t* index);
+int ngi_sorted_index_is_built(const ngi_sorted_index_t* index);
+int ngi_sorted_index_build(ngi_sorted_index_t* index, void* const* nodes,
+                           int len, ngi_sorted_key_t key);
+int ngi_sorted_index_insert(ngi_sorted_index_t* index, const char* key,
+                            void* node);
+void ngi_sorted_index_remove(ngi_sorted_index_t* index, const char* key,
+                             const void* node);
+void ngi_sorted_index_rename(ngi_sorted_index_t* index, const char* old_key,
+                             const char* new_key, void* node);
+void ngi_sorted_index_refresh(ngi_sorted_index_t* index, ngi_sorted_key_t key);
+int ngi_sorted_index_range(const ngi_sorted_index_t* index, const char* from,
+                           const char* to, int* first);
+int ngi_sorted_index_prefix(const ngi_sorted_index_t* index,
+                            const char* prefix, int* first);
+void* ngi_sorted_index_get(const ngi_sorted_index_t* index, int position);
+static int ngi_sorted_index_bound(const ngi_sorted_index_t* index,
+                                  const char* key, int upper);
+static int ngi_sorted_index_find(const ngi_sorted_index_t* index,
+                                 const char* key, const void* node);
+static int ngi_sorted_index_reserve(ngi_sorted_index_t* index, int len);
+static void ngi_sorted_entries_sort(ngi_sorted_entry_t* entries,
+                                    ngi_sorted_entry_t* buffer, int len);
+
+void ngi_sorted_index_init(ngi_sorted_index_t* index, ngi_arena_t* arena) {
+    index->entries = NULL;
+    index->len = 0;
+    index->capacity = 0;
+    index->built = 0;
+    index->arena = arena;
+}
+
+void ngi_sorted_index_free(ngi_sorted_index_t* index) {
+    ngi_arena_release(index->arena, index->entries,
+                      index->capacity * sizeof(ngi_sorted_entry_t));
+    ngi_sorted_index_init(index, index->arena);
+}
+
+int ngi_sorted_index_is_built(const ngi_sorted_index_t* index) {
+    return __atomic_load_n(&index->built, __ATOMIC_ACQUIRE);
+}
+
+int ngi_sorted_index_build(ngi_sorted_index_t* index, void* const* nodes,
+                           int len, ngi_sorted_key_t key) {
+    if (!ngi_sorted_index_reserve(index, len))
+        return 0;
+
+    /* The merge sort keeps the order of the nodes with the same key */
+    ngi_sorted_entry_t* buffer = malloc(len * sizeof(ngi_sorted_entry_t));
+    if (buffer == NULL && len != 0)
+        return 0;
+
+    for (int i = 0; i < len; i++) {
+        index->entries[i].key = key(nodes[i]);
+        index->entries[i].node = nodes[i];
+    }
+
+    ngi_sorted_entries_sort(index->entries, buffer, len);
+    free(buffer);
+    index->len = len;
+
+    /* Publish the entries to the readers who didn't build it */
+    __atomic_store_n(&index->built, 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+int ngi_sorted_index_insert(ngi_sorted_index_t* index, const char* key,
+                            void* node) {
+    if (!index->built)
+        return 1;
+
+    if (index->len == index->capacity &&
+        !ngi_sorted_index_reserve(index, index->capacity < MIN_SORTED_CAPACITY
+                                             ? MIN_SORTED_CAPACITY
+                                             : index->capacity * 2))
+        return 0;
+
+    /* After the nodes with the same key */
+    const int position = ngi_sorted_index_bound(index, key, 1);
+
+    memmove(&index->entries[position + 1], &index->entries[position],
+            (index->len - position) * sizeof(ngi_sorted_entry_t));
+    index->entries[position].key = key;
+    index->entries[position].node = node;
+    index->len++;
+
+    return 1;
+}
+
+void ngi_sorted_index_remove(ngi_sorted_index_t* index, const char* key,
+                             const void* node) {
+    if (!index->built)
+        return;
+
+    const int position = ngi_sorted_index_find(index, key, node);
+    if (position < 0)
+        return;
+
+    index->len--;
+    memmove(&index->entries[position], &index->entries[position + 1],
+            (index->len - position) * sizeof(ngi_sorted_entry_t));
+}
+
+void ngi_sorted_index_rename(ngi_sorted_index_t* index, const char* old_key,
+                             const char* new_key, void* node) {
+    if (!index->built)
+        return;
+
+    const int position = ngi_sorted_index_find(index, old_key, node);
+    if (position < 0)
+        return;
+
+    /* A recache mostly gives the same names in a new buffer */
+    if ((position == 0 ||
+         strcmp(index->entries[position - 1].key, new_key) <= 0) &&
+        (position == index->len - 1 ||
+         strcmp(new_key, index->entries[position + 1].key) <= 0)) {
+        index->entries[position].key = new_key;
+        return;
+    }
+
+    /* Can't fail as the index has one free entry since the removal */
+    ngi_sorted_index_remove(index, old_key, node);
+    ngi_sorted_index_insert(index, new_key, node);
+}
+
+void ngi_sorted_index_refresh(ngi_sorted_index_t* index, ngi_sorted_key_t key) {
+    if (!index->built)
+        return;
+
+    for (int i = 0; i < index->len; i++)
+        index->entries[i].key = key(index->entries[i].node);
+}
+
+int ngi_sorted_index_range(const ngi_sorted_index_t* index, const char* from,
+                           const char* to, int* first) {
+    const int start = from == NULL ? 0 : ngi_sorted_index_bound(index, from, 0);
+    const int end =
+        to == NULL ? index->len : ngi_sorted_index_bound(index, to, 0);
+
+    *first = start;
+
+    return end > start ? end - start : 0;
+}
+
+int ngi_sorted_index_prefix(const ngi_sorted_index_t* index,
+                            const char* prefix, int* first) {
+    const size_t prefix_len = strlen(prefix);
+    const int start = ngi_sorted_index_bound(index, prefix, 0);
+    int low = start;
+    int high = index->len;
+
+    /* The keys starting with the prefix follow it */
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+
+        if (strncmp(index->entries[middle].key, prefix, prefix_len) > 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+
+    *first = start;
+
+    return low - start;
+}
+
+void* ngi_sorted_index_get(const ngi_sorted_index_t* index, int position) {
+    if (position < 0 || position >= index->len)
+        return NULL;
+
+    return index->entries[position].node;
+}
+
+/**
+ * @brief Finds the first entry after a key (**private**)
+ *
+ * @param[in] index
+ * @param[in] key
+ * @param[in] upper If the entries with the same key are skipped
+ *
+ * @return The position of the entry, the number of entries if none
+ */
+static int ngi_sorted_index_bound(const ngi_sorted_index_t* index,
+                                  const char* key, int upper) {
+    int low = 0;
+    int high = index->len;
+
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        const int cmp = strcmp(index->entries[middle].key, key);
+
+        if (cmp < 0 || (upper && cmp == 0))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/**
+ * @brief Finds the entry of a node (**private**)
+ *
+ * @param[in] index
+ * @param[in] key The key of the node
+ * @param[in] node
+ *
+ * @return The position of the entry or -1 if the node is not in the index
+ */
+static int ngi_sorted_index_find(const ngi_sorted_index_t* index,
+                                 const char* key, const void* node) {
+    for (int i = ngi_sorted_index_bound(index, key, 0);
+         i < index->len && !strcmp(index->entries[i].key, key); i++) {
+        if (index->entries[i].node == node)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Makes room for the entries (**private**)
+ *
+ * @param[in] index
+ * @param[in] len The number of entries
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_sorted_index_reserve(ngi_sorted_index_t* index, int len) {
+    if (len <= index->capacity)
+        return 1;
+
+    ngi_sorted_entry_t* entries = ngi_arena_realloc(
+        index->arena, index->entries,
+        index->capacity * sizeof(ngi_sorted_entry_t),
+        len * sizeof(ngi_sorted_entry_t));
+    if (entries == NULL)
+        return 0;
+
+    index->entries = entries;
+    index->capacity = len;
+
+    return 1;
+}
+
+/**
+ * @brief Sorts the entries by key with a bottom-up merge sort (**private**)
+ *
+ * @param[in,out] entries
+ * @param[in] buffer Room for the same number of entries
+ * @param[in] len
+ */
+static void ngi_sorted_entries_sort(ngi_sorted_entry_t* entries,
+                                    ngi_sorted_entry_t* buffer, int len) {
+    ngi_sorted_entry_t* from = entries;
+    ngi_sorted_entry_t* to = buffer;
+
+    for (int width = 1; width < len; width *= 2) {
+        for (int start = 0; start < len; start += 2 * width) {
+            const int middle = start + width < len ? start + width : len;
+            const int end = start + 2 * width < len ? start + 2 * width : len;
+            int left = start;
+            int right = middle;
+
+            /* Take the left entry first to keep the order of equal keys */
+            for (int i = start; i < end; i++) {
+                if (left < middle &&
+                    (right >= end ||
+                     strcmp(from[left].key, from[right].key) <= 0))
+                    to[i] = from[left++];
+                else
+                    to[i] = from[right++];
+            }
+        }
+
+        ngi_sorted_entry_t* swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != entries)
+        memcpy(entries, from, len * sizeof(ngi_sorted_entry_t));
+}
@@ -0,0 +1,295 @@
+/**
+ * @file source.c
+ * @brief The libgni source buffer implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Loading of the raw contents of a file or a buffer to parse it in place
+ */
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "libngi/libngi.h"
+#include "libngi/libngi_internal.h"
+
+void ngi_source_init(ngi_source_t* source);
+int ngi_source_map(ngi_source_t* source, const char* filename);
+int ngi_source_map_sparse(ngi_source_t* source, const char* filename);
+int ngi_source_map_fd(ngi_source_t* source, int fd);
+int ngi_source_copy(ngi_source_t* source, const char* buff, size_t size);
+void ngi_source_free(ngi_source_t* source);
+int ngi_source_changed(const ngi_source_t* source);
+int ngi_source_contains(const ngi_source_t* source, const void* ptr);
+int ngi_stamp_file(ngi_stamp_t* stamp, const char* filename);
+int ngi_stamp_fd(ngi_stamp_t* stamp, int fd);
+int ngi_stamp_equals(const ngi_stamp_t* a, const ngi_stamp_t* b);
+int ngi_stamp_hash_file(ngi_stamp_t* stamp, const char* filename);
+static void ngi_stamp_stat(ngi_stamp_t* stamp, const struct stat* st);
+static int ngi_source_map_file(ngi_source_t* source, const char* filename,
+                               int sequential);
+static int ngi_source_map_pages(ngi_source_t* source, int fd, int sequential);
+
+void ngi_source_init(ngi_source_t* source) {
+    source->data = NULL;
+    source->size = 0;
+    source->mapped_size = 0;
+    source->fd = -1;
+}
+
+int ngi_source_map(ngi_source_t* source, const char* filename) {
+    return ngi_source_map_file(source, filename, 1);
+}
+
+int ngi_source_map_sparse(ngi_source_t* source, const char* filename) {
+    return ngi_source_map_file(source, filename, 0);
+}
+
+int ngi_source_map_fd(ngi_source_t* source, int fd) {
+    if (!ngi_source_map_pages(source, fd, 0))
+        return 0;
+
+    /* The file descriptor belongs to the caller */
+    source->fd = -1;
+
+    return 1;
+}
+
+int ngi_source_copy(ngi_source_t* source, const char* buff, size_t size) {
+    /* Keep the NUL byte after the contents */
+    char* data = malloc(size + 1);
+    if (data == NULL)
+        return 0;
+
+    if (size != 0)
+        memcpy(data, buff, size);
+    data[size] = '\0';
+
+    source->data = data;
+    source->size = size;
+    source->mapped_size = 0;
+    source->fd = -1;
+
+    return 1;
+}
+
+void ngi_source_free(ngi_source_t* source) {
+    if (source->mapped_size != 0)
+        munmap(source->data, source->mapped_size);
+    else
+        free(source->data);
+
+    if (source->fd != -1)
+        close(source->fd);
+
+    ngi_source_init(source);
+}
+
+int ngi_source_changed(const ngi_source_t* source) {
+    struct stat st;
+
+    if (source->fd == -1)
+        return 0;
+
+    /* A file who can't be checked may be truncated */
+    if (fstat(source->fd, &st) == -1)
+        return 1;
+
+    return (size_t)st.st_size != source->size ||
+           st.st_mtim.tv_sec != source->mtime.tv_sec ||
+           st.st_mtim.tv_nsec != source->mtime.tv_nsec;
+}
+
+int ngi_source_contains(const ngi_source_t* source, const void* ptr) {
+    const uintptr_t addr = (uintptr_t)ptr;
+    const uintptr_t start = (uintptr_t)source->data;
+
+    return source->data != NULL && addr >= start &&
+           addr <= start + source->size;
+}
+
+int ngi_stamp_file(ngi_stamp_t* stamp, const char* filename) {
+    struct stat st;
+
+    stamp->valid = 0;
+    stamp->hashed = 0;
+
+    if (stat(filename, &st) == -1)
+        return 0;
+
+    ngi_stamp_stat(stamp, &st);
+
+    return 1;
+}
+
+int ngi_stamp_fd(ngi_stamp_t* stamp, int fd) {
+    struct stat st;
+
+    stamp->valid = 0;
+    stamp->hashed = 0;
+
+    if (fstat(fd, &st) == -1)
+        return 0;
+
+    ngi_stamp_stat(stamp, &st);
+
+    return 1;
+}
+
+int ngi_stamp_equals(const ngi_stamp_t* a, const ngi_stamp_t* b) {
+    return a->valid && b->valid && a->dev == b->dev && a->ino == b->ino &&
+           a->size == b->size && a->mtime.tv_sec == b->mtime.tv_sec &&
+           a->mtime.tv_nsec == b->mtime.tv_nsec &&
+           a->ctime.tv_sec == b->ctime.tv_sec &&
+           a->ctime.tv_nsec == b->ctime.tv_nsec;
+}
+
+int ngi_stamp_hash_file(ngi_stamp_t* stamp, const char* filename) {
+    struct stat st;
+
+    stamp->valid = 0;
+    stamp->hashed = 0;
+
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return 0;
+    }
+
+    /* The pages are only read, so they're shared with the page cache */
+    char* data = NULL;
+    if (st.st_size != 0) {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE,
+                    fd, 0);
+
+        if (data == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+    }
+
+    close(fd);
+
+    ngi_stamp_stat(stamp, &st);
+    stamp->hash = ngi_hash_bytes(data != NULL ? data : "", st.st_size);
+    stamp->hashed = 1;
+
+    if (data != NULL)
+        munmap(data, st.st_size);
+
+    return 1;
+}
+
+/**
+ * @brief Fills a stamp from the status of a file (**private**)
+ *
+ * @param[out] stamp
+ * @param[in] st
+ */
+static void ngi_stamp_stat(ngi_stamp_t* stamp, const struct stat* st) {
+    stamp->dev = st->st_dev;
+    stamp->ino = st->st_ino;
+    stamp->size = st->st_size;
+    stamp->mtime = st->st_mtim;
+    stamp->ctime = st->st_ctim;
+    stamp->valid = 1;
+}
+
+/**
+ * @brief Maps a file in a private writable mapping (**private**)
+ *
+ * @param[out] source
+ * @param[in] filename
+ * @param[in] sequential If the contents are read at once from the start
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_source_map_file(ngi_source_t* source, const char* filename,
+                               int sequential) {
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+
+    if (!ngi_source_map_pages(source, fd, sequential)) {
+        close(fd);
+        return 0;
+    }
+
+    /* Keep the file to check if it's changed under the mapping */
+    source->fd = fd;
+
+    return 1;
+}
+
+/**
+ * @brief Maps an open file in a private writable mapping (**private**)
+ *
+ * @param[out] source
+ * @param[in] fd
+ * @param[in] sequential If the contents are read at once from the start
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_source_map_pages(ngi_source_t* source, int fd, int sequential) {
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+        return 0;
+
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t size = st.st_size;
+
+    /* Reserve one more byte to always have a NUL byte after the contents,
+     * the bytes after the end of the file are zero filled
+     */
+    const size_t mapped_size = (size + 1 + page_size - 1) & ~(page_size - 1);
+    char* data = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (data == MAP_FAILED)
+        return 0;
+
+    /* Map the file over the reserved pages,
+     * the pages are private as the parser writes the NUL bytes in place.
+     * They're not populated, it would copy all the pages up front,
+     * only the pages written by the parser are copied
+     */
+    if (size != 0 && mmap(data, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(data, mapped_size);
+        return 0;
+    }
+
+    if (sequential)
+        madvise(data, mapped_size, MADV_SEQUENTIAL);
+
+    source->data = data;
+    source->size = size;
+    source->mapped_size = mapped_size;
+    source->fd = fd;
+    source->mtime = st.st_mtim;
+
+    return 1;
+}
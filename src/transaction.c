@@ -0,0 +1,116 @@
+/**
+ * @file transaction.c
+ * @brief The libgni transaction implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Transactions grouping the changes in one write
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include "libngi/libngi.h"
+#include "libngi/transaction.h"
+#include "libngi/libngi_internal.h"
+
+int ngi_begin(ngi_header_t* ngi_header);
+int ngi_commit(ngi_header_t* ngi_header);
+int ngi_rollback(ngi_header_t* ngi_header);
+static int ngi_commit_unlocked(ngi_header_t* ngi_header);
+
+int ngi_begin(ngi_header_t* ngi_header) {
+    if (ngi_header == NULL)
+        return 0;
+
+    ngi_write_lock(ngi_header);
+
+    /* Check if the file is writable and if there is no transaction yet */
+    const int res =
+        ngi_get_file(ngi_header) != NULL && !ngi_in_transaction(ngi_header);
+
+    if (res)
+        ngi_set_transaction(ngi_header, 1);
+
+    ngi_write_unlock(ngi_header);
+
+    return res;
+}
+
+int ngi_commit(ngi_header_t* ngi_header) {
+    if (ngi_header == NULL)
+        return 0;
+
+    ngi_write_lock(ngi_header);
+    const int res = ngi_commit_unlocked(ngi_header);
+    ngi_write_unlock(ngi_header);
+
+    return res;
+}
+
+int ngi_rollback(ngi_header_t* ngi_header) {
+    if (ngi_header == NULL)
+        return 0;
+
+    ngi_write_lock(ngi_header);
+    const int transaction = ngi_in_transaction(ngi_header);
+    ngi_set_transaction(ngi_header, 0);
+
+    /* The file didn't change since it was read, only the tree did,
+     * so the recache must not be skipped
+     */
+    if (transaction) {
+        ngi_get_stamp(ngi_header)->valid = 0;
+        ngi_get_stamp(ngi_header)->hashed = 0;
+    }
+    ngi_write_unlock(ngi_header);
+
+    if (!transaction)
+        return 0;
+
+    /* The file still has the tree as it was before the transaction */
+    return ngi_recache_file(ngi_header);
+}
+
+/**
+ * @brief Writes the transaction with the ngi_header locked (**private**)
+ *
+ * @param[in] ngi_header
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_commit_unlocked(ngi_header_t* ngi_header) {
+    if (!ngi_in_transaction(ngi_header))
+        return 0;
+
+    FILE* fd = ngi_get_file(ngi_header);
+
+    /* Write the whole tree and remove what is left of the old file */
+    rewind(fd);
+
+    if (!ngi_write_tree(fd, ngi_header) || fflush(fd) != 0)
+        return 0;
+    if (ftruncate(fileno(fd), ftell(fd)) != 0)
+        return 0;
+
+    /* The lines are now where the dump has put them */
+    ngi_update_spans(ngi_header);
+    ngi_set_transaction(ngi_header, 0);
+
+    return 1;
+}
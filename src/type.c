@@ -21,58 +21,425 @@
  * @section DESCRIPTION
  *
  * Contents:\n
- * Gets the type of the line
- * and strips functions
+ * Gets the type of the line,
+ * tokenizes it and strips functions
  */
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "libngi/libngi.h"
 #include "libngi/libngi_internal.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define NGI_SIMD
+#endif
+
+/* Number of bytes scanned at once by the classifier */
+#define BLOCK_SIZE 64
+
+_Static_assert(sizeof(SECTION_TKN) == 4, "the section token has 3 bytes");
+_Static_assert(sizeof(PROPERTY_TKN) == 3, "the property token has 2 bytes");
+
+/**
+ * @brief Positions of the interesting bytes of a block (**private**)
+ *
+ * The bit i of each mask is set when the byte i of the block is:
+ * - new_line: a new line
+ * - section: the byte n of SECTION_TKN
+ * - property: the byte n of PROPERTY_TKN
+ */
+struct block_masks {
+    uint64_t new_line;
+    uint64_t section[3];
+    uint64_t property[2];
+};
+
+/**
+ * @brief Stores the line being classified (**private**)
+ */
+struct classify_state {
+    ngi_line_t line;
+    uint64_t section_carry[2];
+    uint64_t property_carry;
+};
+
+/**
+ * @brief Vector extensions usable by the classifier (**private**)
+ */
+enum simd_level {
+    SIMD_UNKNOWN,
+    SIMD_NONE,
+    SIMD_SSE2,
+    SIMD_AVX2,
+};
+
+typedef void (*scan_block_t)(const char* block, struct block_masks* masks);
+
 enum ngi_type ngi_get_type(const char* buff);
+size_t ngi_classify_lines(const char* buff, size_t size, ngi_line_t* lines,
+                          size_t max_lines);
+static void ngi_scan_block_scalar(const char* block,
+                                  struct block_masks* masks);
+static size_t ngi_classify_lines_scalar(const char* buff, size_t size,
+                                        ngi_line_t* lines, size_t max_lines);
+#ifdef NGI_SIMD
+static enum simd_level ngi_get_simd_level(void);
+static void ngi_scan_block_sse2(const char* block, struct block_masks* masks);
+static void ngi_scan_block_avx2(const char* block, struct block_masks* masks);
+static size_t ngi_classify_lines_sse2(const char* buff, size_t size,
+                                      ngi_line_t* lines, size_t max_lines);
+static size_t ngi_classify_lines_avx2(const char* buff, size_t size,
+                                      ngi_line_t* lines, size_t max_lines);
+#endif
+enum ngi_type ngi_tokenize_line(const char* line, size_t len,
+                                ngi_tokens_t* tokens);
 void ngi_strip_section_name(char* buff);
 void ngi_strip_property_name(char* buff);
 void ngi_strip_property_value(char* buff);
 
 /* Return the type of the line */
 enum ngi_type ngi_get_type(const char* buff) {
-    if (strstr(buff, SECTION_TKN) > 0) {
-        return SECTION;
-    } else if (strstr(buff, PROPERTY_TKN) > 0) {
-        return PROPERTY;
+    ngi_line_t line;
+
+    if (!ngi_classify_lines(buff, strlen(buff), &line, 1))
+        return UNKNOWN;
+
+    return line.type;
+}
+
+size_t ngi_classify_lines(const char* buff, size_t size, ngi_line_t* lines,
+                          size_t max_lines) {
+#ifdef NGI_SIMD
+    /* Use the widest vectors supported by the CPU */
+    switch (ngi_get_simd_level()) {
+    case SIMD_AVX2:
+        return ngi_classify_lines_avx2(buff, size, lines, max_lines);
+
+    case SIMD_SSE2:
+        return ngi_classify_lines_sse2(buff, size, lines, max_lines);
+
+    default:
+        break;
     }
-    return UNKNOWN;
+#endif
+
+    return ngi_classify_lines_scalar(buff, size, lines, max_lines);
 }
 
-void ngi_strip_section_name(char* buff) {
-    /* Store the pattern to apply */
-    char pattern[MAX_PATTERN_LENGTH] = SSCANF_PATTERN;
+/**
+ * @brief Updates the lines with the masks of a block (**private**)
+ *
+ * The tokens are found on their last byte, the previous bytes
+ * are carried from the previous block
+ *
+ * @param[in,out] state
+ * @param[in] masks
+ * @param[in] offset
+ * @param[out] lines
+ * @param[in,out] lines_len
+ * @param[in] max_lines
+ *
+ * @return 1 if the lines are full, 0 otherwise
+ */
+static inline __attribute__((always_inline)) int
+ngi_classify_block(struct classify_state* state,
+                   const struct block_masks* masks, size_t offset,
+                   ngi_line_t* lines, size_t* lines_len, size_t max_lines) {
+    /* Bytes of the tokens shifted to their last byte */
+    const uint64_t section_end =
+        masks->section[2] &
+        (masks->section[1] << 1 | state->section_carry[1] >> 63) &
+        (masks->section[0] << 2 | state->section_carry[0] >> 62);
+    const uint64_t property_end =
+        masks->property[1] &
+        (masks->property[0] << 1 | state->property_carry >> 63);
+
+    state->section_carry[0] = masks->section[0];
+    state->section_carry[1] = masks->section[1];
+    state->property_carry = masks->property[0];
 
-    /* Extract the string before the token */
-    sscanf(buff, strcat(pattern, SECTION_TKN), buff);
+    uint64_t events = masks->new_line | section_end | property_end;
 
-    /* Remove the trailing space */
-    buff[strlen(buff) - 1] = '\0';
+    while (events != 0) {
+        const int bit = __builtin_ctzll(events);
+        const uint64_t event = 1ULL << bit;
+        const size_t pos = offset + bit;
+        ngi_line_t* line = &state->line;
+
+        events &= events - 1;
+
+        if (masks->new_line & event) {
+            line->end = pos;
+            lines[(*lines_len)++] = *line;
+
+            /* Start the next line */
+            line->start = pos + 1;
+            line->type = UNKNOWN;
+
+            if (*lines_len == max_lines)
+                return 1;
+        } else if (section_end & event) {
+            /* The first section token takes precedence over a property */
+            if (line->type != SECTION) {
+                line->type = SECTION;
+                line->token = pos - (sizeof(SECTION_TKN) - 2);
+            }
+        } else if (line->type == UNKNOWN) {
+            line->type = PROPERTY;
+            line->token = pos - (sizeof(PROPERTY_TKN) - 2);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Classifies the lines of a buffer block by block (**private**)
+ *
+ * The last partial block is scanned from a zero padded copy
+ *
+ * @param[in] buff
+ * @param[in] size
+ * @param[out] lines
+ * @param[in] max_lines
+ * @param[in] scan_block
+ *
+ * @return The number of classified lines
+ */
+static inline __attribute__((always_inline)) size_t
+ngi_classify_lines_with(const char* buff, size_t size, ngi_line_t* lines,
+                        size_t max_lines, scan_block_t scan_block) {
+    struct classify_state state = {
+        .line = {.start = 0, .end = 0, .token = 0, .type = UNKNOWN},
+        .section_carry = {0, 0},
+        .property_carry = 0,
+    };
+    struct block_masks masks;
+    size_t lines_len = 0;
+    size_t offset = 0;
+
+    if (max_lines == 0)
+        return 0;
+
+    for (; offset + BLOCK_SIZE <= size; offset += BLOCK_SIZE) {
+        scan_block(buff + offset, &masks);
+
+        if (ngi_classify_block(&state, &masks, offset, lines, &lines_len,
+                               max_lines))
+            return lines_len;
+    }
+
+    if (offset < size) {
+        char block[BLOCK_SIZE] = {0};
+        memcpy(block, buff + offset, size - offset);
+        scan_block(block, &masks);
+
+        if (ngi_classify_block(&state, &masks, offset, lines, &lines_len,
+                               max_lines))
+            return lines_len;
+    }
+
+    /* The last line has no new line */
+    if (state.line.start < size) {
+        state.line.end = size;
+        lines[lines_len++] = state.line;
+    }
+
+    return lines_len;
+}
+
+/**
+ * @brief Builds the masks of a block one byte at a time (**private**)
+ *
+ * @param[in] block
+ * @param[out] masks
+ */
+static void ngi_scan_block_scalar(const char* block,
+                                  struct block_masks* masks) {
+    memset(masks, 0, sizeof(struct block_masks));
+
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        const uint64_t bit = 1ULL << i;
+        const char c = block[i];
+
+        masks->new_line |= c == '\n' ? bit : 0;
+        masks->section[0] |= c == SECTION_TKN[0] ? bit : 0;
+        masks->section[1] |= c == SECTION_TKN[1] ? bit : 0;
+        masks->section[2] |= c == SECTION_TKN[2] ? bit : 0;
+        masks->property[0] |= c == PROPERTY_TKN[0] ? bit : 0;
+        masks->property[1] |= c == PROPERTY_TKN[1] ? bit : 0;
+    }
+}
+
+static size_t ngi_classify_lines_scalar(const char* buff, size_t size,
+                                        ngi_line_t* lines, size_t max_lines) {
+    return ngi_classify_lines_with(buff, size, lines, max_lines,
+                                   ngi_scan_block_scalar);
+}
+
+#ifdef NGI_SIMD
+/**
+ * @brief Detects once the vector extensions of the CPU (**private**)
+ *
+ * AVX2 also needs the OS to save the YMM registers
+ *
+ * @return The widest usable simd_level
+ */
+static enum simd_level ngi_get_simd_level(void) {
+    static int detected_level = SIMD_UNKNOWN;
+    int level = __atomic_load_n(&detected_level, __ATOMIC_RELAXED);
+
+    if (level != SIMD_UNKNOWN)
+        return level;
+
+    unsigned int eax, ebx, ecx, edx;
+    level = SIMD_NONE;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        if (edx & bit_SSE2)
+            level = SIMD_SSE2;
+
+        if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX) &&
+            __get_cpuid_max(0, NULL) >= 7) {
+            unsigned int xcr0_low, xcr0_high;
+            __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+            /* The XMM and YMM states are enabled */
+            if ((xcr0_low & 0x6) == 0x6 && (ebx & bit_AVX2))
+                level = SIMD_AVX2;
+        }
+    }
+
+    __atomic_store_n(&detected_level, level, __ATOMIC_RELAXED);
+
+    return level;
+}
+
+/* Compare 16 bytes to a character and return a bit per byte */
+#define SSE2_MASK(v, c)                                                        \
+    ((uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))))
+
+/**
+ * @brief Builds the masks of a block 16 bytes at a time (**private**)
+ *
+ * @param[in] block
+ * @param[out] masks
+ */
+__attribute__((target("sse2"))) static void
+ngi_scan_block_sse2(const char* block, struct block_masks* masks) {
+    memset(masks, 0, sizeof(struct block_masks));
+
+    for (int i = 0; i < BLOCK_SIZE; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(block + i));
+
+        masks->new_line |= SSE2_MASK(v, '\n') << i;
+        masks->section[0] |= SSE2_MASK(v, SECTION_TKN[0]) << i;
+        masks->section[1] |= SSE2_MASK(v, SECTION_TKN[1]) << i;
+        masks->section[2] |= SSE2_MASK(v, SECTION_TKN[2]) << i;
+        masks->property[0] |= SSE2_MASK(v, PROPERTY_TKN[0]) << i;
+        masks->property[1] |= SSE2_MASK(v, PROPERTY_TKN[1]) << i;
+    }
+}
+
+/* Compare 32 bytes to a character and return a bit per byte */
+#define AVX2_MASK(v, c)                                                        \
+    ((uint64_t)(uint32_t)_mm256_movemask_epi8(                                 \
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))))
+
+/**
+ * @brief Builds the masks of a block 32 bytes at a time (**private**)
+ *
+ * @param[in] block
+ * @param[out] masks
+ */
+__attribute__((target("avx2"))) static void
+ngi_scan_block_avx2(const char* block, struct block_masks* masks) {
+    const __m256i lo = _mm256_loadu_si256((const __m256i*)block);
+    const __m256i hi = _mm256_loadu_si256((const __m256i*)(block + 32));
+
+    masks->new_line = AVX2_MASK(lo, '\n') | AVX2_MASK(hi, '\n') << 32;
+    masks->section[0] =
+        AVX2_MASK(lo, SECTION_TKN[0]) | AVX2_MASK(hi, SECTION_TKN[0]) << 32;
+    masks->section[1] =
+        AVX2_MASK(lo, SECTION_TKN[1]) | AVX2_MASK(hi, SECTION_TKN[1]) << 32;
+    masks->section[2] =
+        AVX2_MASK(lo, SECTION_TKN[2]) | AVX2_MASK(hi, SECTION_TKN[2]) << 32;
+    masks->property[0] =
+        AVX2_MASK(lo, PROPERTY_TKN[0]) | AVX2_MASK(hi, PROPERTY_TKN[0]) << 32;
+    masks->property[1] =
+        AVX2_MASK(lo, PROPERTY_TKN[1]) | AVX2_MASK(hi, PROPERTY_TKN[1]) << 32;
+}
+
+__attribute__((target("sse2"))) static size_t
+ngi_classify_lines_sse2(const char* buff, size_t size, ngi_line_t* lines,
+                        size_t max_lines) {
+    return ngi_classify_lines_with(buff, size, lines, max_lines,
+                                   ngi_scan_block_sse2);
+}
+
+__attribute__((target("avx2"))) static size_t
+ngi_classify_lines_avx2(const char* buff, size_t size, ngi_line_t* lines,
+                        size_t max_lines) {
+    return ngi_classify_lines_with(buff, size, lines, max_lines,
+                                   ngi_scan_block_avx2);
+}
+#endif /* NGI_SIMD */
+
+enum ngi_type ngi_tokenize_line(const char* line, size_t len,
+                                ngi_tokens_t* tokens) {
+    ngi_line_t classified;
+
+    if (!ngi_classify_lines(line, len, &classified, 1))
+        return UNKNOWN;
+
+    switch (classified.type) {
+    case SECTION:
+        /* The name ends before the token and there is no value */
+        tokens->name_len = classified.token;
+        tokens->value_start = classified.end;
+        tokens->value_len = 0;
+        break;
+
+    case PROPERTY:
+        /* The name ends before the token and the value starts after */
+        tokens->name_len = classified.token;
+        tokens->value_start = classified.token + strlen(PROPERTY_TKN);
+        tokens->value_len = classified.end - tokens->value_start;
+        break;
+
+    default:
+        break;
+    }
+
+    return classified.type;
+}
+
+void ngi_strip_section_name(char* buff) {
+    ngi_tokens_t tokens;
+
+    /* Keep the string before the token */
+    if (ngi_tokenize_line(buff, strlen(buff), &tokens) == SECTION)
+        buff[tokens.name_len] = '\0';
 }
 
 void ngi_strip_property_name(char* buff) {
-    /* Store the pattern to apply */
-    char pattern[MAX_PATTERN_LENGTH] = SSCANF_PATTERN;
+    ngi_tokens_t tokens;
 
-    /* Extract the string before the token */
-    sscanf(buff, strcat(pattern, PROPERTY_TKN), buff);
+    /* Keep the string before the token */
+    if (ngi_tokenize_line(buff, strlen(buff), &tokens) == PROPERTY)
+        buff[tokens.name_len] = '\0';
 }
 
 void ngi_strip_property_value(char* buff) {
-    /* Remove the part starting at the beginning of the line to the end of the
-     * token */
-    char* tkn = strstr(buff, PROPERTY_TKN);
-    tkn += strlen(PROPERTY_TKN);
-
-    strcpy(buff, tkn);
+    ngi_tokens_t tokens;
 
-    /* Remove the new line */
-    char* ptr = buff;
-    strtok_r(buff, "\n", &ptr);
+    /* Move the string after the token up to the new line */
+    if (ngi_tokenize_line(buff, strlen(buff), &tokens) == PROPERTY) {
+        memmove(buff, buff + tokens.value_start, tokens.value_len);
+        buff[tokens.value_len] = '\0';
+    }
 }
@@ -0,0 +1,398 @@
+/**
+ * @file watch.c
+ * @brief The libgni watch implementation
+ *
+ * @section LICENSE
+ *
+ * Copyright © 2022 Guillot Tony <tony.guillot@protonmail.com>
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Contents:\n
+ * Thread recaching the files when they are written
+ */
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "libngi/libngi.h"
+#include "libngi/watch.h"
+#include "libngi/libngi_internal.h"
+
+/* Events of the directory meaning a file was written or replaced */
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+/* Size of the buffer reading the inotify events */
+#define EVENTS_SIZE 4096
+
+/**
+ * @brief Contains a watched ngi_header (**private**)
+ *
+ * The ngi_watch_entry contains:
+ * - the watched ngi_header
+ * - the callback and his data
+ * - the inotify watch of the directory of the file
+ * - the name of the file in the directory
+ * - if the file was written since the last recache
+ */
+struct ngi_watch_entry {
+    ngi_header_t* ngi_header;
+    ngi_watch_callback_t callback;
+    void* data;
+    int wd;
+    char* name;
+    int pending;
+};
+
+/**
+ * @brief Contains the thread watching the files
+ *
+ * The ngi_watcher contains:
+ * - the watching thread
+ * - the recursive lock held while recaching
+ * - the inotify instance
+ * - the pipe waking the thread up to stop it
+ * - a growable array of the watched headers
+ * - the current length of the array
+ * - the allocated capacity of the array
+ */
+typedef struct ngi_watcher {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int inotify_fd;
+    int wake_fds[2];
+    struct ngi_watch_entry* entries;
+    int entries_len;
+    int entries_capacity;
+} ngi_watcher_t;
+
+ngi_watcher_t* ngi_watcher_create(void);
+void ngi_watcher_free(ngi_watcher_t* ngi_watcher);
+int ngi_watch(ngi_watcher_t* ngi_watcher, ngi_header_t* ngi_header,
+              ngi_watch_callback_t callback, void* data);
+int ngi_unwatch(ngi_watcher_t* ngi_watcher, ngi_header_t* ngi_header);
+void ngi_watcher_lock(ngi_watcher_t* ngi_watcher);
+void ngi_watcher_unlock(ngi_watcher_t* ngi_watcher);
+static void* ngi_watcher_run(void* arg);
+static void ngi_watcher_mark(ngi_watcher_t* ngi_watcher,
+                             const struct inotify_event* event);
+static void ngi_watcher_reload(ngi_watcher_t* ngi_watcher);
+static struct ngi_watch_entry* ngi_watcher_find(ngi_watcher_t* ngi_watcher,
+                                                const ngi_header_t* ngi_header);
+
+ngi_watcher_t* ngi_watcher_create(void) {
+    ngi_watcher_t* ngi_watcher = malloc(sizeof(ngi_watcher_t));
+
+    if (ngi_watcher == NULL)
+        return NULL;
+
+    ngi_watcher->entries = NULL;
+    ngi_watcher->entries_len = 0;
+    ngi_watcher->entries_capacity = 0;
+
+    /* The callbacks can take the lock again */
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&ngi_watcher->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    ngi_watcher->inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (ngi_watcher->inotify_fd < 0)
+        goto fail;
+
+    if (pipe(ngi_watcher->wake_fds) != 0)
+        goto fail_inotify;
+
+    if (pthread_create(&ngi_watcher->thread, NULL, ngi_watcher_run,
+                       ngi_watcher) != 0)
+        goto fail_pipe;
+
+    return ngi_watcher;
+
+fail_pipe:
+    close(ngi_watcher->wake_fds[0]);
+    close(ngi_watcher->wake_fds[1]);
+fail_inotify:
+    close(ngi_watcher->inotify_fd);
+fail:
+    pthread_mutex_destroy(&ngi_watcher->lock);
+    free(ngi_watcher);
+
+    return NULL;
+}
+
+void ngi_watcher_free(ngi_watcher_t* ngi_watcher) {
+    if (ngi_watcher == NULL)
+        return;
+
+    /* Wake the thread up and wait for it to stop */
+    while (write(ngi_watcher->wake_fds[1], "", 1) < 0 && errno == EINTR)
+        ;
+    pthread_join(ngi_watcher->thread, NULL);
+
+    for (int i = 0; i < ngi_watcher->entries_len; i++)
+        free(ngi_watcher->entries[i].name);
+    free(ngi_watcher->entries);
+
+    close(ngi_watcher->wake_fds[0]);
+    close(ngi_watcher->wake_fds[1]);
+    close(ngi_watcher->inotify_fd);
+    pthread_mutex_destroy(&ngi_watcher->lock);
+    free(ngi_watcher);
+}
+
+int ngi_watch(ngi_watcher_t* ngi_watcher, ngi_header_t* ngi_header,
+              ngi_watch_callback_t callback, void* data) {
+    if (ngi_watcher == NULL || ngi_header == NULL ||
+        ngi_get_filename(ngi_header) == NULL)
+        return 0;
+
+    ngi_watcher_lock(ngi_watcher);
+
+    /* Only change the callback of a watched ngi_header */
+    struct ngi_watch_entry* entry = ngi_watcher_find(ngi_watcher, ngi_header);
+    if (entry != NULL) {
+        entry->callback = callback;
+        entry->data = data;
+        ngi_watcher_unlock(ngi_watcher);
+        return 1;
+    }
+
+    if (ngi_watcher->entries_len == ngi_watcher->entries_capacity) {
+        const int capacity = ngi_watcher->entries_capacity
+                                 ? ngi_watcher->entries_capacity * 2
+                                 : 4;
+        struct ngi_watch_entry* entries = realloc(
+            ngi_watcher->entries, capacity * sizeof(struct ngi_watch_entry));
+
+        if (entries == NULL)
+            goto fail;
+
+        ngi_watcher->entries = entries;
+        ngi_watcher->entries_capacity = capacity;
+    }
+
+    /* Watch the directory to see the file replaced by a rename */
+    const char* filename = ngi_get_filename(ngi_header);
+    const char* slash = strrchr(filename, '/');
+    char* dirname;
+
+    if (slash == NULL)
+        dirname = strdup(".");
+    else if (slash == filename)
+        dirname = strdup("/");
+    else
+        dirname = strndup(filename, slash - filename);
+
+    if (dirname == NULL)
+        goto fail;
+
+    int wd = inotify_add_watch(ngi_watcher->inotify_fd, dirname, WATCH_MASK);
+    free(dirname);
+
+    char* name = strdup(slash == NULL ? filename : slash + 1);
+
+    if (wd < 0 || name == NULL) {
+        free(name);
+        goto fail;
+    }
+
+    ngi_watcher->entries[ngi_watcher->entries_len++] = (struct ngi_watch_entry){
+        .ngi_header = ngi_header,
+        .callback = callback,
+        .data = data,
+        .wd = wd,
+        .name = name,
+        .pending = 0,
+    };
+
+    ngi_watcher_unlock(ngi_watcher);
+
+    return 1;
+
+fail:
+    ngi_watcher_unlock(ngi_watcher);
+
+    return 0;
+}
+
+int ngi_unwatch(ngi_watcher_t* ngi_watcher, ngi_header_t* ngi_header) {
+    if (ngi_watcher == NULL)
+        return 0;
+
+    ngi_watcher_lock(ngi_watcher);
+
+    struct ngi_watch_entry* entry = ngi_watcher_find(ngi_watcher, ngi_header);
+    if (entry == NULL) {
+        ngi_watcher_unlock(ngi_watcher);
+        return 0;
+    }
+
+    const int wd = entry->wd;
+    free(entry->name);
+
+    /* Move the next entries to fill the hole */
+    const int index = entry - ngi_watcher->entries;
+    ngi_watcher->entries_len--;
+    memmove(entry, entry + 1,
+            (ngi_watcher->entries_len - index) *
+                sizeof(struct ngi_watch_entry));
+
+    /* The directory may still be watched for other files */
+    int used = 0;
+    for (int i = 0; i < ngi_watcher->entries_len; i++)
+        if (ngi_watcher->entries[i].wd == wd)
+            used = 1;
+
+    if (!used)
+        inotify_rm_watch(ngi_watcher->inotify_fd, wd);
+
+    ngi_watcher_unlock(ngi_watcher);
+
+    return 1;
+}
+
+void ngi_watcher_lock(ngi_watcher_t* ngi_watcher) {
+    pthread_mutex_lock(&ngi_watcher->lock);
+}
+
+void ngi_watcher_unlock(ngi_watcher_t* ngi_watcher) {
+    pthread_mutex_unlock(&ngi_watcher->lock);
+}
+
+/**
+ * @brief Waits for the inotify events until the watcher is freed
+ * (**private**)
+ *
+ * @param[in] arg The ngi_watcher
+ *
+ * @return NULL
+ */
+static void* ngi_watcher_run(void* arg) {
+    ngi_watcher_t* ngi_watcher = arg;
+    char events[EVENTS_SIZE]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    struct pollfd fds[2] = {
+        {.fd = ngi_watcher->inotify_fd, .events = POLLIN},
+        {.fd = ngi_watcher->wake_fds[0], .events = POLLIN},
+    };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        /* The watcher is freed */
+        if (fds[1].revents != 0)
+            break;
+
+        ssize_t len = read(ngi_watcher->inotify_fd, events, sizeof(events));
+        if (len <= 0)
+            continue;
+
+        ngi_watcher_lock(ngi_watcher);
+
+        /* Several writes of a file are merged in one recache */
+        for (char* ptr = events; ptr < events + len;) {
+            const struct inotify_event* event = (struct inotify_event*)ptr;
+            ngi_watcher_mark(ngi_watcher, event);
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+
+        ngi_watcher_reload(ngi_watcher);
+        ngi_watcher_unlock(ngi_watcher);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Marks the entries of the file of an event (**private**)
+ *
+ * @param[in] ngi_watcher
+ * @param[in] event
+ */
+static void ngi_watcher_mark(ngi_watcher_t* ngi_watcher,
+                             const struct inotify_event* event) {
+    for (int i = 0; i < ngi_watcher->entries_len; i++) {
+        struct ngi_watch_entry* entry = &ngi_watcher->entries[i];
+
+        /* Some events are lost, so all the files are read again */
+        if (event->mask & IN_Q_OVERFLOW)
+            entry->pending = 1;
+        else if (event->len != 0 && entry->wd == event->wd &&
+                 strcmp(entry->name, event->name) == 0)
+            entry->pending = 1;
+    }
+}
+
+/**
+ * @brief Recaches the marked entries and calls their callbacks (**private**)
+ *
+ * @param[in] ngi_watcher
+ */
+static void ngi_watcher_reload(ngi_watcher_t* ngi_watcher) {
+    /* The callbacks may unwatch, so the entries are searched each time */
+    for (;;) {
+        struct ngi_watch_entry* entry = NULL;
+
+        for (int i = 0; i < ngi_watcher->entries_len && entry == NULL; i++)
+            if (ngi_watcher->entries[i].pending)
+                entry = &ngi_watcher->entries[i];
+
+        if (entry == NULL)
+            break;
+
+        entry->pending = 0;
+
+        if (entry->callback == NULL) {
+            ngi_recache(entry->ngi_header, NULL, NULL);
+            continue;
+        }
+
+        ngi_changes_t* ngi_changes = ngi_changes_alloc();
+        if (ngi_changes == NULL)
+            continue;
+
+        if (ngi_recache(entry->ngi_header, NULL, ngi_changes) &&
+            ngi_get_changes_number(ngi_changes) > 0)
+            entry->callback(entry->ngi_header, ngi_changes, entry->data);
+
+        ngi_changes_free(ngi_changes);
+    }
+}
+
+/**
+ * @brief Finds the entry of a watched ngi_header (**private**)
+ *
+ * @param[in] ngi_watcher
+ * @param[in] ngi_header
+ *
+ * @return The entry or NULL if the ngi_header is not watched
+ */
+static struct ngi_watch_entry* ngi_watcher_find(ngi_watcher_t* ngi_watcher,
+                                                const ngi_header_t* ngi_header) {
+    for (int i = 0; i < ngi_watcher->entries_len; i++)
+        if (ngi_watcher->entries[i].ngi_header == ngi_header)
+            return &ngi_watcher->entries[i];
+
+    return NULL;
+}
@@ -18,16 +18,26 @@
  * @section DESCRIPTION
  *
  * Contents:\n
- * Gets the type of the line
- * and strips functions
+ * Writes the sections and the properties
+ * and edits the lines in place
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "libngi/libngi.h"
 #include "libngi/libngi_internal.h"
 
+/* Size of the chunks moved at once when shifting the end of the file */
+#define SHIFT_CHUNK_SIZE 8192
+
 int ngi_write_section(FILE* fd, const char* name);
 int ngi_write_property(FILE* fd, const char* name, const char* value);
+int ngi_write_span(FILE* fd, const ngi_span_t* span, const char* buff,
+                   size_t len);
+int ngi_write_tree(FILE* fd, ngi_header_t* ngi_header);
+static int ngi_shift_tail(FILE* fd, long tail, long delta);
 
 int ngi_write_section(FILE* fd, const char* name) {
     if (ftell(fd) != 0)
@@ -56,3 +66,86 @@ int ngi_write_property(FILE* fd, const char* name, const char* value) {
 
     return 1;
 }
+
+int ngi_write_span(FILE* fd, const ngi_span_t* span, const char* buff,
+                   size_t len) {
+    const long delta = (long)len - span->length;
+
+    /* Make room for the new bytes or remove the extra bytes */
+    if (delta != 0 && !ngi_shift_tail(fd, span->offset + span->length, delta))
+        return 0;
+
+    if (fseek(fd, span->offset, SEEK_SET) != 0)
+        return 0;
+    if (len != 0 && fwrite(buff, len, 1, fd) != 1)
+        return 0;
+
+    return fflush(fd) == 0;
+}
+
+int ngi_write_tree(FILE* fd, ngi_header_t* ngi_header) {
+    size_t size;
+    char* buff = ngi_dump_to_buffer(ngi_header, NULL, &size);
+
+    if (buff == NULL)
+        return 0;
+
+    /* Keep an empty line with what is before in the file */
+    int res = size == 0 || ftell(fd) <= 0 || fwrite("\n", 1, 1, fd) == 1;
+
+    /* A write larger than the stream buffer goes straight to the file */
+    if (res && size != 0)
+        res = fwrite(buff, size, 1, fd) == 1;
+
+    free(buff);
+
+    return res;
+}
+
+/**
+ * @brief Moves the end of the file starting at tail (**private**)
+ *
+ * The chunks are moved from the end when the file grows
+ * and from the start when it shrinks, to never overwrite unmoved bytes
+ *
+ * @param[in] fd
+ * @param[in] tail
+ * @param[in] delta
+ *
+ * @return NGI_STATUS_FAILED or NGI_STATUS_SUCCESS
+ */
+static int ngi_shift_tail(FILE* fd, long tail, long delta) {
+    char chunk[SHIFT_CHUNK_SIZE];
+    struct stat st;
+
+    if (fflush(fd) != 0 || fstat(fileno(fd), &st) == -1)
+        return 0;
+
+    const long size = st.st_size;
+    long moved = 0;
+
+    while (moved < size - tail) {
+        const long remaining = size - tail - moved;
+        const long len =
+            remaining < SHIFT_CHUNK_SIZE ? remaining : SHIFT_CHUNK_SIZE;
+        const long from = delta > 0 ? size - moved - len : tail + moved;
+
+        if (fseek(fd, from, SEEK_SET) != 0 ||
+            fread(chunk, len, 1, fd) != 1)
+            return 0;
+        if (fseek(fd, from + delta, SEEK_SET) != 0 ||
+            fwrite(chunk, len, 1, fd) != 1)
+            return 0;
+
+        moved += len;
+    }
+
+    if (fflush(fd) != 0)
+        return 0;
+
+    /* Remove the bytes left after the new end */
+    if (delta < 0 && ftruncate(fileno(fd), size + delta) == -1)
+        return 0;
+
+    return 1;
+}
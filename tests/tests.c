@@ -13,15 +13,21 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include "utest.h"
 #include "libngi/libngi.h"
 #include "libngi/libngi_internal.h"
 
-#define TEST_FILENAME "tests/test.ngi"
+#define TEST_FILENAME    "tests/test.ngi"
+#define RECACHE_FILENAME "tests/recache.ngi"
 
 UTEST_MAIN();
 
@@ -37,6 +43,15 @@ UTEST_F_SETUP(ngi_fixture) {
 
 UTEST_F_TEARDOWN(ngi_fixture) { ngi_close(utest_fixture->header); }
 
+/* Replaces the contents of the recached file */
+static void recache_write(const char* contents) {
+    /* A rewrite in place would also change the old mapping */
+    FILE* fd = fopen(RECACHE_FILENAME ".new", "w");
+    fputs(contents, fd);
+    fclose(fd);
+    rename(RECACHE_FILENAME ".new", RECACHE_FILENAME);
+}
+
 /* Strip tests */
 UTEST_F(ngi_fixture, strip_section_name) {
     char buffer[NGI_MAX_LINE_LENGTH];
@@ -62,6 +77,361 @@ UTEST_F(ngi_fixture, strip_property_value) {
     ASSERT_STREQ(buffer, "This is a new sample text");
 }
 
+UTEST(strip, any_character) {
+    char buffer[NGI_MAX_LINE_LENGTH];
+
+    strcpy(buffer, "net.ipv4 [eth-0] ->\n");
+    ngi_strip_section_name(buffer);
+    ASSERT_STREQ(buffer, "net.ipv4 [eth-0]");
+
+    strcpy(buffer, "path/to-file.txt: C:\\dir: ok\n");
+    ngi_strip_property_name(buffer);
+    ASSERT_STREQ(buffer, "path/to-file.txt");
+
+    strcpy(buffer, "path/to-file.txt: C:\\dir: ok\n");
+    ngi_strip_property_value(buffer);
+    ASSERT_STREQ(buffer, "C:\\dir: ok");
+}
+
+/* Type tests */
+UTEST(type, get_type) {
+    ASSERT_EQ(ngi_get_type("test section ->\n"), SECTION);
+    ASSERT_EQ(ngi_get_type("test: value"), PROPERTY);
+    ASSERT_EQ(ngi_get_type("a: b ->"), SECTION);
+    ASSERT_EQ(ngi_get_type("test ->test: value"), SECTION);
+    ASSERT_EQ(ngi_get_type("test:value -"), UNKNOWN);
+    ASSERT_EQ(ngi_get_type(""), UNKNOWN);
+}
+
+UTEST(type, classify_lines) {
+    char buff[256];
+    ngi_line_t lines[8];
+
+    /* Put the tokens across the 64 bytes blocks */
+    memset(buff, 'x', sizeof(buff));
+    memcpy(buff + 62, " ->\n", 4);
+    memcpy(buff + 127, ": \n", 3);
+    memcpy(buff + 190, "\n", 1);
+    memcpy(buff + 250, ": v", 3);
+
+    ASSERT_EQ(ngi_classify_lines(buff, 253, lines, 8), 4);
+    ASSERT_EQ(lines[0].type, SECTION);
+    ASSERT_EQ(lines[0].token, 62);
+    ASSERT_EQ(lines[0].end, 65);
+    ASSERT_EQ(lines[1].type, PROPERTY);
+    ASSERT_EQ(lines[1].start, 66);
+    ASSERT_EQ(lines[1].token, 127);
+    ASSERT_EQ(lines[2].type, UNKNOWN);
+    ASSERT_EQ(lines[3].type, PROPERTY);
+    ASSERT_EQ(lines[3].token, 250);
+    ASSERT_EQ(lines[3].end, 253);
+
+    /* Stop after the requested number of lines */
+    ASSERT_EQ(ngi_classify_lines(buff, 253, lines, 2), 2);
+    ASSERT_EQ(lines[1].end, 129);
+}
+
+/* Parser tests */
+UTEST_F(ngi_fixture, parse_file) {
+    ngi_header_t* header = utest_fixture->header;
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+
+    ngi_section_t* section = ngi_get_section_by_name(header, "ngi format test");
+    ASSERT_TRUE(section != NULL);
+    ASSERT_EQ(ngi_get_properties_number(section), 2);
+
+    ngi_property_t* property = ngi_get_property_by_name(section, "string");
+    ASSERT_TRUE(property != NULL);
+    ASSERT_STREQ(ngi_get_property_value(property), "\"hello\"");
+}
+
+UTEST(parse, unbounded_arrays) {
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "w+");
+    char name[32];
+
+    /* Go above the old fixed size of the arrays */
+    for (int i = 0; i < 10000; i++) {
+        sprintf(name, "section %d", i);
+        ASSERT_TRUE(ngi_section_alloc(header, name) != NULL);
+    }
+    ASSERT_EQ(ngi_get_sections_number(header), 10000);
+
+    ngi_section_t* section = ngi_get_section(header, 9999);
+    ASSERT_STREQ(ngi_get_section_name(section), "section 9999");
+    ASSERT_TRUE(ngi_get_section(header, 10000) == NULL);
+
+    for (int i = 0; i < 10000; i++)
+        ASSERT_TRUE(ngi_property_alloc(section, "name", "value") != NULL);
+    ASSERT_EQ(ngi_get_properties_number(section), 10000);
+
+    /* Remove a section in the middle of the array */
+    ngi_section_free(header, ngi_get_section(header, 5000));
+    ASSERT_EQ(ngi_get_sections_number(header), 9999);
+    ASSERT_STREQ(ngi_get_section_name(ngi_get_section(header, 5000)),
+                 "section 5001");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(parse, hash_index) {
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "w+");
+    char name[32];
+
+    ngi_section_t* section = ngi_section_alloc(header, "section");
+    for (int i = 0; i < 1000; i++) {
+        sprintf(name, "property %d", i);
+        ASSERT_TRUE(ngi_property_alloc(section, name, "value") != NULL);
+    }
+
+    ngi_property_t* property = ngi_get_property_by_name(section, "property 42");
+    ASSERT_TRUE(property == ngi_get_property(section, 42));
+    ASSERT_TRUE(ngi_get_property_by_name(section, "property 1000") == NULL);
+
+    /* The index follows the setters */
+    ngi_set_property_name(property, "a much longer property name");
+    ASSERT_TRUE(ngi_get_property_by_name(section, "property 42") == NULL);
+    ASSERT_TRUE(ngi_get_property_by_name(
+                    section, "a much longer property name") == property);
+
+    ngi_set_section_name(section, "renamed section");
+    ASSERT_TRUE(ngi_get_section_by_name(header, "section") == NULL);
+    ASSERT_TRUE(ngi_get_section_by_name(header, "renamed section") == section);
+
+    /* And the removals */
+    ngi_property_free(section, property);
+    ASSERT_TRUE(ngi_get_property_by_name(
+                    section, "a much longer property name") == NULL);
+    ASSERT_TRUE(ngi_get_property_by_name(section, "property 999") ==
+                ngi_get_property(section, 998));
+
+    ngi_section_free(header, section);
+    ASSERT_TRUE(ngi_get_section_by_name(header, "renamed section") == NULL);
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(parse, sorted_index) {
+    const char buff[] = "backend_b ->\nhost: a\nbackend_port: 1\n\n"
+                        "frontend ->\n\nbackend_a ->\n\nbackend ->\n";
+    ngi_header_t* header = ngi_parse_buffer(buff, sizeof(buff) - 1);
+    int first;
+
+    ASSERT_EQ(ngi_get_sections_by_prefix(header, "backend_", &first), 2);
+    ASSERT_STREQ(ngi_get_section_name(ngi_get_sorted_section(header, first)),
+                 "backend_a");
+    ASSERT_STREQ(
+        ngi_get_section_name(ngi_get_sorted_section(header, first + 1)),
+        "backend_b");
+    ASSERT_EQ(ngi_get_sections_by_range(header, "b", "c", &first), 3);
+    ASSERT_EQ(first, 0);
+    ASSERT_EQ(ngi_get_sections_by_range(header, "backend_b", NULL, &first), 2);
+    ASSERT_EQ(ngi_get_sections_by_prefix(header, "z", &first), 0);
+
+    ngi_section_t* section = ngi_get_section_by_name(header, "backend_b");
+    ASSERT_EQ(ngi_get_properties_by_prefix(section, "backend_", &first), 1);
+    ASSERT_STREQ(
+        ngi_get_property_name(ngi_get_sorted_property(section, first)),
+        "backend_port");
+
+    /* The index follows the allocations, the setters and the removals */
+    ngi_property_alloc(section, "backend_addr", "b");
+    ASSERT_EQ(ngi_get_properties_by_prefix(section, "backend_", &first), 2);
+    ASSERT_STREQ(
+        ngi_get_property_name(ngi_get_sorted_property(section, first)),
+        "backend_addr");
+
+    ngi_section_alloc(header, "backend_c");
+    ngi_set_section_name(ngi_get_section_by_name(header, "frontend"),
+                         "backend_0");
+    ngi_section_free(header, ngi_get_section_by_name(header, "backend_a"));
+    ASSERT_EQ(ngi_get_sections_by_prefix(header, "backend_", &first), 3);
+    ASSERT_STREQ(ngi_get_section_name(ngi_get_sorted_section(header, first)),
+                 "backend_0");
+    ASSERT_STREQ(
+        ngi_get_section_name(ngi_get_sorted_section(header, first + 2)),
+        "backend_c");
+    ASSERT_TRUE(ngi_get_sorted_section(header, 4) == NULL);
+
+    ngi_close(header);
+}
+
+/* Mapped file tests */
+UTEST(mmap, open) {
+    ngi_header_t* header = ngi_open_mmap(TEST_FILENAME);
+    ASSERT_TRUE(header != NULL);
+    ASSERT_TRUE(ngi_get_file(header) == NULL);
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+
+    ngi_section_t* section = ngi_get_section_by_name(header, "test section");
+    ASSERT_TRUE(section != NULL);
+
+    ngi_property_t* property = ngi_get_property_by_name(section, "value");
+    ASSERT_STREQ(ngi_get_property_value(property), "this is a test");
+    ASSERT_EQ(ngi_get_property_value_size(property), 15);
+
+    /* The header is read-only */
+    ASSERT_TRUE(ngi_create_section(header, "new section") == NULL);
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+
+    ngi_close(header);
+
+    ASSERT_TRUE(ngi_open_mmap("tests/does-not-exist.ngi") == NULL);
+}
+
+UTEST(mmap, recache) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1\n\nsecond ->\nb: 2\n", fd);
+    fclose(fd);
+
+    ngi_header_t* header = ngi_open_mmap(RECACHE_FILENAME);
+    ngi_section_t* section = ngi_get_section_by_name(header, "second");
+    ngi_property_t* property = ngi_get_property(section, 0);
+
+    /* Fill exactly a page without the last new line,
+     * the mapped file is replaced and not truncated
+     */
+    const char* prefix = "first ->\na: 1\n\nsecond ->\nb: ";
+    const int value_len = 4096 - strlen(prefix);
+    fd = fopen(RECACHE_FILENAME ".new", "w");
+    fputs(prefix, fd);
+    for (int i = 0; i < value_len; i++)
+        fputc('x', fd);
+    fclose(fd);
+    rename(RECACHE_FILENAME ".new", RECACHE_FILENAME);
+
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_TRUE(ngi_get_property(section, 0) == property);
+    ASSERT_EQ(ngi_get_property_value_size(property), value_len + 1);
+    ASSERT_EQ(ngi_get_property_value(property)[value_len], '\0');
+    ASSERT_TRUE(ngi_get_property_by_name(section, "b") == property);
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+/* Lazy tests */
+UTEST(lazy, open) {
+    ngi_header_t* header = ngi_open_lazy(TEST_FILENAME);
+    ASSERT_TRUE(header != NULL);
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+
+    /* The properties are parsed on first access */
+    ngi_section_t* section = ngi_get_section_by_name(header, "test section");
+    ASSERT_FALSE(ngi_section_is_loaded(section));
+
+    ngi_property_t* property = ngi_get_property_by_name(section, "value");
+    ASSERT_TRUE(ngi_section_is_loaded(section));
+    ASSERT_STREQ(ngi_get_property_value(property), "this is a test");
+    ASSERT_FALSE(ngi_section_is_loaded(ngi_get_section(header, 1)));
+
+    ngi_close(header);
+}
+
+UTEST(lazy, recache) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1\n\nsecond ->\nb: 2\nc: 3\n", fd);
+    fclose(fd);
+
+    ngi_header_t* header = ngi_open_lazy(RECACHE_FILENAME);
+    ngi_section_t* first = ngi_get_section(header, 0);
+    ngi_section_t* second = ngi_get_section(header, 1);
+    ngi_property_t* property = ngi_get_property(first, 0);
+
+    fd = fopen(RECACHE_FILENAME ".new", "w");
+    fputs("first ->\na: 10\n\nsecond ->\nb: 20\n\nthird ->\nd: 4", fd);
+    fclose(fd);
+    rename(RECACHE_FILENAME ".new", RECACHE_FILENAME);
+
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_EQ(ngi_get_sections_number(header), 3);
+
+    /* The loaded section is updated in place */
+    ASSERT_TRUE(ngi_get_property(first, 0) == property);
+    ASSERT_STREQ(ngi_get_property_value(property), "10");
+
+    /* The others are parsed from the new contents */
+    ASSERT_FALSE(ngi_section_is_loaded(second));
+    ASSERT_EQ(ngi_get_properties_number(second), 1);
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(second, 0)), "20");
+
+    ngi_section_t* third = ngi_get_section_by_name(header, "third");
+    ASSERT_FALSE(ngi_section_is_loaded(third));
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(third, 0)), "4");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(lazy, written_in_place) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1234567890\n\nsecond ->\n", fd);
+    for (int i = 0; i < 1000; i++)
+        fprintf(fd, "k%04d: v%04d\n", i, i);
+    fclose(fd);
+
+    /* The file gets shorter and is truncated under the mapping */
+    ngi_header_t* header = ngi_open_lazy(RECACHE_FILENAME);
+    ngi_header_t* writer = ngi_open(RECACHE_FILENAME, "r+");
+    ngi_property_t* property = ngi_get_property(ngi_get_section(writer, 0), 0);
+    ngi_property_replace(writer, property, "a", "1");
+
+    ngi_section_t* second = ngi_get_section_by_name(header, "second");
+    ASSERT_EQ(ngi_get_properties_number(second), 0);
+    ASSERT_FALSE(ngi_section_is_loaded(second));
+
+    ASSERT_TRUE(ngi_recache_file(header));
+    second = ngi_get_section_by_name(header, "second");
+    ASSERT_EQ(ngi_get_properties_number(second), 1000);
+    ASSERT_STREQ(
+        ngi_get_property_value(ngi_get_property_by_name(second, "k0999")),
+        "v0999");
+    ngi_close(header);
+
+    /* The file gets longer, the old offsets point before the values */
+    header = ngi_open_lazy(RECACHE_FILENAME);
+    ngi_property_replace(writer, property, "a", "1234567890");
+
+    second = ngi_get_section_by_name(header, "second");
+    ASSERT_TRUE(ngi_get_property_by_name(second, "k0999") == NULL);
+
+    ASSERT_TRUE(ngi_recache_file(header));
+    second = ngi_get_section_by_name(header, "second");
+    ASSERT_STREQ(
+        ngi_get_property_value(ngi_get_property_by_name(second, "k0999")),
+        "v0999");
+
+    ngi_close(header);
+    ngi_close(writer);
+    remove(RECACHE_FILENAME);
+}
+
+/* Buffer tests */
+UTEST(buffer, parse) {
+    char buff[] = "first ->\na: 1\n\nsecond ->\nb: 2";
+    ngi_header_t* header = ngi_parse_buffer(buff, strlen(buff));
+    ASSERT_TRUE(header != NULL);
+    ASSERT_TRUE(ngi_get_file(header) == NULL);
+
+    /* The buffer is not referenced by the tree */
+    memset(buff, 0, sizeof(buff));
+
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+    ngi_section_t* section = ngi_get_section_by_name(header, "second");
+    ASSERT_TRUE(section != NULL);
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(section, 0)), "2");
+
+    /* There is no file to recache */
+    ASSERT_FALSE(ngi_recache_file(header));
+    ngi_close(header);
+
+    header = ngi_parse_buffer(NULL, 0);
+    ASSERT_TRUE(header != NULL);
+    ASSERT_EQ(ngi_get_sections_number(header), 0);
+    ngi_close(header);
+}
+
 /* Find tests */
 UTEST_F(ngi_fixture, find_section) {
     long res = ngi_find_section(utest_fixture->header, "test section");
@@ -82,12 +452,283 @@ UTEST_F(ngi_fixture, find_property) {
 */
 
 /* Recache test */
-/* TODO: Try to improve this test */
 UTEST_F(ngi_fixture, recache) {
     long res = ngi_recache_file(utest_fixture->header);
     ASSERT_TRUE(res);
 }
 
+UTEST(recache, manual_changes) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1\nb: 2\n\nsecond ->\nc: 3\n", fd);
+    fclose(fd);
+
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r");
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+
+    /* Rename a section, change a value, add and remove properties */
+    fd = fopen(RECACHE_FILENAME, "w");
+    fputs("renamed ->\na: 10\n\nsecond ->\nc: 3\nd: 4\n", fd);
+    fclose(fd);
+
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+
+    ngi_section_t* section = ngi_get_section(header, 0);
+    ASSERT_STREQ(ngi_get_section_name(section), "renamed");
+    ASSERT_EQ(ngi_get_properties_number(section), 1);
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(section, 0)), "10");
+
+    section = ngi_get_section(header, 1);
+    ASSERT_EQ(ngi_get_properties_number(section), 2);
+    ASSERT_STREQ(ngi_get_property_name(ngi_get_property(section, 1)), "d");
+
+    /* Remove a whole section */
+    fd = fopen(RECACHE_FILENAME, "w");
+    fputs("renamed ->\na: 10\n", fd);
+    fclose(fd);
+
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_EQ(ngi_get_sections_number(header), 1);
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(recache, unchanged) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1\n", fd);
+    fclose(fd);
+
+    /* The values point in the mapping replaced by each parse */
+    ngi_header_t* header = ngi_open_mmap(RECACHE_FILENAME);
+    ngi_property_t* property = ngi_get_property(ngi_get_section(header, 0), 0);
+    const char* value = ngi_get_property_value(property);
+
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_TRUE(ngi_get_property_value(property) == value);
+
+    ngi_set_recache_check(header, NGI_RECACHE_ALWAYS);
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_FALSE(ngi_get_property_value(property) == value);
+
+    /* The first hash check parses the file to hash it */
+    ngi_set_recache_check(header, NGI_RECACHE_HASH);
+    ASSERT_TRUE(ngi_recache_file(header));
+    value = ngi_get_property_value(property);
+
+    /* A touched file with the same contents is not parsed */
+    utimensat(AT_FDCWD, RECACHE_FILENAME, NULL, 0);
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_TRUE(ngi_get_property_value(property) == value);
+
+    fd = fopen(RECACHE_FILENAME ".new", "w");
+    fputs("first ->\na: 2\n", fd);
+    fclose(fd);
+    rename(RECACHE_FILENAME ".new", RECACHE_FILENAME);
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_STREQ(ngi_get_property_value(property), "2");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+/* Changes tests */
+UTEST(changes, recache) {
+    recache_write("first ->\na: 1\nb: 2\nc: 3\n\nsecond ->\nd: 4\n\n"
+                  "third ->\ne: 5\n");
+
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r");
+    ngi_set_recache_check(header, NGI_RECACHE_ALWAYS);
+    ngi_changes_t* changes;
+
+    /* Modify, rename and remove properties, rename and add sections */
+    recache_write("first ->\na: 10\nrenamed: 2\n\nmoved ->\nd: 4\n\n"
+                  "third ->\ne: 5\n\nfourth ->\nf: 6\n");
+    ASSERT_TRUE(ngi_recache_changes(header, &changes));
+    ASSERT_EQ(ngi_get_changes_number(changes), 5);
+
+    const ngi_change_t* change = ngi_get_change(changes, 0);
+    ASSERT_EQ(change->type, NGI_CHANGE_MODIFIED);
+    ASSERT_STREQ(change->section, "first");
+    ASSERT_STREQ(change->property, "a");
+
+    change = ngi_get_change(changes, 1);
+    ASSERT_EQ(change->type, NGI_CHANGE_RENAMED);
+    ASSERT_STREQ(change->property, "renamed");
+    ASSERT_STREQ(change->old_name, "b");
+
+    change = ngi_get_change(changes, 2);
+    ASSERT_EQ(change->type, NGI_CHANGE_REMOVED);
+    ASSERT_STREQ(change->property, "c");
+
+    change = ngi_get_change(changes, 3);
+    ASSERT_EQ(change->type, NGI_CHANGE_RENAMED);
+    ASSERT_STREQ(change->section, "moved");
+    ASSERT_STREQ(change->old_name, "second");
+    ASSERT_TRUE(change->property == NULL);
+
+    change = ngi_get_change(changes, 4);
+    ASSERT_EQ(change->type, NGI_CHANGE_ADDED);
+    ASSERT_STREQ(change->section, "fourth");
+    ASSERT_TRUE(ngi_get_change(changes, 5) == NULL);
+    ngi_changes_free(changes);
+
+    /* The same file has no changes */
+    ASSERT_TRUE(ngi_recache_changes(header, &changes));
+    ASSERT_EQ(ngi_get_changes_number(changes), 0);
+    ngi_changes_free(changes);
+
+    recache_write("first ->\na: 10\nrenamed: 2\n");
+    ASSERT_TRUE(ngi_recache_changes(header, &changes));
+    ASSERT_EQ(ngi_get_changes_number(changes), 3);
+    ASSERT_EQ(ngi_get_change(changes, 0)->type, NGI_CHANGE_REMOVED);
+    ASSERT_STREQ(ngi_get_change(changes, 2)->section, "fourth");
+    ngi_changes_free(changes);
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(changes, lazy) {
+    recache_write("first ->\na: 1\n\nsecond ->\nb: 2\n");
+
+    /* The sections not loaded are compared as a whole */
+    ngi_header_t* header = ngi_open_lazy(RECACHE_FILENAME);
+    ngi_set_recache_check(header, NGI_RECACHE_ALWAYS);
+    ngi_changes_t* changes;
+
+    recache_write("first ->\na: 1\n\nsecond ->\nb: 3\n");
+    ASSERT_TRUE(ngi_recache_changes(header, &changes));
+    ASSERT_EQ(ngi_get_changes_number(changes), 1);
+    ASSERT_EQ(ngi_get_change(changes, 0)->type, NGI_CHANGE_MODIFIED);
+    ASSERT_STREQ(ngi_get_change(changes, 0)->section, "second");
+    ASSERT_TRUE(ngi_get_change(changes, 0)->property == NULL);
+    ngi_changes_free(changes);
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(recache, sections) {
+    recache_write("first ->\na: 1\nb: 2\n\nsecond ->\nc: 3\n");
+
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r+");
+    ngi_set_recache_check(header, NGI_RECACHE_ALWAYS);
+    ngi_property_t* property = ngi_get_property(ngi_get_section(header, 1), 0);
+
+    /* The unchanged section is only moved */
+    recache_write("first ->\na: 100\nb: 2\n\nsecond ->\nc: 3\n");
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_EQ(ngi_get_property_span(property)->offset, 32);
+
+    ngi_property_replace(header, property, "c", "30");
+    char buffer[64] = {0};
+    FILE* fd = ngi_get_file(header);
+    rewind(fd);
+    fread(buffer, 1, sizeof(buffer) - 1, fd);
+    ASSERT_STREQ(buffer, "first ->\na: 100\nb: 2\n\nsecond ->\nc: 30\n");
+
+    /* A change made in memory is parsed again */
+    recache_write("first ->\na: 100\nb: 2\n\nsecond ->\nc: 3\n");
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_STREQ(ngi_get_property_value(property), "3");
+    ngi_close(header);
+
+    /* The loaded sections of a lazy header point in the new mapping */
+    header = ngi_open_lazy(RECACHE_FILENAME);
+    ngi_set_recache_check(header, NGI_RECACHE_ALWAYS);
+    property = ngi_get_property(ngi_get_section(header, 1), 0);
+    ASSERT_EQ(ngi_get_property_span(property)->offset, 32);
+
+    recache_write("first ->\na: 1\nb: 2\n\nsecond ->\nc: 3\n");
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_STREQ(ngi_get_property_name(property), "c");
+    ASSERT_STREQ(ngi_get_property_value(property), "3");
+    ASSERT_EQ(ngi_get_property_span(property)->offset, 30);
+    ASSERT_STREQ(ngi_get_property_value(
+                     ngi_get_property(ngi_get_section(header, 0), 0)),
+                 "1");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(recache, sorted_index) {
+    recache_write("b ->\nx: 1\n\na ->\nkey_2: 2\nkey_1: 1\n\nc ->\n");
+
+    ngi_header_t* header = ngi_open_lazy(RECACHE_FILENAME);
+    ngi_set_recache_check(header, NGI_RECACHE_ALWAYS);
+    ngi_section_t* section = ngi_get_section_by_name(header, "a");
+    int first;
+
+    ASSERT_EQ(ngi_get_sections_by_range(header, NULL, NULL, &first), 3);
+    ASSERT_EQ(ngi_get_properties_by_prefix(section, "key_", &first), 2);
+
+    /* The names point in the new mapping, the sections are renamed */
+    recache_write("b ->\nx: 1\n\na ->\nkey_2: 2\nkey_1: 1\n\nd ->\n");
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_EQ(ngi_get_sections_by_range(header, "c", NULL, &first), 1);
+    ASSERT_STREQ(ngi_get_section_name(ngi_get_sorted_section(header, first)),
+                 "d");
+    ASSERT_EQ(ngi_get_properties_by_prefix(section, "key_", &first), 2);
+    ASSERT_STREQ(
+        ngi_get_property_name(ngi_get_sorted_property(section, first)),
+        "key_1");
+
+    /* The properties are added and removed */
+    recache_write("a ->\nkey_3: 3\n\nb ->\n");
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_EQ(ngi_get_sections_by_range(header, NULL, NULL, &first), 2);
+    section = ngi_get_sorted_section(header, 0);
+    ASSERT_STREQ(ngi_get_section_name(section), "a");
+    ASSERT_EQ(ngi_get_properties_by_prefix(section, "key_", &first), 1);
+    ASSERT_STREQ(
+        ngi_get_property_name(ngi_get_sorted_property(section, first)),
+        "key_3");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+/* Batch tests */
+UTEST(batch, lookup) {
+    recache_write("first ->\na: 1\nb: 2\n\nsecond ->\nc: 3\n");
+
+    const ngi_key_t keys[] = {
+        {"second", "c"}, {"first", "b"}, {"third", "a"},
+        {"first", "z"},  {"first", "a"},
+    };
+    ngi_batch_t* batch = ngi_batch_create(keys, 5);
+    ASSERT_TRUE(batch != NULL);
+
+    /* The results are in the order of the keys */
+    ngi_header_t* header = ngi_open_lazy(RECACHE_FILENAME);
+    ngi_property_t* properties[5];
+    ASSERT_EQ(ngi_batch_get_properties(batch, header, properties), 3);
+    ASSERT_TRUE(properties[0] ==
+                ngi_get_property(ngi_get_section(header, 1), 0));
+    ASSERT_TRUE(properties[2] == NULL);
+    ASSERT_TRUE(properties[3] == NULL);
+
+    const char* values[5];
+    ASSERT_EQ(ngi_batch_get_values(batch, header, values), 3);
+    ASSERT_STREQ(values[0], "3");
+    ASSERT_STREQ(values[1], "2");
+    ASSERT_TRUE(values[2] == NULL);
+    ASSERT_STREQ(values[4], "1");
+    ngi_close(header);
+
+    /* The batch is reused with another tree */
+    header = ngi_parse_buffer("first ->\na: 4\n", 14);
+    ASSERT_EQ(ngi_batch_get_values(batch, header, values), 1);
+    ASSERT_TRUE(values[0] == NULL);
+    ASSERT_STREQ(values[4], "4");
+    ngi_close(header);
+
+    ngi_batch_free(batch);
+    remove(RECACHE_FILENAME);
+}
+
 /* Create tests */
 UTEST_F(ngi_fixture, create_section) {
     ngi_section_t* section =
@@ -101,14 +742,15 @@ UTEST_F(ngi_fixture, create_section) {
     ASSERT_EQ(res, 3);
 }
 
-/* TODO: Fix these tests
 UTEST_F(ngi_fixture, create_property) {
-    ngi_section_t* section = ngi_get_section_by_name(utest_fixture->header,
-"prop_sec"); ASSERT_STREQ(ngi_get_section_name(section), "prop_sec");
+    ngi_section_t* section =
+        ngi_get_section_by_name(utest_fixture->header, "prop_sec");
+    ASSERT_STREQ(ngi_get_section_name(section), "prop_sec");
 
-    ngi_property_t* property = ngi_create_property(utest_fixture->header,
-section, "hello", "value"); ASSERT_STREQ(ngi_get_property_name(property),
-"hello"); ASSERT_STREQ(ngi_get_property_value(property), "value");
+    ngi_property_t* property =
+        ngi_create_property(utest_fixture->header, section, "hello", "value");
+    ASSERT_STREQ(ngi_get_property_name(property), "hello");
+    ASSERT_STREQ(ngi_get_property_value(property), "value");
 
     ngi_property_t* property2 = ngi_get_property(section, 0);
     ASSERT_TRUE(property == property2);
@@ -117,18 +759,20 @@ section, "hello", "value"); ASSERT_STREQ(ngi_get_property_name(property),
     ASSERT_EQ(res, 1);
 }
 
-// Replace tests
+/* Replace tests */
 UTEST_F(ngi_fixture, replace_section) {
-    ngi_section_t* section =  ngi_get_section_by_name(utest_fixture->header,
-"prop_sec"); ASSERT_STREQ(ngi_get_section_name(section), "prop_sec");
+    ngi_section_t* section =
+        ngi_get_section_by_name(utest_fixture->header, "prop_sec");
+    ASSERT_STREQ(ngi_get_section_name(section), "prop_sec");
 
     ngi_section_replace(utest_fixture->header, section, "new prop");
     ASSERT_STREQ(ngi_get_section_name(section), "new prop");
 }
 
 UTEST_F(ngi_fixture, replace_property) {
-    ngi_section_t* section =  ngi_get_section_by_name(utest_fixture->header,
-"new prop"); ASSERT_STREQ(ngi_get_section_name(section), "new prop");
+    ngi_section_t* section =
+        ngi_get_section_by_name(utest_fixture->header, "new prop");
+    ASSERT_STREQ(ngi_get_section_name(section), "new prop");
 
     ngi_property_t* property = ngi_get_property_by_name(section, "hello");
     ASSERT_STREQ(ngi_get_property_name(property), "hello");
@@ -137,4 +781,546 @@ UTEST_F(ngi_fixture, replace_property) {
     ASSERT_STREQ(ngi_get_property_name(property), "Hello");
     ASSERT_STREQ(ngi_get_property_value(property), "World");
 }
-*/
+
+UTEST(replace, in_place) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1\nb: 2\n\nsecond ->\nc: 3", fd);
+    fclose(fd);
+
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r+");
+    ngi_section_t* first = ngi_get_section(header, 0);
+    ngi_section_t* second = ngi_get_section(header, 1);
+
+    /* Longer and shorter lines move the next ones */
+    ngi_property_replace(header, ngi_get_property(first, 0), "a", "100");
+    ngi_section_replace(header, first, "1st");
+    ngi_property_replace(header, ngi_get_property(second, 0), "c", "");
+
+    /* Properties are added at the end of their section */
+    ngi_create_property(header, first, "z", "26");
+    ngi_create_property(header, second, "d", "4");
+    ngi_property_replace(header, ngi_get_property(first, 1), "bb", "2");
+
+    char buffer[64] = {0};
+    fd = ngi_get_file(header);
+    rewind(fd);
+    ASSERT_EQ(fread(buffer, 1, sizeof(buffer) - 1, fd),
+              strlen("1st ->\na: 100\nbb: 2\nz: 26\n\nsecond ->\nc: \nd: 4"));
+    ASSERT_STREQ(buffer, "1st ->\na: 100\nbb: 2\nz: 26\n\nsecond ->\nc: \nd: 4");
+    ngi_close(header);
+
+    /* The file is truncated when it gets shorter */
+    header = ngi_open(RECACHE_FILENAME, "r+");
+    first = ngi_get_section(header, 0);
+    ngi_property_replace(header, ngi_get_property(first, 0), "a", "1");
+    ngi_section_replace(header, ngi_get_section(header, 1), "2nd");
+
+    memset(buffer, 0, sizeof(buffer));
+    fd = ngi_get_file(header);
+    rewind(fd);
+    fread(buffer, 1, sizeof(buffer) - 1, fd);
+    ASSERT_STREQ(buffer, "1st ->\na: 1\nbb: 2\nz: 26\n\n2nd ->\nc: \nd: 4");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+/* Transaction tests */
+UTEST(transaction, commit) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1\nb: 2\n\nsecond ->\nc: 3\n", fd);
+    fclose(fd);
+
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r+");
+    ngi_section_t* first = ngi_get_section(header, 0);
+    ASSERT_TRUE(ngi_begin(header));
+    ASSERT_FALSE(ngi_begin(header));
+
+    /* The changes are only made in memory */
+    ngi_property_replace(header, ngi_get_property(first, 0), "a", "1000");
+    ngi_section_t* third = ngi_create_section(header, "third");
+    ngi_create_property(header, third, "e", "5");
+    ngi_create_property(header, first, "z", "26");
+
+    char buffer[64] = {0};
+    fd = ngi_get_file(header);
+    rewind(fd);
+    fread(buffer, 1, sizeof(buffer) - 1, fd);
+    ASSERT_STREQ(buffer, "first ->\na: 1\nb: 2\n\nsecond ->\nc: 3\n");
+    ASSERT_FALSE(ngi_recache_file(header));
+
+    /* Everything is written at once */
+    ASSERT_TRUE(ngi_commit(header));
+    memset(buffer, 0, sizeof(buffer));
+    rewind(fd);
+    fread(buffer, 1, sizeof(buffer) - 1, fd);
+    ASSERT_STREQ(buffer,
+                 "first ->\na: 1000\nb: 2\nz: 26\n\nsecond ->\nc: 3\n\n"
+                 "third ->\ne: 5\n");
+
+    /* The lines can be replaced in place after the commit */
+    ngi_property_replace(header, ngi_get_property(first, 0), "a", "1");
+    ngi_property_replace(header, ngi_get_property(third, 0), "e", "55");
+    memset(buffer, 0, sizeof(buffer));
+    rewind(fd);
+    fread(buffer, 1, sizeof(buffer) - 1, fd);
+    ASSERT_STREQ(buffer,
+                 "first ->\na: 1\nb: 2\nz: 26\n\nsecond ->\nc: 3\n\n"
+                 "third ->\ne: 55\n");
+
+    /* A rollback gets the tree back from the file */
+    ASSERT_TRUE(ngi_begin(header));
+    ngi_create_section(header, "fourth");
+    ngi_section_replace(header, first, "renamed");
+    ASSERT_TRUE(ngi_rollback(header));
+    ASSERT_EQ(ngi_get_sections_number(header), 3);
+    ASSERT_STREQ(ngi_get_section_name(ngi_get_section(header, 0)), "first");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(transaction, rollback) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1\n", fd);
+    fclose(fd);
+
+    /* The file is untouched since it was opened */
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r+");
+    ngi_section_t* first = ngi_get_section(header, 0);
+    ASSERT_TRUE(ngi_begin(header));
+    ngi_section_replace(header, first, "renamed");
+    ngi_property_replace(header, ngi_get_property(first, 0), "a", "2");
+    ASSERT_TRUE(ngi_rollback(header));
+    ASSERT_STREQ(ngi_get_section_name(first), "first");
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(first, 0)), "1");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+/* Save tests */
+UTEST(save, rename) {
+    FILE* fd = fopen(RECACHE_FILENAME, "w");
+    fputs("first ->\na: 1\n", fd);
+    fclose(fd);
+    chmod(RECACHE_FILENAME, 0640);
+
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r+");
+    ngi_header_t* reader = ngi_open(RECACHE_FILENAME, "r");
+    ngi_header_t* mapped = ngi_open_mmap(RECACHE_FILENAME);
+
+    ASSERT_TRUE(ngi_begin(header));
+    ngi_section_t* section = ngi_create_section(header, "second");
+    ngi_create_property(header, section, "b", "2");
+    ASSERT_TRUE(ngi_save(header, NGI_SYNC_DIR));
+    ASSERT_FALSE(ngi_in_transaction(header));
+
+    struct stat file_stat;
+    ASSERT_EQ(stat(RECACHE_FILENAME, &file_stat), 0);
+    ASSERT_EQ((int)(file_stat.st_mode & 0777), 0640);
+
+    /* The header writes to the new file */
+    ngi_property_replace(header, ngi_get_property(section, 0), "b", "20");
+
+    char buffer[64] = {0};
+    fd = fopen(RECACHE_FILENAME, "r");
+    fread(buffer, 1, sizeof(buffer) - 1, fd);
+    fclose(fd);
+    ASSERT_STREQ(buffer, "first ->\na: 1\n\nsecond ->\nb: 20\n");
+
+    /* The other headers see the new file after a recache */
+    ASSERT_EQ(ngi_get_sections_number(reader), 1);
+    ASSERT_TRUE(ngi_recache_file(reader));
+    ASSERT_EQ(ngi_get_sections_number(reader), 2);
+
+    ASSERT_EQ(ngi_get_sections_number(mapped), 1);
+    ASSERT_TRUE(ngi_recache_file(mapped));
+    ASSERT_EQ(ngi_get_sections_number(mapped), 2);
+
+    /* A header without a file descriptor can be saved too */
+    ASSERT_TRUE(ngi_save(mapped, NGI_SYNC_NONE));
+    ASSERT_TRUE(ngi_recache_file(mapped));
+    ASSERT_EQ(ngi_get_sections_number(mapped), 2);
+
+    ngi_close(mapped);
+    ngi_close(reader);
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+/* Dump tests */
+UTEST(dump, buffer) {
+    const char data[] = "first ->\na: 1\nb: 2\n\nsecond ->\nc: 3\n";
+
+    ngi_header_t* header = ngi_parse_buffer(data, sizeof(data) - 1);
+    ASSERT_EQ(ngi_dump_size(header), sizeof(data) - 1);
+
+    /* The dump is allocated with the exact size */
+    size_t size;
+    char* dump = ngi_dump_to_buffer(header, NULL, &size);
+    ASSERT_EQ(size, sizeof(data) - 1);
+    ASSERT_STREQ(dump, data);
+    free(dump);
+
+    /* A buffer too small is not written */
+    char buffer[sizeof(data)];
+    size = sizeof(data) - 1;
+    ASSERT_TRUE(ngi_dump_to_buffer(header, buffer, &size) == NULL);
+    ASSERT_EQ(size, sizeof(data) - 1);
+
+    size = sizeof(buffer);
+    ASSERT_TRUE(ngi_dump_to_buffer(header, buffer, &size) == buffer);
+    ASSERT_STREQ(buffer, data);
+
+    ngi_close(header);
+}
+
+/* Reload tests */
+UTEST(reload, swap) {
+    recache_write("first ->\na: 1\n");
+
+    ngi_reloader_t* reloader = ngi_reloader_create(RECACHE_FILENAME);
+    ASSERT_TRUE(reloader != NULL);
+    ngi_header_t* old_header = ngi_reloader_acquire(reloader);
+
+    /* The same file is not parsed again */
+    ASSERT_TRUE(ngi_reloader_reload(reloader));
+    ngi_header_t* header = ngi_reloader_acquire(reloader);
+    ASSERT_TRUE(header == old_header);
+    ngi_reloader_release(reloader, header);
+
+    /* The old tree is kept until it's released */
+    recache_write("first ->\na: 2\n");
+    ASSERT_TRUE(ngi_reloader_reload(reloader));
+    header = ngi_reloader_acquire(reloader);
+    ASSERT_FALSE(header == old_header);
+
+    ngi_section_t* section = ngi_get_section(old_header, 0);
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(section, 0)), "1");
+    section = ngi_get_section(header, 0);
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(section, 0)), "2");
+
+    ngi_reloader_release(reloader, old_header);
+    ngi_reloader_release(reloader, header);
+    ngi_reloader_free(reloader);
+    remove(RECACHE_FILENAME);
+}
+
+static void* reload_reader(void* arg) {
+    ngi_reloader_t* reloader = arg;
+    long reads = 0;
+
+    for (int i = 0; i < 20000; i++) {
+        ngi_header_t* header = ngi_reloader_acquire(reloader);
+        ngi_section_t* section = ngi_get_section(header, 0);
+        const char* value = ngi_get_property_value(ngi_get_property(section, 0));
+
+        /* Each tree is complete */
+        reads += strlen(value) == 3;
+        ngi_reloader_release(reloader, header);
+    }
+
+    return (void*)reads;
+}
+
+UTEST(reload, readers) {
+    recache_write("first ->\na: 000\n");
+
+    ngi_reloader_t* reloader = ngi_reloader_create(RECACHE_FILENAME);
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++)
+        pthread_create(&threads[i], NULL, reload_reader, reloader);
+
+    char contents[32];
+    for (int i = 0; i < 50; i++) {
+        snprintf(contents, sizeof(contents), "first ->\na: %03d\n", i);
+        recache_write(contents);
+        ASSERT_TRUE(ngi_reloader_reload(reloader));
+    }
+
+    for (int i = 0; i < 2; i++) {
+        void* reads;
+        pthread_join(threads[i], &reads);
+        ASSERT_EQ((long)reads, 20000);
+    }
+
+    ngi_reloader_free(reloader);
+    remove(RECACHE_FILENAME);
+}
+
+/* Concurrent tests */
+static void* concurrent_reader(void* arg) {
+    ngi_header_t* header = arg;
+    long reads = 0;
+
+    for (int i = 0; i < 20000; i++) {
+        ngi_read_lock(header);
+        ngi_section_t* section =
+            ngi_get_section_by_name(header, i % 2 ? "first" : "second");
+        ngi_property_t* property = ngi_get_property_by_name(section, "a");
+
+        /* The values are never seen half replaced */
+        reads += property != NULL &&
+                 strlen(ngi_get_property_value(property)) == 3;
+        ngi_read_unlock(header);
+    }
+
+    return (void*)reads;
+}
+
+UTEST(concurrent, writer) {
+    recache_write("first ->\na: 000\nsecond ->\na: 000\n");
+
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r+");
+    ASSERT_TRUE(ngi_set_concurrent(header));
+    ngi_section_t* first = ngi_get_section_by_name(header, "first");
+    ngi_property_t* property = ngi_get_property_by_name(first, "a");
+
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++)
+        pthread_create(&threads[i], NULL, concurrent_reader, header);
+
+    char value[12];
+    for (int i = 0; i < 50; i++) {
+        snprintf(value, sizeof(value), "%03d", i);
+        ngi_property_replace(header, property, "a", value);
+        ASSERT_TRUE(ngi_create_property(header, first, value, "") != NULL);
+    }
+
+    for (int i = 0; i < 2; i++) {
+        void* reads;
+        pthread_join(threads[i], &reads);
+        ASSERT_EQ((long)reads, 20000);
+    }
+
+    ASSERT_EQ(ngi_get_properties_number(first), 51);
+    ASSERT_STREQ(ngi_get_property_value(property), "049");
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+UTEST(concurrent, lazy) {
+    recache_write("first ->\na: 000\nsecond ->\na: 000\n");
+
+    /* The readers parse the lazy sections together */
+    ngi_header_t* header = ngi_open_lazy(RECACHE_FILENAME);
+    ASSERT_TRUE(ngi_set_concurrent(header));
+
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+        pthread_create(&threads[i], NULL, concurrent_reader, header);
+
+    for (int i = 0; i < 4; i++) {
+        void* reads;
+        pthread_join(threads[i], &reads);
+        ASSERT_EQ((long)reads, 20000);
+    }
+
+    ngi_section_t* section = ngi_get_section_by_name(header, "second");
+    ASSERT_EQ(ngi_get_properties_number(section), 1);
+
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}
+
+/* Compiled tests */
+#define IMAGE_FILENAME RECACHE_FILENAME "c"
+
+static void image_patch(const char* from, const char* to, size_t len) {
+    FILE* fd = fopen(IMAGE_FILENAME, "r+b");
+    char buff[4096];
+    const size_t size = fread(buff, 1, sizeof(buff), fd);
+
+    for (size_t i = 0; i + len <= size; i++) {
+        if (!memcmp(buff + i, from, len)) {
+            fseek(fd, i, SEEK_SET);
+            fwrite(to, 1, len, fd);
+            break;
+        }
+    }
+
+    fclose(fd);
+}
+
+UTEST(compiled, open) {
+    recache_write("first ->\na: 1\n\nsecond ->\nb: 2\n");
+    remove(IMAGE_FILENAME);
+
+    /* The first open parses the file and writes the image */
+    ngi_header_t* header = ngi_open_compiled(RECACHE_FILENAME);
+    ASSERT_TRUE(header != NULL);
+    ASSERT_EQ(access(IMAGE_FILENAME, R_OK), 0);
+    ngi_close(header);
+
+    /* The next ones use the image, where the value is changed */
+    image_patch("b\0002", "b\0007", 3);
+    header = ngi_open_compiled(RECACHE_FILENAME);
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+
+    /* The properties are allocated on first access */
+    ngi_section_t* section = ngi_get_section_by_name(header, "second");
+    ASSERT_FALSE(ngi_section_is_loaded(section));
+    ngi_property_t* property = ngi_get_property_by_name(section, "b");
+    ASSERT_STREQ(ngi_get_property_value(property), "7");
+    ASSERT_EQ(ngi_get_property_span(property)->offset, 25);
+    ASSERT_EQ(ngi_get_property_span(property)->length, 4);
+
+    /* The file didn't change, the tree is only recached when forced */
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_STREQ(ngi_get_property_value(property), "7");
+    ngi_set_recache_check(header, NGI_RECACHE_ALWAYS);
+    ASSERT_TRUE(ngi_recache_file(header));
+    ASSERT_STREQ(ngi_get_property_value(property), "2");
+    ngi_close(header);
+
+    /* A file with other contents of the same size is parsed again */
+    recache_write("first ->\na: 1\n\nsecond ->\nb: 3\n");
+    header = ngi_open_compiled(RECACHE_FILENAME);
+    section = ngi_get_section_by_name(header, "second");
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(section, 0)), "3");
+    ngi_close(header);
+
+    /* A corrupted image is replaced */
+    ASSERT_EQ(truncate(IMAGE_FILENAME, 40), 0);
+    header = ngi_open_compiled(RECACHE_FILENAME);
+    ASSERT_EQ(ngi_get_sections_number(header), 2);
+    ngi_close(header);
+
+    header = ngi_open_compiled(RECACHE_FILENAME);
+    section = ngi_get_section_by_name(header, "first");
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(section, 0)), "1");
+    ngi_close(header);
+
+    remove(IMAGE_FILENAME);
+    remove(RECACHE_FILENAME);
+}
+
+/* Shared tests */
+#define SHARED_NAME "/libngi-tests"
+
+UTEST(shared, publish) {
+    ngi_unpublish(SHARED_NAME);
+    ASSERT_TRUE(ngi_subscribe(SHARED_NAME) == NULL);
+
+    ngi_header_t* header = ngi_parse_buffer("first ->\na: 1\n", 14);
+    ASSERT_TRUE(ngi_publish(header, SHARED_NAME));
+
+    /* A tree without a file is only readable by the user */
+    struct stat shared_stat;
+    int shared_fd = shm_open(SHARED_NAME ".1", O_RDONLY, 0);
+    ASSERT_NE(shared_fd, -1);
+    ASSERT_EQ(fstat(shared_fd, &shared_stat), 0);
+    ASSERT_EQ((int)(shared_stat.st_mode & 0777), 0600);
+    close(shared_fd);
+
+    ngi_subscriber_t* subscriber = ngi_subscribe(SHARED_NAME);
+    ASSERT_TRUE(subscriber != NULL);
+    ASSERT_TRUE(ngi_subscriber_changed(subscriber));
+
+    ngi_header_t* first = ngi_subscriber_attach(subscriber);
+    ASSERT_TRUE(first != NULL);
+    ASSERT_FALSE(ngi_subscriber_changed(subscriber));
+    ngi_section_t* section = ngi_get_section_by_name(first, "first");
+    ngi_property_t* property = ngi_get_property_by_name(section, "a");
+    ASSERT_STREQ(ngi_get_property_value(property), "1");
+
+    /* The attached generation stays readable after the next one */
+    ngi_set_property_value(
+        ngi_get_property(ngi_get_section(header, 0), 0), "2");
+    ASSERT_TRUE(ngi_publish(header, SHARED_NAME));
+    ASSERT_TRUE(ngi_subscriber_changed(subscriber));
+    ASSERT_STREQ(ngi_get_property_value(property), "1");
+
+    ngi_header_t* second = ngi_subscriber_attach(subscriber);
+    section = ngi_get_section_by_name(second, "first");
+    ASSERT_STREQ(ngi_get_property_value(ngi_get_property(section, 0)), "2");
+    ASSERT_FALSE(ngi_recache_file(second));
+
+    /* Another process attaches the same generation */
+    pid_t pid = fork();
+    if (pid == 0) {
+        ngi_subscriber_t* child = ngi_subscribe(SHARED_NAME);
+        ngi_header_t* tree = child ? ngi_subscriber_attach(child) : NULL;
+        section = tree ? ngi_get_section_by_name(tree, "first") : NULL;
+        property = section ? ngi_get_property_by_name(section, "a") : NULL;
+        _exit(property == NULL ||
+              strcmp(ngi_get_property_value(property), "2") != 0);
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+
+    ngi_close(first);
+    ngi_close(second);
+    ngi_subscriber_free(subscriber);
+    ngi_close(header);
+
+    /* The objects follow the permissions of the file */
+    recache_write("first ->\na: 1\n");
+    chmod(RECACHE_FILENAME, 0640);
+    header = ngi_open(RECACHE_FILENAME, "r");
+    ASSERT_TRUE(ngi_publish(header, SHARED_NAME));
+    ngi_close(header);
+
+    shared_fd = shm_open(SHARED_NAME ".3", O_RDONLY, 0);
+    ASSERT_NE(shared_fd, -1);
+    ASSERT_EQ(fstat(shared_fd, &shared_stat), 0);
+    ASSERT_EQ((int)(shared_stat.st_mode & 0777), 0640);
+    close(shared_fd);
+    shared_fd = shm_open(SHARED_NAME, O_RDONLY, 0);
+    ASSERT_EQ(fstat(shared_fd, &shared_stat), 0);
+    ASSERT_EQ((int)(shared_stat.st_mode & 0777), 0640);
+    close(shared_fd);
+    remove(RECACHE_FILENAME);
+
+    ASSERT_TRUE(ngi_unpublish(SHARED_NAME));
+    ASSERT_TRUE(ngi_subscribe(SHARED_NAME) == NULL);
+}
+
+/* Watch tests */
+static void watch_changed(ngi_header_t* ngi_header,
+                          const ngi_changes_t* ngi_changes, void* data) {
+    (void)ngi_header;
+    const ngi_change_t* change = ngi_get_change(ngi_changes, 0);
+    if (ngi_get_changes_number(ngi_changes) != 1 ||
+        change->type != NGI_CHANGE_MODIFIED)
+        return;
+    __atomic_add_fetch((int*)data, 1, __ATOMIC_RELEASE);
+}
+
+UTEST(watch, callback) {
+    recache_write("first ->\na: 1\n");
+
+    ngi_header_t* header = ngi_open(RECACHE_FILENAME, "r");
+    ngi_watcher_t* watcher = ngi_watcher_create();
+    int calls = 0;
+    ASSERT_TRUE(ngi_watch(watcher, header, watch_changed, &calls));
+
+    /* The same contents don't call the callback, the events are in order */
+    recache_write("first ->\na: 1\n");
+    recache_write("first ->\na: 2\n");
+
+    for (int i = 0; i < 2000 && __atomic_load_n(&calls, __ATOMIC_ACQUIRE) < 1;
+         i++)
+        usleep(1000);
+
+    ngi_watcher_lock(watcher);
+    ngi_property_t* property = ngi_get_property(ngi_get_section(header, 0), 0);
+    ASSERT_STREQ(ngi_get_property_value(property), "2");
+    ngi_watcher_unlock(watcher);
+    ASSERT_EQ(__atomic_load_n(&calls, __ATOMIC_ACQUIRE), 1);
+
+    /* An unwatched file is not recached */
+    ASSERT_TRUE(ngi_unwatch(watcher, header));
+    ASSERT_FALSE(ngi_unwatch(watcher, header));
+    recache_write("first ->\na: 3\n");
+    usleep(20000);
+    ASSERT_STREQ(ngi_get_property_value(property), "2");
+
+    ngi_watcher_free(watcher);
+    ngi_close(header);
+    remove(RECACHE_FILENAME);
+}